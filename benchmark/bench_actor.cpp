@@ -12,6 +12,7 @@
 #include "td/utils/common.h"
 #include "td/utils/crypto.h"
 #include "td/utils/logging.h"
+#include "td/utils/TraceRecorder.h"
 
 #if TD_MSVC
 #pragma comment(linker, "/STACK:16777216")
@@ -25,6 +26,7 @@ class RingBench : public td::Benchmark {
  private:
   int actor_n_ = -1;
   int thread_n_ = -1;
+  bool with_tracing_ = false;
   std::vector<td::ActorId<PassActor>> actor_array_;
   td::ConcurrentScheduler *scheduler_ = nullptr;
 
@@ -32,13 +34,15 @@ class RingBench : public td::Benchmark {
   std::string get_description() const override {
     static const char *types[] = {"later", "immediate", "raw", "tail", "lambda"};
     static_assert(0 <= type && type < 5, "");
-    return PSTRING() << "Ring (send_" << types[type] << ") (threads_n = " << thread_n_ << ")";
+    return PSTRING() << "Ring (send_" << types[type] << ") (threads_n = " << thread_n_ << ")"
+                     << (with_tracing_ ? " with tracing" : "");
   }
 
   struct PassActor : public td::Actor {
     int id = -1;
     td::ActorId<PassActor> next_actor;
     int start_n = 0;
+    td::uint64 trace_id = 0;
 
     void pass(int n) {
       // LOG(INFO) << "Pass: " << n;
@@ -77,15 +81,20 @@ class RingBench : public td::Benchmark {
       if (start_n != 0) {
         int n = start_n;
         start_n = 0;
+        td::TraceIdGuard trace_id_guard(trace_id);
         pass(n);
       }
     }
   };
 
-  RingBench(int actor_n, int thread_n) : actor_n_(actor_n), thread_n_(thread_n) {
+  RingBench(int actor_n, int thread_n, bool with_tracing = false)
+      : actor_n_(actor_n), thread_n_(thread_n), with_tracing_(with_tracing) {
   }
 
   void start_up() override {
+    if (with_tracing_) {
+      td::TraceRecorder::set_max_span_count(1 << 16);
+    }
     scheduler_ = new td::ConcurrentScheduler();
     scheduler_->init(thread_n_);
 
@@ -104,6 +113,7 @@ class RingBench : public td::Benchmark {
   void run(int n) override {
     // first actor is on main_thread
     actor_array_[0].get_actor_unsafe()->start_n = td::max(n, 100);
+    actor_array_[0].get_actor_unsafe()->trace_id = with_tracing_ ? 1 : 0;
     while (scheduler_->run_main(10)) {
       // empty
     }
@@ -112,6 +122,7 @@ class RingBench : public td::Benchmark {
   void tear_down() override {
     scheduler_->finish();
     delete scheduler_;
+    td::TraceRecorder::set_max_span_count(0);
   }
 };
 
@@ -266,15 +277,65 @@ class QueryBench : public td::Benchmark {
   td::ActorOwn<ServerActor> server_;
 };
 
+class CreateActorBench : public td::Benchmark {
+  class SelfStoppingActor : public td::Actor {
+    void start_up() override {
+      stop();
+    }
+  };
+
+  class FinishActor : public td::Actor {
+    void start_up() override {
+      td::Scheduler::instance()->finish();
+      stop();
+    }
+  };
+
+ public:
+  std::string get_description() const override {
+    return "CreateActor";
+  }
+
+  void start_up() override {
+    scheduler_ = new td::ConcurrentScheduler();
+    scheduler_->init(0);
+    scheduler_->start();
+  }
+
+  void run(int n) override {
+    {
+      auto guard = scheduler_->get_main_guard();
+      for (int i = 0; i < n; i++) {
+        td::create_actor<SelfStoppingActor>("SelfStoppingActor").release();
+      }
+      td::create_actor<FinishActor>("FinishActor").release();
+    }
+    while (scheduler_->run_main(10)) {
+      // empty
+    }
+  }
+
+  void tear_down() override {
+    scheduler_->finish();
+    delete scheduler_;
+  }
+
+ private:
+  td::ConcurrentScheduler *scheduler_ = nullptr;
+};
+
 int main() {
   td::init_openssl_threads();
 
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(DEBUG));
+  bench(CreateActorBench());
   bench(RingBench<4>(504, 0));
   bench(RingBench<3>(504, 0));
   bench(RingBench<0>(504, 0));
   bench(RingBench<1>(504, 0));
   bench(RingBench<2>(504, 0));
+  bench(RingBench<0>(504, 0, true));
+  bench(RingBench<2>(504, 0, true));
   bench(QueryBench<5>());
   bench(QueryBench<4>());
   bench(QueryBench<2>());
@@ -12,6 +12,7 @@
 #include "td/utils/port/thread.h"
 #include "td/utils/Random.h"
 #include "td/utils/Slice.h"
+#include "td/utils/Time.h"
 #include "td/utils/UInt.h"
 
 #include <openssl/evp.h>
@@ -51,6 +52,59 @@ class SHA1Bench : public td::Benchmark {
   }
 };
 
+// reports hashing speed in GB/s; thread_count threads hash independent ranges of range_size bytes,
+// as it is done during verification of CDN file parts
+class Sha256Bench : public td::Benchmark {
+ public:
+  Sha256Bench(size_t range_size, int thread_count) : range_size_(range_size), thread_count_(thread_count) {
+  }
+  Sha256Bench(const Sha256Bench &) = delete;
+  Sha256Bench &operator=(const Sha256Bench &) = delete;
+  Sha256Bench(Sha256Bench &&) = delete;
+  Sha256Bench &operator=(Sha256Bench &&) = delete;
+  ~Sha256Bench() override {
+    if (total_time_ > 0) {
+      LOG(PLAIN) << get_description() << ": " << static_cast<double>(total_size_) / (1 << 30) / total_time_
+                 << " GB/s";
+    }
+  }
+
+  std::string get_description() const override {
+    return PSTRING() << "SHA256 OpenSSL [" << (range_size_ >> 10) << "KB x " << thread_count_ << " threads]";
+  }
+
+  void start_up() override {
+    data_ = std::string(range_size_ * thread_count_, 'a');
+  }
+
+  void run(int n) override {
+    auto start = td::Time::now();
+    std::vector<td::thread> threads;
+    for (int i = 0; i < thread_count_; i++) {
+      threads.emplace_back([&, i] {
+        auto range = td::Slice(data_).substr(range_size_ * i, range_size_);
+        unsigned char hash[32];
+        for (int j = 0; j < n; j++) {
+          td::sha256(range, td::MutableSlice(hash, 32));
+        }
+        td::do_not_optimize_away(hash[0]);
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    total_time_ += td::Time::now() - start;
+    total_size_ += static_cast<td::uint64>(range_size_) * thread_count_ * n;
+  }
+
+ private:
+  size_t range_size_;
+  int thread_count_;
+  std::string data_;
+  double total_time_ = 0;
+  td::uint64 total_size_ = 0;
+};
+
 class AesEcbBench : public td::Benchmark {
  public:
   alignas(64) unsigned char data[DATA_SIZE];
@@ -430,6 +484,10 @@ int main() {
 #endif
   td::bench(SslRandBufBench());
   td::bench(SHA1Bench());
+  td::bench(Sha256Bench(8 << 10, 1));
+  td::bench(Sha256Bench(128 << 10, 1));
+  td::bench(Sha256Bench(128 << 10, 4));
+  td::bench(Sha256Bench(1 << 20, 1));
   td::bench(Crc32Bench());
   td::bench(Crc64Bench());
 }
@@ -0,0 +1,218 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/files/FileIoService.h"
+
+#include "td/actor/actor.h"
+#include "td/actor/impl/ConcurrentScheduler.h"
+#include "td/actor/PromiseFuture.h"
+
+#include "td/utils/benchmark.h"
+#include "td/utils/buffer.h"
+#include "td/utils/common.h"
+#include "td/utils/format.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+#include "td/utils/port/FileFd.h"
+#include "td/utils/port/path.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Time.h"
+
+#include <cstdint>
+#include <memory>
+
+namespace td {
+
+static constexpr size_t PART_SIZE = 128 << 10;
+
+// A download, whose parts are received from a fake source immediately, so only writing them to the storage is measured.
+// Parts are written either right in the scheduler thread or through FileIoService.
+class FakeDownloader final : public Actor {
+ public:
+  FakeDownloader(string path, bool use_direct_io, int32 part_count, ActorId<FileIoService> file_io_service,
+                 Promise<Unit> promise)
+      : path_(std::move(path))
+      , use_direct_io_(use_direct_io)
+      , part_count_(part_count)
+      , file_io_service_(std::move(file_io_service))
+      , promise_(std::move(promise)) {
+  }
+
+ private:
+  string path_;
+  bool use_direct_io_;
+  int32 part_count_;
+  int32 part_id_ = 0;
+  ActorId<FileIoService> file_io_service_;
+  Promise<Unit> promise_;
+  std::shared_ptr<FileFd> fd_;
+
+  void start_up() final {
+    auto flags = FileFd::Write | FileFd::Create | FileFd::Truncate;
+    auto r_fd = FileFd::open(path_, flags | (use_direct_io_ ? FileFd::Direct : 0));
+    if (r_fd.is_error() && use_direct_io_) {
+      // the file system doesn't support direct I/O
+      r_fd = FileFd::open(path_, flags);
+    }
+    fd_ = std::make_shared<FileFd>(r_fd.move_as_ok());
+    loop();
+  }
+
+  void loop() final {
+    if (part_id_ == part_count_) {
+      fd_.reset();
+      promise_.set_value(Unit());
+      stop();
+      return;
+    }
+
+    auto offset = static_cast<int64>(part_id_) * static_cast<int64>(PART_SIZE);
+    part_id_++;
+    auto part = create_part();
+    if (file_io_service_.empty()) {
+      auto written_size = fd_->pwrite(part.as_slice(), offset).move_as_ok();
+      CHECK(written_size == PART_SIZE);
+      // the next part is received from the network later, so other actors can run in between
+      yield();
+    } else {
+      send_closure(file_io_service_, &FileIoService::write, fd_, offset, std::move(part),
+                   PromiseCreator::lambda([actor_id = actor_id(this)](Result<size_t> r_written_size) {
+                     CHECK(r_written_size.ok() == PART_SIZE);
+                     send_closure(actor_id, &FakeDownloader::loop);
+                   }));
+    }
+  }
+
+  static BufferSlice create_part() {
+    // direct I/O needs an aligned buffer
+    static constexpr size_t ALIGNMENT = 4096;
+    BufferSlice part(PART_SIZE + ALIGNMENT);
+    auto shift = static_cast<size_t>(-reinterpret_cast<std::uintptr_t>(part.as_slice().begin()) & (ALIGNMENT - 1));
+    part.confirm_read(shift);
+    part.truncate(PART_SIZE);
+    part.as_slice().fill('a');
+    return part;
+  }
+};
+
+// Measures how late timeouts expire, i.e. for how long the scheduler thread is blocked.
+class SchedulerDelayProbe final : public Actor {
+ public:
+  explicit SchedulerDelayProbe(double *max_delay) : max_delay_(max_delay) {
+  }
+
+ private:
+  static constexpr double PROBE_INTERVAL = 0.001;
+
+  double *max_delay_;
+  double expected_time_ = 0.0;
+
+  void start_up() final {
+    timeout_expired();
+  }
+
+  void timeout_expired() final {
+    auto now = Time::now();
+    if (expected_time_ != 0.0) {
+      *max_delay_ = max(*max_delay_, now - expected_time_);
+    }
+    expected_time_ = now + PROBE_INTERVAL;
+    set_timeout_in(PROBE_INTERVAL);
+  }
+};
+
+// Concurrent downloads to a storage, which is slow, because the page cache is bypassed if possible.
+// Slower storage, for example a network mount, can be specified as the first argument.
+class ConcurrentDownloadsBench final : public Benchmark {
+ public:
+  ConcurrentDownloadsBench(string dir, bool use_direct_io, int32 download_count, int32 thread_count)
+      : dir_(std::move(dir))
+      , use_direct_io_(use_direct_io)
+      , download_count_(download_count)
+      , thread_count_(thread_count) {
+  }
+
+  string get_description() const final {
+    return PSTRING() << download_count_ << " downloads writing "
+                     << (thread_count_ == 0 ? string("in the scheduler thread")
+                                            : PSTRING() << "through FileIoService with " << thread_count_ << " threads")
+                     << (use_direct_io_ ? " with direct I/O" : "");
+  }
+
+  void run(int n) final {
+    ConcurrentScheduler scheduler;
+    scheduler.init(0);
+
+    vector<string> paths;
+    for (int32 i = 0; i < download_count_; i++) {
+      paths.push_back(PSTRING() << dir_ << "bench_file_io_" << i);
+    }
+    int32 left_download_count = download_count_;
+    double max_delay = 0.0;
+    ActorOwn<FileIoService> file_io_service;
+    ActorOwn<SchedulerDelayProbe> probe;
+    {
+      auto guard = scheduler.get_main_guard();
+      if (thread_count_ > 0) {
+        file_io_service = create_actor<FileIoService>("FileIoService", thread_count_);
+      }
+      probe = create_actor<SchedulerDelayProbe>("SchedulerDelayProbe", &max_delay);
+      auto part_count = max(n / download_count_, 1);
+      for (auto &path : paths) {
+        create_actor<FakeDownloader>("FakeDownloader", path, use_direct_io_, part_count, file_io_service.get(),
+                                     PromiseCreator::lambda([&left_download_count](Unit) { left_download_count--; }))
+            .release();
+      }
+    }
+
+    scheduler.start();
+    while (left_download_count > 0) {
+      scheduler.run_main(10);
+    }
+    {
+      auto guard = scheduler.get_main_guard();
+      probe.reset();
+      file_io_service.reset();
+    }
+    scheduler.finish();
+
+    // big files are deleted slowly, so this is done after the downloads are measured
+    for (auto &path : paths) {
+      unlink(path).ignore();
+    }
+    max_delay_ = max(max_delay_, max_delay);
+  }
+
+  double get_max_delay() const {
+    return max_delay_;
+  }
+
+ private:
+  string dir_;
+  bool use_direct_io_;
+  int32 download_count_;
+  int32 thread_count_;
+  double max_delay_ = 0.0;
+};
+
+}  // namespace td
+
+int main(int argc, char **argv) {
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+  td::string dir = argc > 1 ? td::string(argv[1]) : td::string();
+  if (!dir.empty() && dir.back() != TD_DIR_SLASH) {
+    dir += TD_DIR_SLASH;
+  }
+  for (auto use_direct_io : {false, true}) {
+    for (auto download_count : {1, 16}) {
+      for (auto thread_count : {0, 4}) {
+        td::ConcurrentDownloadsBench bench(dir, use_direct_io, download_count, thread_count);
+        td::bench(bench);
+        LOG(ERROR) << "Maximum scheduler delay: " << td::format::as_time(bench.get_max_delay());
+      }
+    }
+  }
+}
@@ -0,0 +1,118 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/files/FileBitmask.h"
+#include "td/telegram/files/FileExtentMap.h"
+#include "td/telegram/files/PartsManager.h"
+
+#include "td/utils/benchmark.h"
+#include "td/utils/common.h"
+#include "td/utils/format.h"
+#include "td/utils/logging.h"
+#include "td/utils/Random.h"
+
+namespace td {
+
+// Several readers of a partially downloaded file seek to random offsets and read it by small chunks.
+// Before each chunk the reader asks whether it is ready; if it isn't, the missing parts are downloaded
+// through PartsManager from a stub source, which returns every part immediately.
+class StreamingSeekBench : public Benchmark {
+ public:
+  StreamingSeekBench(int reader_count, bool use_extent_map)
+      : reader_count_(reader_count), use_extent_map_(use_extent_map) {
+  }
+
+  string get_description() const override {
+    return PSTRING() << "Streaming seeks by " << reader_count_ << " readers using "
+                     << (use_extent_map_ ? "FileExtentMap" : "Bitmask");
+  }
+
+  void start_up() override {
+    parts_manager_ = PartsManager();
+    parts_manager_.init(FILE_SIZE, FILE_SIZE, true, 0, {}, true, false).ensure();
+    part_size_ = static_cast<int64>(parts_manager_.get_part_size());
+    on_progress();
+    requested_size_ = 0;
+  }
+
+  void run(int n) override {
+    for (int i = 0; i < n; i++) {
+      auto offset = static_cast<int64>(Random::fast(0, static_cast<int>(FILE_SIZE / CHUNK_SIZE) - 1)) * CHUNK_SIZE;
+      for (int chunk = 0; chunk < CHUNKS_PER_SEEK && offset < FILE_SIZE; chunk++, offset += CHUNK_SIZE) {
+        // all readers ask for the data, while only one of them triggers download
+        bool is_ready = false;
+        for (int reader = 0; reader < reader_count_; reader++) {
+          is_ready = get_ready_prefix_size(offset) >= CHUNK_SIZE;
+        }
+        if (!is_ready) {
+          download(offset);
+        }
+      }
+    }
+  }
+
+  void tear_down() override {
+    // every part must be requested only once
+    LOG_CHECK(requested_size_ == parts_manager_.get_ready_size())
+        << get_description() << ": requested " << format::as_size(requested_size_) << ", downloaded "
+        << format::as_size(parts_manager_.get_ready_size());
+  }
+
+ private:
+  static constexpr int64 FILE_SIZE = static_cast<int64>(1500) << 20;
+  static constexpr int64 CHUNK_SIZE = 16 << 10;
+  static constexpr int CHUNKS_PER_SEEK = 64;
+
+  int reader_count_;
+  bool use_extent_map_;
+
+  PartsManager parts_manager_;
+  int64 part_size_ = 0;
+  int64 requested_size_ = 0;
+  string ready_bitmask_;
+  FileExtentMap ready_extents_;
+
+  int64 get_ready_prefix_size(int64 offset) const {
+    if (use_extent_map_) {
+      return ready_extents_.get_ready_prefix_size(offset, FILE_SIZE);
+    }
+    return Bitmask(Bitmask::Decode{}, ready_bitmask_).get_ready_prefix_size(offset, part_size_, FILE_SIZE);
+  }
+
+  void download(int64 offset) {
+    parts_manager_.set_streaming_offset(offset, CHUNK_SIZE);
+    while (true) {
+      auto part = parts_manager_.start_part().move_as_ok();
+      if (part.size == 0) {
+        break;
+      }
+      requested_size_ += static_cast<int64>(part.size);
+      parts_manager_.on_part_ok(part.id, part.size, part.size).ensure();
+      on_progress();
+    }
+  }
+
+  // the same work as FileDownloader and FileNode do for every downloaded part
+  void on_progress() {
+    ready_bitmask_ = parts_manager_.get_bitmask();
+    if (use_extent_map_) {
+      ready_extents_ = FileExtentMap(Bitmask(Bitmask::Decode{}, ready_bitmask_), part_size_);
+    }
+  }
+};
+
+constexpr int64 StreamingSeekBench::FILE_SIZE;
+constexpr int64 StreamingSeekBench::CHUNK_SIZE;
+
+}  // namespace td
+
+int main() {
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+  for (int reader_count : {1, 8}) {
+    td::bench(td::StreamingSeekBench(reader_count, false));
+    td::bench(td::StreamingSeekBench(reader_count, true));
+  }
+}
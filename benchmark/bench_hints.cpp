@@ -0,0 +1,94 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/benchmark.h"
+#include "td/utils/common.h"
+#include "td/utils/format.h"
+#include "td/utils/Hints.h"
+#include "td/utils/logging.h"
+#include "td/utils/Random.h"
+
+namespace td {
+
+static constexpr int64 KEY_COUNT = 1000000;
+
+static string get_random_word(int min_length, int max_length) {
+  string result;
+  auto length = Random::fast(min_length, max_length);
+  for (int i = 0; i < length; i++) {
+    result += static_cast<char>('a' + Random::fast(0, 25));
+  }
+  return result;
+}
+
+// names of the keys consist of two words from a dictionary with Zipf-like distribution of word frequencies
+static const Hints &get_hints() {
+  static const Hints hints = [] {
+    constexpr int DICTIONARY_SIZE = 100000;
+    vector<string> dictionary;
+    for (int i = 0; i < DICTIONARY_SIZE; i++) {
+      dictionary.push_back(get_random_word(3, 8));
+    }
+    auto get_dictionary_word = [&] {
+      auto pos = Random::fast(0, DICTIONARY_SIZE - 1);
+      return dictionary[Random::fast(0, pos)];
+    };
+
+    Hints result;
+    for (int64 key = 1; key <= KEY_COUNT; key++) {
+      result.add(key, PSLICE() << get_dictionary_word() << ' ' << get_dictionary_word());
+      result.set_rating(key, Random::fast(0, 1000000));
+    }
+    return result;
+  }();
+  return hints;
+}
+
+class HintsSearchBench : public Benchmark {
+ public:
+  HintsSearchBench(int word_count, int word_length) : word_count_(word_count), word_length_(word_length) {
+  }
+
+  string get_description() const override {
+    return PSTRING() << "Hints search among " << KEY_COUNT << " keys by " << word_count_ << " words of length "
+                     << word_length_;
+  }
+
+  void start_up() override {
+    get_hints();
+  }
+
+  void run(int n) override {
+    auto &hints = get_hints();
+    size_t total_found = 0;
+    for (int i = 0; i < n; i++) {
+      string query;
+      for (int j = 0; j < word_count_; j++) {
+        query += get_random_word(word_length_, word_length_);
+        query += ' ';
+      }
+      total_found += hints.search(query, LIMIT).second.size();
+    }
+    do_not_optimize_away(total_found);
+  }
+
+ private:
+  static constexpr int32 LIMIT = 50;
+
+  int word_count_;
+  int word_length_;
+};
+
+}  // namespace td
+
+int main() {
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+  td::bench(td::HintsSearchBench(1, 1));
+  td::bench(td::HintsSearchBench(1, 2));
+  td::bench(td::HintsSearchBench(1, 3));
+  td::bench(td::HintsSearchBench(2, 1));
+  td::bench(td::HintsSearchBench(2, 2));
+}
@@ -13,12 +13,16 @@
 
 #include "td/utils/buffer.h"
 #include "td/utils/logging.h"
+#include "td/utils/misc.h"
+#include "td/utils/OptionParser.h"
 #include "td/utils/port/SocketFd.h"
 #include "td/utils/Slice.h"
 
+#include <atomic>
+
 namespace td {
 
-static int cnt = 0;
+static std::atomic<int> cnt{0};
 
 class HelloWorld : public HttpInboundConnection::Callback {
  public:
@@ -45,16 +49,22 @@ class HelloWorld : public HttpInboundConnection::Callback {
   }
 };
 
-const int N = 0;
+static int N = 0;
+static size_t max_poll_events = 1000;
+static double busy_poll_time = 0.0;
+static bool use_reuse_port = false;
+
 class Server : public TcpListener::Callback {
  public:
   void start_up() override {
+    Scheduler::instance()->set_poll_options(max_poll_events, busy_poll_time);
     listener_ = create_actor<TcpListener>("Listener", 8082, ActorOwn<TcpListener::Callback>(actor_id(this)));
   }
   void accept(SocketFd fd) override {
     LOG(ERROR) << "ACCEPT " << cnt++;
     pos_++;
-    auto scheduler_id = pos_ % (N != 0 ? N : 1) + (N != 0);
+    // with SO_REUSEPORT listeners every connection stays on the scheduler, which accepted it
+    auto scheduler_id = use_reuse_port ? Scheduler::instance()->sched_id() : pos_ % (N != 0 ? N : 1) + (N != 0);
     create_actor_on_scheduler<HttpInboundConnection>("HttpInboundConnection", scheduler_id, std::move(fd), 1024 * 1024,
                                                      0, 0,
                                                      create_actor_on_scheduler<HelloWorld>("HelloWorld", scheduler_id))
@@ -71,11 +81,42 @@ class Server : public TcpListener::Callback {
   int pos_{0};
 };
 
-int main() {
+int main(int argc, char **argv) {
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+
+  OptionParser options;
+  options.set_description("HTTP server benchmark; load it with an external generator, e. g. wrk -c 10000");
+  options.add_option('t', "threads", "number of additional scheduler threads", [&](Slice arg) {
+    N = to_integer<int>(arg);
+  });
+  options.add_option('e', "max-events", "maximum number of events returned by one poll call", [&](Slice arg) {
+    max_poll_events = to_integer<size_t>(arg);
+  });
+  options.add_option('b', "busy-poll", "time to busy-poll before blocking, in microseconds", [&](Slice arg) {
+    busy_poll_time = to_double(arg) * 1e-6;
+  });
+  options.add_option('r', "reuse-port", "create a SO_REUSEPORT listener on every scheduler", [&] {
+    use_reuse_port = true;
+  });
+  auto r_non_options = options.run(argc, argv, 0);
+  if (r_non_options.is_error()) {
+    LOG(PLAIN) << argv[0] << ": " << r_non_options.error().message();
+    LOG(PLAIN) << options;
+    return 1;
+  }
+  if (N == 0) {
+    use_reuse_port = false;
+  }
+
   auto scheduler = make_unique<ConcurrentScheduler>();
   scheduler->init(N);
-  scheduler->create_actor_unsafe<Server>(0, "Server").release();
+  if (use_reuse_port) {
+    for (int i = 1; i <= N; i++) {
+      scheduler->create_actor_unsafe<Server>(i, "Server").release();
+    }
+  } else {
+    scheduler->create_actor_unsafe<Server>(0, "Server").release();
+  }
   scheduler->start();
   while (scheduler->run_main(10)) {
     // empty
@@ -85,6 +126,6 @@ int main() {
 }
 }  // namespace td
 
-int main() {
-  return td::main();
+int main(int argc, char **argv) {
+  return td::main(argc, argv);
 }
@@ -0,0 +1,153 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/benchmark.h"
+#include "td/utils/buffer.h"
+#include "td/utils/BufferedFd.h"
+#include "td/utils/common.h"
+#include "td/utils/format.h"
+#include "td/utils/logging.h"
+#include "td/utils/port/IPAddress.h"
+#include "td/utils/port/PollFlags.h"
+#include "td/utils/port/ServerSocketFd.h"
+#include "td/utils/port/SocketFd.h"
+#include "td/utils/port/thread.h"
+#include "td/utils/Random.h"
+#include "td/utils/Slice.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+
+#include <atomic>
+#include <ctime>
+
+namespace td {
+
+// sends data over a loopback TCP connection through BufferedFd<SocketFd> and reports CPU time per sent GB
+class LoopbackSendBench : public Benchmark {
+ public:
+  LoopbackSendBench(size_t part_size, size_t parts_per_message, size_t zero_copy_threshold, size_t max_write_slices)
+      : part_size_(part_size)
+      , parts_per_message_(parts_per_message)
+      , zero_copy_threshold_(zero_copy_threshold)
+      , max_write_slices_(max_write_slices) {
+  }
+  LoopbackSendBench(const LoopbackSendBench &) = delete;
+  LoopbackSendBench &operator=(const LoopbackSendBench &) = delete;
+  LoopbackSendBench(LoopbackSendBench &&) = delete;
+  LoopbackSendBench &operator=(LoopbackSendBench &&) = delete;
+  ~LoopbackSendBench() override {
+    auto gb = static_cast<double>(total_received_) / (1 << 30);
+    if (gb > 0) {
+      LOG(PLAIN) << get_description() << ": " << total_cpu_time_ / CLOCKS_PER_SEC / gb << " CPU seconds per GB";
+    }
+  }
+
+  string get_description() const override {
+    return PSTRING() << "Loopback send of " << parts_per_message_ << " x " << format::as_size(part_size_)
+                     << (zero_copy_threshold_ != 0 ? " with MSG_ZEROCOPY" : "") << " using at most "
+                     << max_write_slices_ << " slices per writev";
+  }
+
+  void start_up() override {
+    int32 port = Random::fast(20000, 60000);
+    auto server = ServerSocketFd::open(port, "127.0.0.1").move_as_ok();
+    IPAddress address;
+    address.init_ipv4_port("127.0.0.1", port).ensure();
+    fd_ = BufferedFd<SocketFd>(SocketFd::open(address).move_as_ok());
+    fd_.set_max_write_slices(max_write_slices_);
+    if (zero_copy_threshold_ != 0) {
+      auto status = fd_.set_zero_copy(true);
+      LOG_IF(ERROR, status.is_error()) << status;
+      fd_.set_zero_copy_threshold(zero_copy_threshold_);
+    }
+
+    SocketFd accepted;
+    while (true) {
+      wait_for(server.get_native_fd().socket(), POLLIN);
+      server.get_poll_info().add_flags(PollFlags::Read());
+      auto r_socket = server.accept();
+      if (r_socket.is_ok()) {
+        accepted = r_socket.move_as_ok();
+        break;
+      }
+    }
+    accepted.get_native_fd().set_is_blocking(true).ensure();
+
+    received_ = 0;
+    receiver_ = thread([this, accepted = std::move(accepted)] {
+      string buf(1 << 20, '\0');
+      while (true) {
+        auto size = ::recv(accepted.get_native_fd().socket(), &buf[0], buf.size(), 0);
+        if (size <= 0) {
+          break;
+        }
+        received_ += static_cast<size_t>(size);
+      }
+    });
+
+    part_ = BufferSlice(string(part_size_, 'a'));
+    total_cpu_time_ -= static_cast<double>(std::clock());
+  }
+
+  void run(int n) override {
+    for (int i = 0; i < n; i++) {
+      for (size_t j = 0; j < parts_per_message_; j++) {
+        fd_.output_buffer().append(part_.clone());
+      }
+      flush(16 << 20);
+    }
+    flush(0);
+  }
+
+  void tear_down() override {
+    fd_.close();
+    receiver_.join();
+    total_cpu_time_ += static_cast<double>(std::clock());
+    total_received_ += received_.load();
+  }
+
+ private:
+  size_t part_size_;
+  size_t parts_per_message_;
+  size_t zero_copy_threshold_;
+  size_t max_write_slices_;
+
+  BufferedFd<SocketFd> fd_;
+  BufferSlice part_;
+  thread receiver_;
+  std::atomic<size_t> received_{0};
+  size_t total_received_ = 0;
+  double total_cpu_time_ = 0;
+
+  static void wait_for(int socket, short events) {
+    pollfd pfd;
+    pfd.fd = socket;
+    pfd.events = events;
+    pfd.revents = 0;
+    ::poll(&pfd, 1, 1000);
+  }
+
+  void flush(size_t max_unwritten) {
+    fd_.flush_write().ensure();
+    while (fd_.left_unwritten() > max_unwritten) {
+      wait_for(fd_.get_native_fd().socket(), POLLOUT);
+      fd_.get_poll_info().add_flags(PollFlags::Write());
+      fd_.flush_write().ensure();
+    }
+  }
+};
+
+}  // namespace td
+
+int main() {
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+  td::bench(td::LoopbackSendBench(512 << 10, 1, 0, 20));
+  td::bench(td::LoopbackSendBench(512 << 10, 1, 64 << 10, 20));
+  td::bench(td::LoopbackSendBench(24, 64, 0, 20));
+  td::bench(td::LoopbackSendBench(24, 64, 0, 1));
+  td::bench(td::LoopbackSendBench(24, 64, 0, 128));
+}
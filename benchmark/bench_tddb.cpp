@@ -5,9 +5,15 @@
 // file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 //
 #include "td/telegram/DialogId.h"
+#include "td/telegram/files/FileData.h"
+#include "td/telegram/files/FileData.hpp"
+#include "td/telegram/files/FileDb.h"
+#include "td/telegram/files/FileLocation.h"
+#include "td/telegram/files/FileType.h"
 #include "td/telegram/MessageId.h"
 #include "td/telegram/MessagesDb.h"
 #include "td/telegram/NotificationId.h"
+#include "td/telegram/net/DcId.h"
 #include "td/telegram/ServerMessageId.h"
 #include "td/telegram/UserId.h"
 
@@ -16,6 +22,7 @@
 
 #include "td/db/SqliteConnectionSafe.h"
 #include "td/db/SqliteDb.h"
+#include "td/db/SqliteKeyValue.h"
 
 #include "td/utils/benchmark.h"
 #include "td/utils/buffer.h"
@@ -23,6 +30,7 @@
 #include "td/utils/logging.h"
 #include "td/utils/Random.h"
 #include "td/utils/Status.h"
+#include "td/utils/tl_helpers.h"
 
 #include <memory>
 
@@ -108,9 +116,116 @@ class MessagesDbBench : public Benchmark {
     return Status::OK();
   }
 };
+
+// resolves random locations of used_file_count of FILE_COUNT files, as FileManager does for files of messages
+// loaded from the database
+class FileDbBench : public Benchmark {
+ public:
+  FileDbBench(size_t cache_size, int used_file_count) : cache_size_(cache_size), used_file_count_(used_file_count) {
+  }
+
+  string get_description() const override {
+    if (cache_size_ == 0) {
+      return PSTRING() << "FileDb resolve " << used_file_count_ << " of " << FILE_COUNT
+                       << " file locations without cache";
+    }
+    return PSTRING() << "FileDb resolve " << used_file_count_ << " of " << FILE_COUNT
+                     << " file locations with warmed up cache of size " << cache_size_;
+  }
+  void start_up() override {
+    do_start_up().ensure();
+    scheduler_->start();
+
+    // the chat was already opened, so the locations are resolved again
+    auto guard = scheduler_->get_main_guard();
+    if (cache_size_ != 0) {
+      for (int i = 0; i < used_file_count_; i++) {
+        file_db_->get_file_data_sync(locations_[i]).ensure();
+      }
+    }
+  }
+  void run(int n) override {
+    auto guard = scheduler_->get_main_guard();
+    for (int i = 0; i < n; i++) {
+      auto &location = locations_[Random::fast(0, used_file_count_ - 1)];
+      file_db_->get_file_data_sync(location).ensure();
+    }
+  }
+  void tear_down() override {
+    {
+      auto guard = scheduler_->get_main_guard();
+      file_db_->close(Promise<>());
+    }
+    scheduler_->run_main(0.1);
+    {
+      auto guard = scheduler_->get_main_guard();
+      file_db_.reset();
+      sql_connection_.reset();
+    }
+
+    scheduler_->finish();
+    scheduler_.reset();
+  }
+
+ private:
+  static constexpr int FILE_COUNT = 100000;
+
+  size_t cache_size_;
+  int used_file_count_;
+  td::unique_ptr<ConcurrentScheduler> scheduler_;
+  std::shared_ptr<SqliteConnectionSafe> sql_connection_;
+  std::shared_ptr<FileDbInterface> file_db_;
+  vector<FullRemoteFileLocation> locations_;
+
+  Status do_start_up() {
+    scheduler_ = make_unique<ConcurrentScheduler>();
+    scheduler_->init(1);
+
+    auto guard = scheduler_->get_main_guard();
+
+    string sql_db_name = "testdb_files.sqlite";
+    SqliteDb::destroy(sql_db_name).ignore();
+    sql_connection_ = std::make_shared<SqliteConnectionSafe>(sql_db_name);
+    auto &db = sql_connection_->get();
+    TRY_STATUS(init_db(db));
+
+    db.exec("BEGIN TRANSACTION").ensure();
+    // version == 0 ==> db will be destroyed
+    TRY_STATUS(init_file_db(db, 0));
+
+    // the files are added in one transaction directly, in the same format as FileDb stores them
+    SqliteKeyValue kv;
+    TRY_STATUS(kv.init_with_connection(db.clone(), "files"));
+    locations_.clear();
+    for (int i = 1; i <= FILE_COUNT; i++) {
+      FullRemoteFileLocation location(FileType::Document, Random::secure_int64(), Random::secure_int64(),
+                                      DcId::internal(Random::fast(1, 5)), "");
+      FileData data;
+      data.pmc_id_ = static_cast<uint64>(i);
+      data.remote_ = RemoteFileLocation(location);
+      data.size_ = Random::fast(1, 1 << 30);
+      data.remote_name_ = PSTRING() << "file" << i << ".mp4";
+      kv.set(PSLICE() << "file" << i, serialize(data));
+      kv.set(FileDbInterface::as_key(location), to_string(i));
+      locations_.push_back(std::move(location));
+    }
+    kv.set("file_id", to_string(FILE_COUNT));
+    db.exec("COMMIT TRANSACTION").ensure();
+
+    file_db_ = create_file_db(sql_connection_, 0, cache_size_);
+    return Status::OK();
+  }
+};
+
+constexpr int FileDbBench::FILE_COUNT;
+
 }  // namespace td
 
 int main() {
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(WARNING));
   bench(td::MessagesDbBench());
+  bench(td::FileDbBench(0, 100000));
+  // there are two cached rows per file: the location key and the file data
+  bench(td::FileDbBench(td::DEFAULT_FILE_DB_CACHE_SIZE, 100000));
+  bench(td::FileDbBench(td::DEFAULT_FILE_DB_CACHE_SIZE, 10000));
 }
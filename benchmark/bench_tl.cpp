@@ -0,0 +1,302 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/telegram_api.h"
+
+#include "td/utils/benchmark.h"
+#include "td/utils/buffer.h"
+#include "td/utils/common.h"
+#include "td/utils/format.h"
+#include "td/utils/logging.h"
+#include "td/utils/ObjectArena.h"
+#include "td/utils/Random.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Status.h"
+#include "td/utils/tl_parsers.h"
+#include "td/utils/tl_storers.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace td {
+
+// writes server responses in the wire format directly, because telegram_api objects can't be serialized by a client
+template <class StorerT>
+class TlBlobWriter {
+ public:
+  TlBlobWriter(StorerT &storer, uint64 seed) : storer_(storer), rnd_(seed) {
+  }
+
+  void store_updates(int update_count, int user_count) {
+    storer_.store_int(telegram_api::updates::ID);
+    storer_.store_int(VECTOR_ID);
+    storer_.store_int(update_count);
+    for (int i = 0; i < update_count; i++) {
+      store_update();
+    }
+    store_users(user_count);
+    storer_.store_int(VECTOR_ID);
+    storer_.store_int(0);
+    storer_.store_int(date_);
+    storer_.store_int(seq_);
+  }
+
+  void store_messages(int message_count, int chat_count, int user_count) {
+    storer_.store_int(telegram_api::messages_messages::ID);
+    storer_.store_int(VECTOR_ID);
+    storer_.store_int(message_count);
+    for (int i = 0; i < message_count; i++) {
+      if (random(0, 19) == 0) {
+        store_message_service();
+      } else {
+        store_message();
+      }
+    }
+    storer_.store_int(VECTOR_ID);
+    storer_.store_int(chat_count);
+    for (int i = 0; i < chat_count; i++) {
+      storer_.store_int(telegram_api::chatEmpty::ID);
+      storer_.store_int(random(1, 1000000));
+    }
+    store_users(user_count);
+  }
+
+ private:
+  static constexpr int32 VECTOR_ID = 0x1cb5c415;
+
+  StorerT &storer_;
+  Random::Xorshift128plus rnd_;
+  int32 date_ = 1600000000;
+  int32 message_id_ = 1000;
+  int32 pts_ = 100000;
+  int32 seq_ = 1;
+
+  int random(int from, int to) {
+    return rnd_.fast(from, to);
+  }
+
+  int32 random_user_id() {
+    return random(1, 1000000000);
+  }
+
+  string random_text(int max_length) {
+    string result(random(1, max_length), ' ');
+    for (auto &c : result) {
+      c = static_cast<char>(random(0, 4) == 0 ? ' ' : 'a' + random(0, 25));
+    }
+    return result;
+  }
+
+  void store_peer_user() {
+    storer_.store_int(telegram_api::peerUser::ID);
+    storer_.store_int(random_user_id());
+  }
+
+  void store_pts() {
+    storer_.store_int(++pts_);
+    storer_.store_int(1);
+  }
+
+  void store_message() {
+    bool has_entities = random(0, 3) == 0;
+    bool is_outgoing = random(0, 1) == 0;
+    int32 flags = (1 << 8) | (has_entities ? 1 << 7 : 0) | (is_outgoing ? 1 << 1 : 0);
+    storer_.store_int(telegram_api::message::ID);
+    storer_.store_int(flags);
+    storer_.store_int(++message_id_);
+    store_peer_user();
+    store_peer_user();
+    storer_.store_int(++date_);
+    storer_.store_string(random_text(200));
+    if (has_entities) {
+      int entity_count = random(1, 3);
+      storer_.store_int(VECTOR_ID);
+      storer_.store_int(entity_count);
+      for (int i = 0; i < entity_count; i++) {
+        storer_.store_int(random(0, 1) == 0 ? telegram_api::messageEntityBold::ID : telegram_api::messageEntityUrl::ID);
+        storer_.store_int(random(0, 10));
+        storer_.store_int(random(1, 10));
+      }
+    }
+  }
+
+  void store_message_service() {
+    storer_.store_int(telegram_api::messageService::ID);
+    storer_.store_int(1 << 8);
+    storer_.store_int(++message_id_);
+    store_peer_user();
+    store_peer_user();
+    storer_.store_int(++date_);
+    storer_.store_int(telegram_api::messageActionChatEditTitle::ID);
+    storer_.store_string(random_text(30));
+  }
+
+  void store_update() {
+    switch (random(0, 9)) {
+      case 0:
+      case 1:
+      case 2:
+        storer_.store_int(telegram_api::updateNewMessage::ID);
+        store_message();
+        store_pts();
+        break;
+      case 3:
+        storer_.store_int(telegram_api::updateEditMessage::ID);
+        store_message();
+        store_pts();
+        break;
+      case 4:
+        storer_.store_int(telegram_api::updateUserStatus::ID);
+        storer_.store_int(random_user_id());
+        storer_.store_int(telegram_api::userStatusOnline::ID);
+        storer_.store_int(date_ + 300);
+        break;
+      case 5:
+        storer_.store_int(telegram_api::updateUserTyping::ID);
+        storer_.store_int(random_user_id());
+        storer_.store_int(telegram_api::sendMessageTypingAction::ID);
+        break;
+      case 6:
+        storer_.store_int(telegram_api::updateReadHistoryInbox::ID);
+        storer_.store_int(0);
+        store_peer_user();
+        storer_.store_int(message_id_);
+        storer_.store_int(0);
+        store_pts();
+        break;
+      case 7:
+        storer_.store_int(telegram_api::updateReadHistoryOutbox::ID);
+        store_peer_user();
+        storer_.store_int(message_id_);
+        store_pts();
+        break;
+      case 8: {
+        int deleted_count = random(1, 5);
+        storer_.store_int(telegram_api::updateDeleteMessages::ID);
+        storer_.store_int(VECTOR_ID);
+        storer_.store_int(deleted_count);
+        for (int i = 0; i < deleted_count; i++) {
+          storer_.store_int(random(1, message_id_));
+        }
+        store_pts();
+        break;
+      }
+      case 9:
+        storer_.store_int(telegram_api::updateMessageID::ID);
+        storer_.store_int(++message_id_);
+        storer_.store_long(static_cast<int64>(rnd_()));
+        break;
+      default:
+        UNREACHABLE();
+    }
+  }
+
+  void store_users(int user_count) {
+    storer_.store_int(VECTOR_ID);
+    storer_.store_int(user_count);
+    for (int i = 0; i < user_count; i++) {
+      storer_.store_int(telegram_api::user::ID);
+      storer_.store_int((1 << 0) | (1 << 1) | (1 << 6));
+      storer_.store_int(random_user_id());
+      storer_.store_long(static_cast<int64>(rnd_()));
+      storer_.store_string(random_text(20));
+      storer_.store_int(telegram_api::userStatusOnline::ID);
+      storer_.store_int(date_ + 300);
+    }
+  }
+};
+
+template <class F>
+static BufferSlice create_blob(const F &store) {
+  TlStorerCalcLength calc_length;
+  TlBlobWriter<TlStorerCalcLength> calc_length_writer(calc_length, 123);
+  store(calc_length_writer);
+
+  BufferSlice result(calc_length.get_length());
+  auto ptr = result.as_slice().ubegin();
+  TlStorerUnsafe storer(ptr);
+  TlBlobWriter<TlStorerUnsafe> writer(storer, 123);
+  store(writer);
+  CHECK(storer.get_buf() == result.as_slice().uend());
+  return result;
+}
+
+static uint64 allocation_count = 0;
+
+template <class T>
+class TlFetchBench : public Benchmark {
+ public:
+  TlFetchBench(string description, BufferSlice blob, bool use_arena)
+      : description_(std::move(description)), blob_(std::move(blob)), use_arena_(use_arena) {
+    auto old_allocation_count = allocation_count;
+    fetch();
+    allocation_count_ = allocation_count - old_allocation_count;
+  }
+
+  string get_description() const override {
+    return PSTRING() << "Fetch " << description_ << " of size " << format::as_size(blob_.size())
+                     << (use_arena_ ? " using an arena" : "") << " with " << allocation_count_ << " allocations";
+  }
+
+  void run(int n) override {
+    size_t result = 0;
+    for (int i = 0; i < n; i++) {
+      result += fetch();
+    }
+    do_not_optimize_away(result);
+  }
+
+ private:
+  string description_;
+  BufferSlice blob_;
+  bool use_arena_;
+  uint64 allocation_count_ = 0;
+
+  int32 fetch_impl() {
+    TlBufferParser parser(&blob_);
+    auto object = T::fetch(parser);
+    parser.fetch_end();
+    parser.get_status().ensure();
+    return object->get_id();
+  }
+
+  int32 fetch() {
+    if (use_arena_) {
+      ObjectArena::Guard arena_guard;
+      return fetch_impl();
+    }
+    return fetch_impl();
+  }
+};
+
+}  // namespace td
+
+void *operator new(std::size_t size) {
+  td::allocation_count++;
+  auto result = std::malloc(size);
+  if (result == nullptr) {
+    throw std::bad_alloc();
+  }
+  return result;
+}
+
+void operator delete(void *ptr) noexcept {
+  std::free(ptr);
+}
+
+int main() {
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+
+  for (auto use_arena : {false, true}) {
+    td::bench(td::TlFetchBench<td::telegram_api::Updates>(
+        "updates with 100 updates", td::create_blob([](auto &writer) { writer.store_updates(100, 20); }), use_arena));
+    td::bench(td::TlFetchBench<td::telegram_api::Updates>(
+        "updates with 5 updates", td::create_blob([](auto &writer) { writer.store_updates(5, 2); }), use_arena));
+    td::bench(td::TlFetchBench<td::telegram_api::messages_Messages>(
+        "messages.messages with 100 messages",
+        td::create_blob([](auto &writer) { writer.store_messages(100, 5, 50); }), use_arena));
+  }
+}
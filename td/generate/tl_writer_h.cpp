@@ -218,9 +218,19 @@ std::string TD_TL_writer_h::gen_forward_class_declaration(const std::string &cla
 
 std::string TD_TL_writer_h::gen_class_begin(const std::string &class_name, const std::string &base_class_name,
                                             bool is_proxy) const {
-  return "class " + class_name + (!is_proxy ? " final " : "") + ": public " + base_class_name +
-         " {\n"
-         " public:\n";
+  std::string result = "class " + class_name + (!is_proxy ? " final " : "") + ": public " + base_class_name +
+                       " {\n"
+                       " public:\n";
+  if (is_proxy && class_name == gen_base_type_class_name(0) && is_object_arena_allocated()) {
+    result +=
+        "  static void *operator new(std::size_t size) {\n"
+        "    return ::td::ObjectArena::allocate(size);\n"
+        "  }\n\n"
+        "  static void operator delete(void *ptr) {\n"
+        "    ::td::ObjectArena::deallocate(ptr);\n"
+        "  }\n";
+  }
+  return result;
 }
 
 std::string TD_TL_writer_h::gen_class_end() const {
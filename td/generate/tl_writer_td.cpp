@@ -103,6 +103,10 @@ std::vector<std::string> TD_TL_writer::get_storers() const {
   return storers;
 }
 
+bool TD_TL_writer::is_object_arena_allocated() const {
+  return tl_name == "telegram_api";
+}
+
 std::string TD_TL_writer::gen_base_tl_class_name() const {
   return base_tl_class_name;
 }
@@ -24,6 +24,9 @@ class TD_TL_writer : public tl::TL_writer {
   const std::string string_type;
   const std::string bytes_type;
 
+  // whether memory for objects is allocated through ObjectArena, which allows to fetch them into an arena
+  bool is_object_arena_allocated() const;
+
  public:
   TD_TL_writer(const std::string &tl_name, const std::string &string_type, const std::string &bytes_type)
       : TL_writer(tl_name), string_type(string_type), bytes_type(bytes_type) {
@@ -45,6 +45,10 @@ class RawConnection {
       , transport_(create_transport(transport_type))
       , stats_callback_(std::move(stats_callback)) {
     transport_->init(&socket_fd_.input_buffer(), &socket_fd_.output_buffer());
+    // big packets, for example uploaded file parts, are sent without copying them to the kernel
+    if (socket_fd_.set_zero_copy(true).is_ok()) {
+      socket_fd_.set_zero_copy_threshold(ZERO_COPY_THRESHOLD);
+    }
   }
 
   void set_connection_token(StateManager::ConnectionToken connection_token) {
@@ -111,6 +115,8 @@ class RawConnection {
   double rtt_{0};
 
  private:
+  static constexpr size_t ZERO_COPY_THRESHOLD = 1 << 16;
+
   BufferedFd<SocketFd> socket_fd_;
   unique_ptr<IStreamTransport> transport_;
   std::map<uint32, uint64> quick_ack_to_token_;
@@ -346,6 +346,7 @@ Status SessionConnection::on_packet(const MsgInfo &info,
       LOG(WARNING) << bad_info << ": MessageId is too high. Session will be closed";
       // All this queries will be re-sent by parent
       to_send_.clear();
+      to_send_size_ = 0;
       callback_->on_session_failed(Status::Error("MessageId is too high"));
       return Status::Error("MessageId is too high");
     }
@@ -420,6 +421,9 @@ Status SessionConnection::on_packet(const MsgInfo &info, const mtproto_api::gzip
 Status SessionConnection::on_packet(const MsgInfo &info, const mtproto_api::pong &pong) {
   VLOG(mtproto) << "PONG";
   last_pong_at_ = Time::now_cached();
+  if (pong.ping_id_ == cur_ping_id_ && last_ping_at_ > 0) {
+    last_pong_rtt_ = last_pong_at_ - last_ping_at_;
+  }
   return callback_->on_pong();
 }
 Status SessionConnection::on_packet(const MsgInfo &info, const mtproto_api::future_salts &salts) {
@@ -760,6 +764,11 @@ Result<uint64> SessionConnection::send_query(BufferSlice buffer, bool gzip_flag,
   if (to_send_.empty()) {
     send_before(Time::now_cached() + QUERY_DELAY);
   }
+  to_send_size_ += buffer.size();
+  if (to_send_size_ >= CONTAINER_TARGET_SIZE || to_send_.size() + 1 >= MAX_CONTAINER_QUERIES) {
+    // there is enough data for a full container, so there is no reason to wait for more queries
+    send_before(Time::now_cached());
+  }
   to_send_.push_back(MtprotoQuery{message_id, seq_no, std::move(buffer), gzip_flag, invoke_after_id, use_quick_ack});
   VLOG(mtproto) << "Invoke query " << message_id << " of size " << to_send_.back().packet.size() << " with seq_no "
                 << seq_no << " after " << invoke_after_id << (use_quick_ack ? " with quick ack" : "");
@@ -769,7 +778,8 @@ Result<uint64> SessionConnection::send_query(BufferSlice buffer, bool gzip_flag,
 
 void SessionConnection::get_state_info(int64 message_id) {
   if (to_get_state_info_.empty()) {
-    send_before(Time::now_cached());
+    // msgs_state_req is sent with a small delay to be packed into the same container with other pending queries
+    send_before(Time::now_cached() + RESEND_ANSWER_DELAY);
   }
   to_get_state_info_.push_back(message_id);
 }
@@ -881,17 +891,29 @@ void SessionConnection::flush_packet() {
   }
 
   size_t send_till = 0, send_size = 0;
-  // send at most 1020 queries, of total size 2^15
+  // send at most MAX_CONTAINER_QUERIES queries, of total size MAX_CONTAINER_SIZE
+  // if all pending queries don't fit in one container, split them into containers of almost equal size
+  // to avoid sending a tiny tail container
   // don't send anything if have no salt
   if (has_salt) {
-    while (send_till < to_send_.size() && send_till < 1020 && send_size < (1 << 15)) {
+    auto container_count = td::max((to_send_size_ + MAX_CONTAINER_SIZE - 1) / MAX_CONTAINER_SIZE,
+                                   (to_send_.size() + MAX_CONTAINER_QUERIES - 1) / MAX_CONTAINER_QUERIES);
+    auto max_send_size = MAX_CONTAINER_SIZE;
+    if (container_count > 1) {
+      max_send_size = (to_send_size_ + container_count - 1) / container_count;
+    }
+    while (send_till < to_send_.size() && send_till < MAX_CONTAINER_QUERIES && send_size < max_send_size) {
       send_size += to_send_[send_till].packet.size();
       send_till++;
     }
   }
   std::vector<MtprotoQuery> queries;
+  CHECK(send_size <= to_send_size_);
+  to_send_size_ -= send_size;
   if (send_till == to_send_.size()) {
+    CHECK(to_send_size_ == 0);
     queries = std::move(to_send_);
+    to_send_.clear();
   } else if (send_till != 0) {
     queries.reserve(send_till);
     std::move(to_send_.begin(), to_send_.begin() + send_till, std::back_inserter(queries));
@@ -927,8 +949,8 @@ void SessionConnection::flush_packet() {
   // no more than 8192 ids per container..
   auto to_resend_answer = cut_tail(to_resend_answer_, 8192, "resend_answer");
   uint64 resend_answer_id = 0;
-  CHECK(queries.size() <= 1020);
-  auto to_cancel_answer = cut_tail(to_cancel_answer_, 1020 - queries.size(), "cancel_answer");
+  CHECK(queries.size() <= MAX_CONTAINER_QUERIES);
+  auto to_cancel_answer = cut_tail(to_cancel_answer_, MAX_CONTAINER_QUERIES - queries.size(), "cancel_answer");
   auto to_get_state_info = cut_tail(to_get_state_info_, 8192, "get_state_info");
   uint64 get_state_info_id = 0;
   auto to_ack = cut_tail(to_ack_, 8192, "ack");
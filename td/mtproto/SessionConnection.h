@@ -87,6 +87,11 @@ class SessionConnection
 
   void set_online(bool online_flag, bool is_main);
 
+  // time between sending of the last answered ping and receiving of its pong; 0 if unknown
+  double get_pong_rtt() const {
+    return last_pong_rtt_;
+  }
+
   // Callback
   class Callback {
    public:
@@ -128,6 +133,13 @@ class SessionConnection
   static constexpr double QUERY_DELAY = 0.001;          // 0.001s
   static constexpr double RESEND_ANSWER_DELAY = 0.001;  // 0.001s
 
+  // queries are packed into containers of at most MAX_CONTAINER_QUERIES queries and MAX_CONTAINER_SIZE bytes;
+  // a container is flushed without waiting for QUERY_DELAY as soon as CONTAINER_TARGET_SIZE bytes are pending,
+  // which is about the payload of a full TLS record
+  static constexpr size_t MAX_CONTAINER_QUERIES = 1020;
+  static constexpr size_t MAX_CONTAINER_SIZE = 1 << 15;
+  static constexpr size_t CONTAINER_TARGET_SIZE = (1 << 14) - 512;
+
   bool online_flag_ = false;
   bool is_main_ = false;
 
@@ -159,6 +171,7 @@ class SessionConnection
   static constexpr int TEMP_KEY_TIMEOUT = 60 * 60 * 24;  // one day
 
   vector<MtprotoQuery> to_send_;
+  size_t to_send_size_ = 0;
   vector<int64> to_ack_;
   double force_send_at_ = 0;
 
@@ -177,6 +190,7 @@ class SessionConnection
   double last_read_at_ = 0;
   double last_ping_at_ = 0;
   double last_pong_at_ = 0;
+  double last_pong_rtt_ = 0;
   int64 cur_ping_id_ = 0;
   uint64 last_ping_message_id_ = 0;
   uint64 last_ping_container_id_ = 0;
@@ -778,7 +778,7 @@ void CallActor::on_get_call_config_result(NetQueryPtr net_query) {
   if (res.is_error()) {
     return on_error(res.move_as_error());
   }
-  call_state_.config = res.ok()->data_;
+  call_state_.config = std::move(res.ok_ref()->data_);
   call_state_has_config_ = true;
 }
 
@@ -87,8 +87,10 @@ class ClientManager::Impl final {
       concurrent_scheduler_->start();
     }
     auto client_id = ++client_id_;
+    auto options = options_;
+    options.client_id = client_id;
     tds_[client_id] =
-        concurrent_scheduler_->create_actor_unsafe<Td>(0, "Td", receiver_.create_callback(client_id), options_);
+        concurrent_scheduler_->create_actor_unsafe<Td>(0, "Td", receiver_.create_callback(client_id), options);
     return client_id;
   }
 
@@ -235,7 +237,9 @@ class MultiTd : public Actor {
     auto context = std::make_shared<ActorContext>();
     auto old_context = set_context(context);
     auto old_tag = set_tag(to_string(td_id));
-    td = create_actor<Td>("Td", std::move(callback), options_);
+    auto options = options_;
+    options.client_id = td_id;
+    td = create_actor<Td>("Td", std::move(callback), std::move(options));
     set_context(old_context);
     set_tag(old_tag);
   }
@@ -8,6 +8,7 @@
 
 #include "td/telegram/ConfigShared.h"
 #include "td/telegram/Global.h"
+#include "td/telegram/LanguageStrings.h"
 #include "td/telegram/logevent/LogEvent.h"
 #include "td/telegram/misc.h"
 #include "td/telegram/net/NetQueryDispatcher.h"
@@ -29,32 +30,22 @@
 #include <atomic>
 #include <limits>
 #include <map>
+#include <memory>
 #include <unordered_set>
 #include <utility>
 
 namespace td {
 
-struct LanguagePackManager::PluralizedString {
-  string zero_value_;
-  string one_value_;
-  string two_value_;
-  string few_value_;
-  string many_value_;
-  string other_value_;
-};
-
 struct LanguagePackManager::Language {
   std::mutex mutex_;
   std::atomic<int32> version_{-1};
   std::atomic<int32> key_count_{0};
   std::string base_language_code_;
-  bool is_full_ = false;
   bool was_loaded_full_ = false;
   bool has_get_difference_query_ = false;
   vector<Promise<Unit>> get_difference_queries_;
-  std::unordered_map<string, string> ordinary_strings_;
-  std::unordered_map<string, PluralizedString> pluralized_strings_;
-  std::unordered_set<string> deleted_strings_;
+  // can be read without locking the mutex using get_language_strings; changes must be done under the mutex
+  std::shared_ptr<const LanguageStrings> strings_ = std::make_shared<LanguageStrings>();
   SqliteKeyValue kv_;  // usages should be guarded by database_->mutex_
 };
 
@@ -644,9 +635,14 @@ LanguagePackManager::Language *LanguagePackManager::add_language(LanguageDatabas
   return code_it->second.get();
 }
 
-bool LanguagePackManager::language_has_string_unsafe(const Language *language, const string &key) {
-  return language->ordinary_strings_.count(key) != 0 || language->pluralized_strings_.count(key) != 0 ||
-         language->deleted_strings_.count(key) != 0;
+std::shared_ptr<const LanguageStrings> LanguagePackManager::get_language_strings(
+    const Language *language) {
+  return std::atomic_load(&language->strings_);
+}
+
+void LanguagePackManager::set_language_strings(Language *language, std::shared_ptr<const LanguageStrings> strings) {
+  // language->mutex_ must be locked by the caller
+  std::atomic_store(&language->strings_, std::move(strings));
 }
 
 bool LanguagePackManager::language_has_strings(Language *language, const vector<string> &keys) {
@@ -654,41 +650,31 @@ bool LanguagePackManager::language_has_strings(Language *language, const vector<
     return false;
   }
 
-  std::lock_guard<std::mutex> lock(language->mutex_);
-  if (language->is_full_) {
+  auto strings = get_language_strings(language);
+  if (strings->is_full()) {
     return true;
   }
   if (keys.empty()) {
     return false;  // language is already checked to be not full
   }
   for (auto &key : keys) {
-    if (!language_has_string_unsafe(language, key)) {
+    if (strings->get_value(key).empty()) {
       return false;
     }
   }
   return true;
 }
 
-void LanguagePackManager::load_language_string_unsafe(Language *language, const string &key, const string &value) {
-  CHECK(is_valid_key(key));
+string LanguagePackManager::get_database_string_value(const string &value) {
   if (value[0] == '1') {
-    language->ordinary_strings_.emplace(key, value.substr(1));
-    return;
+    return value;
   }
-
-  if (value[0] == '2') {
-    auto all = full_split(Slice(value).substr(1), '\x00');
-    if (all.size() == 6) {
-      language->pluralized_strings_.emplace(
-          key, PluralizedString{all[0].str(), all[1].str(), all[2].str(), all[3].str(), all[4].str(), all[5].str()});
-      return;
-    }
+  if (value[0] == '2' && full_split(Slice(value).substr(1), '\x00').size() == 6) {
+    return value;
   }
 
   LOG_IF(ERROR, !value.empty() && value != "3") << "Have invalid value \"" << value << '"';
-  if (!language->is_full_) {
-    language->deleted_strings_.insert(key);
-  }
+  return "3";
 }
 
 bool LanguagePackManager::load_language_strings(LanguageDatabase *database, Language *language,
@@ -699,7 +685,8 @@ bool LanguagePackManager::load_language_strings(LanguageDatabase *database, Lang
 
   std::lock_guard<std::mutex> database_lock(database->mutex_);
   std::lock_guard<std::mutex> language_lock(language->mutex_);
-  if (language->is_full_) {
+  auto strings = get_language_strings(language);
+  if (strings->is_full()) {
     LOG(DEBUG) << "The language pack is already full in memory";
     return true;
   }
@@ -708,6 +695,7 @@ bool LanguagePackManager::load_language_strings(LanguageDatabase *database, Lang
     return false;
   }
   LOG(DEBUG) << "Begin to load a language pack from database";
+  vector<std::pair<string, string>> loaded_strings;
   if (keys.empty()) {
     if (language->version_ == -1 && language->was_loaded_full_) {
       LOG(DEBUG) << "The language pack has already been loaded";
@@ -720,25 +708,22 @@ bool LanguagePackManager::load_language_strings(LanguageDatabase *database, Lang
         continue;
       }
 
-      if (!language_has_string_unsafe(language, str.first)) {
+      if (strings->get_value(str.first).empty()) {
         LOG(DEBUG) << "Load string with key " << str.first << " from database";
-        load_language_string_unsafe(language, str.first, str.second);
+        CHECK(is_valid_key(str.first));
+        loaded_strings.emplace_back(str.first, get_database_string_value(str.second));
       }
     }
     language->was_loaded_full_ = true;
 
-    if (language->version_ == -1) {
-      return false;
-    }
-
-    language->is_full_ = true;
-    language->deleted_strings_.clear();
-    return true;
+    bool is_full = language->version_ != -1;
+    set_language_strings(language, LanguageStrings::apply_changes(*strings, std::move(loaded_strings), is_full));
+    return is_full;
   }
 
   bool have_all = true;
   for (auto &key : keys) {
-    if (!language_has_string_unsafe(language, key)) {
+    if (strings->get_value(key).empty()) {
       auto value = language->kv_.get(key);
       if (value.empty()) {
         if (language->version_ == -1) {
@@ -750,77 +735,59 @@ bool LanguagePackManager::load_language_strings(LanguageDatabase *database, Lang
         // have full language in the database, so this string is just deleted
       }
       LOG(DEBUG) << "Load string with key " << key << " from database";
-      load_language_string_unsafe(language, key, value);
+      CHECK(is_valid_key(key));
+      loaded_strings.emplace_back(key, get_database_string_value(value));
     }
   }
+  if (!loaded_strings.empty()) {
+    set_language_strings(language, LanguageStrings::apply_changes(*strings, std::move(loaded_strings), false));
+  }
   return have_all;
 }
 
 td_api::object_ptr<td_api::LanguagePackStringValue> LanguagePackManager::get_language_pack_string_value_object(
-    const string &value) {
-  return td_api::make_object<td_api::languagePackStringValueOrdinary>(value);
-}
-
-td_api::object_ptr<td_api::LanguagePackStringValue> LanguagePackManager::get_language_pack_string_value_object(
-    const PluralizedString &value) {
-  return td_api::make_object<td_api::languagePackStringValuePluralized>(
-      value.zero_value_, value.one_value_, value.two_value_, value.few_value_, value.many_value_, value.other_value_);
-}
-
-td_api::object_ptr<td_api::LanguagePackStringValue> LanguagePackManager::get_language_pack_string_value_object() {
+    Slice value) {
+  if (!value.empty() && value[0] == '1') {
+    return td_api::make_object<td_api::languagePackStringValueOrdinary>(value.substr(1).str());
+  }
+  if (!value.empty() && value[0] == '2') {
+    auto all = full_split(value.substr(1), '\x00');
+    CHECK(all.size() == 6);
+    return td_api::make_object<td_api::languagePackStringValuePluralized>(
+        all[0].str(), all[1].str(), all[2].str(), all[3].str(), all[4].str(), all[5].str());
+  }
   return td_api::make_object<td_api::languagePackStringValueDeleted>();
 }
 
-td_api::object_ptr<td_api::languagePackString> LanguagePackManager::get_language_pack_string_object(
-    const std::pair<string, string> &str) {
-  return td_api::make_object<td_api::languagePackString>(str.first, get_language_pack_string_value_object(str.second));
-}
-
-td_api::object_ptr<td_api::languagePackString> LanguagePackManager::get_language_pack_string_object(
-    const std::pair<string, PluralizedString> &str) {
-  return td_api::make_object<td_api::languagePackString>(str.first, get_language_pack_string_value_object(str.second));
-}
-
-td_api::object_ptr<td_api::languagePackString> LanguagePackManager::get_language_pack_string_object(const string &str) {
-  return td_api::make_object<td_api::languagePackString>(str, get_language_pack_string_value_object());
+td_api::object_ptr<td_api::languagePackString> LanguagePackManager::get_language_pack_string_object(Slice key,
+                                                                                                    Slice value) {
+  return td_api::make_object<td_api::languagePackString>(key.str(), get_language_pack_string_value_object(value));
 }
 
 td_api::object_ptr<td_api::LanguagePackStringValue> LanguagePackManager::get_language_pack_string_value_object(
-    const Language *language, const string &key) {
-  CHECK(language != nullptr);
-  auto ordinary_it = language->ordinary_strings_.find(key);
-  if (ordinary_it != language->ordinary_strings_.end()) {
-    return get_language_pack_string_value_object(ordinary_it->second);
-  }
-  auto pluralized_it = language->pluralized_strings_.find(key);
-  if (pluralized_it != language->pluralized_strings_.end()) {
-    return get_language_pack_string_value_object(pluralized_it->second);
-  }
-  LOG_IF(ERROR, !language->is_full_ && language->deleted_strings_.count(key) == 0) << "Have no string for key " << key;
-  return get_language_pack_string_value_object();
-}
-
-td_api::object_ptr<td_api::languagePackString> LanguagePackManager::get_language_pack_string_object(
-    const Language *language, const string &key) {
-  return td_api::make_object<td_api::languagePackString>(key, get_language_pack_string_value_object(language, key));
+    const LanguageStrings *strings, const string &key) {
+  CHECK(strings != nullptr);
+  auto value = strings->get_value(key);
+  LOG_IF(ERROR, !strings->is_full() && value.empty()) << "Have no string for key " << key;
+  return get_language_pack_string_value_object(value);
 }
 
 td_api::object_ptr<td_api::languagePackStrings> LanguagePackManager::get_language_pack_strings_object(
     Language *language, const vector<string> &keys) {
   CHECK(language != nullptr);
 
-  std::lock_guard<std::mutex> lock(language->mutex_);
+  auto language_strings = get_language_strings(language);
   vector<td_api::object_ptr<td_api::languagePackString>> strings;
   if (keys.empty()) {
-    for (auto &str : language->ordinary_strings_) {
-      strings.push_back(get_language_pack_string_object(str));
-    }
-    for (auto &str : language->pluralized_strings_) {
-      strings.push_back(get_language_pack_string_object(str));
-    }
+    language_strings->for_each([&strings](Slice key, Slice value) {
+      if (!LanguageStrings::is_deleted_value(value)) {
+        strings.push_back(get_language_pack_string_object(key, value));
+      }
+    });
   } else {
     for (auto &key : keys) {
-      strings.push_back(get_language_pack_string_object(language, key));
+      strings.push_back(td_api::make_object<td_api::languagePackString>(
+          key, get_language_pack_string_value_object(language_strings.get(), key)));
     }
   }
 
@@ -1270,13 +1237,8 @@ td_api::object_ptr<td_api::Object> LanguagePackManager::get_language_pack_string
 
   Language *language = add_language(database, language_pack, language_code);
   vector<string> keys{key};
-  if (language_has_strings(language, keys)) {
-    std::lock_guard<std::mutex> lock(language->mutex_);
-    return get_language_pack_string_value_object(language, key);
-  }
-  if (load_language_strings(database, language, keys)) {
-    std::lock_guard<std::mutex> lock(language->mutex_);
-    return get_language_pack_string_value_object(language, key);
+  if (language_has_strings(language, keys) || load_language_strings(database, language, keys)) {
+    return get_language_pack_string_value_object(get_language_strings(language).get(), key);
   }
   return td_api::make_object<td_api::error>(404, "Not Found");
 }
@@ -1355,6 +1317,23 @@ void LanguagePackManager::on_get_language_pack_strings(
     std::lock_guard<std::mutex> lock(language->mutex_);
     int32 key_count_delta = 0;
     if (language->version_ < version || !keys.empty()) {
+      auto old_strings = get_language_strings(language);
+      std::unordered_map<string, bool> is_changed_key_present;  // whether a changed key has a non-deleted value
+      auto change_string = [&](string key, string value) {
+        bool is_present = !LanguageStrings::is_deleted_value(value);
+        bool was_present;
+        auto it = is_changed_key_present.find(key);
+        if (it != is_changed_key_present.end()) {
+          was_present = it->second;
+        } else {
+          auto old_value = old_strings->get_value(key);
+          was_present = !old_value.empty() && !LanguageStrings::is_deleted_value(old_value);
+        }
+        key_count_delta += static_cast<int32>(is_present) - static_cast<int32>(was_present);
+        is_changed_key_present[key] = is_present;
+        database_strings.emplace_back(std::move(key), std::move(value));
+      };
+
       vector<td_api::object_ptr<td_api::languagePackString>> strings;
       if (language->version_ < version) {
         LOG(INFO) << "Set language pack " << language_code << " version to " << version;
@@ -1368,69 +1347,39 @@ void LanguagePackManager::on_get_language_pack_strings(
         switch (result->get_id()) {
           case telegram_api::langPackString::ID: {
             auto str = static_cast<telegram_api::langPackString *>(result.get());
-            auto it = language->ordinary_strings_.find(str->key_);
-            if (it == language->ordinary_strings_.end()) {
-              key_count_delta++;
-              it = language->ordinary_strings_.emplace(str->key_, std::move(str->value_)).first;
-            } else {
-              it->second = std::move(str->value_);
-            }
-            key_count_delta -= static_cast<int32>(language->pluralized_strings_.erase(str->key_));
-            language->deleted_strings_.erase(str->key_);
-            if (is_diff) {
-              strings.push_back(get_language_pack_string_object(*it));
-            }
-            database_strings.emplace_back(str->key_, PSTRING() << '1' << it->second);
+            change_string(std::move(str->key_), PSTRING() << '1' << str->value_);
             break;
           }
           case telegram_api::langPackStringPluralized::ID: {
             auto str = static_cast<const telegram_api::langPackStringPluralized *>(result.get());
-            PluralizedString value{std::move(str->zero_value_), std::move(str->one_value_),
-                                   std::move(str->two_value_),  std::move(str->few_value_),
-                                   std::move(str->many_value_), std::move(str->other_value_)};
-            auto it = language->pluralized_strings_.find(str->key_);
-            if (it == language->pluralized_strings_.end()) {
-              key_count_delta++;
-              it = language->pluralized_strings_.emplace(str->key_, std::move(value)).first;
-            } else {
-              it->second = std::move(value);
-            }
-            key_count_delta -= static_cast<int32>(language->ordinary_strings_.erase(str->key_));
-            language->deleted_strings_.erase(str->key_);
-            if (is_diff) {
-              strings.push_back(get_language_pack_string_object(*it));
-            }
-            database_strings.emplace_back(
-                str->key_, PSTRING() << '2' << it->second.zero_value_ << '\x00' << it->second.one_value_ << '\x00'
-                                     << it->second.two_value_ << '\x00' << it->second.few_value_ << '\x00'
-                                     << it->second.many_value_ << '\x00' << it->second.other_value_);
+            change_string(std::move(str->key_), PSTRING() << '2' << str->zero_value_ << '\x00' << str->one_value_
+                                                          << '\x00' << str->two_value_ << '\x00' << str->few_value_
+                                                          << '\x00' << str->many_value_ << '\x00'
+                                                          << str->other_value_);
             break;
           }
           case telegram_api::langPackStringDeleted::ID: {
             auto str = static_cast<const telegram_api::langPackStringDeleted *>(result.get());
-            key_count_delta -= static_cast<int32>(language->ordinary_strings_.erase(str->key_));
-            key_count_delta -= static_cast<int32>(language->pluralized_strings_.erase(str->key_));
-            language->deleted_strings_.insert(std::move(str->key_));
-            if (is_diff) {
-              strings.push_back(get_language_pack_string_object(str->key_));
-            }
-            database_strings.emplace_back(str->key_, "3");
+            change_string(std::move(str->key_), "3");
             break;
           }
           default:
             UNREACHABLE();
             break;
         }
+        if (is_diff) {
+          strings.push_back(get_language_pack_string_object(database_strings.back().first,
+                                                            database_strings.back().second));
+        }
       }
-      if (!language->is_full_) {
+      if (!old_strings->is_full()) {
         for (auto &key : keys) {
-          if (!language_has_string_unsafe(language, key)) {
+          if (old_strings->get_value(key).empty() && is_changed_key_present.count(key) == 0) {
             LOG(ERROR) << "Doesn't receive key " << key << " from server";
-            language->deleted_strings_.insert(key);
+            change_string(key, "3");
             if (is_diff) {
-              strings.push_back(get_language_pack_string_object(key));
+              strings.push_back(get_language_pack_string_object(key, "3"));
             }
-            database_strings.emplace_back(key, "3");
           }
         }
       }
@@ -1448,10 +1397,11 @@ void LanguagePackManager::on_get_language_pack_strings(
 
       if (keys.empty() && !is_diff) {
         CHECK(new_database_version >= 0);
-        language->is_full_ = true;
-        language->deleted_strings_.clear();
+        new_is_full = true;
+      } else {
+        new_is_full = old_strings->is_full();
       }
-      new_is_full = language->is_full_;
+      set_language_strings(language, LanguageStrings::apply_changes(*old_strings, database_strings, new_is_full));
     }
   }
   if (is_custom_language_code(language_code) && new_database_version == -1) {
@@ -1845,10 +1795,7 @@ Status LanguagePackManager::do_delete_language(string language_code) {
   std::lock_guard<std::mutex> language_lock(language->mutex_);
   language->version_ = -1;
   language->key_count_ = load_database_language_key_count(&language->kv_);
-  language->is_full_ = false;
-  language->ordinary_strings_.clear();
-  language->pluralized_strings_.clear();
-  language->deleted_strings_.clear();
+  set_language_strings(language, std::make_shared<LanguageStrings>());
 
   if (!pack->pack_kv_.empty()) {
     pack->pack_kv_.erase(language_code);
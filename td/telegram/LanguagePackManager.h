@@ -19,12 +19,14 @@
 #include "td/utils/Slice.h"
 #include "td/utils/Status.h"
 
+#include <memory>
 #include <mutex>
 #include <unordered_map>
 #include <utility>
 
 namespace td {
 
+class LanguageStrings;
 class SqliteKeyValue;
 
 class LanguagePackManager : public NetQueryCallback {
@@ -84,7 +86,6 @@ class LanguagePackManager : public NetQueryCallback {
   void delete_language(string language_code, Promise<Unit> &&promise);
 
  private:
-  struct PluralizedString;
   struct Language;
   struct LanguageInfo;
   struct LanguagePack;
@@ -115,28 +116,20 @@ class LanguagePackManager : public NetQueryCallback {
 
   static Language *add_language(LanguageDatabase *database, const string &language_pack, const string &language_code);
 
-  static bool language_has_string_unsafe(const Language *language, const string &key);
+  static std::shared_ptr<const LanguageStrings> get_language_strings(const Language *language);
+  static void set_language_strings(Language *language, std::shared_ptr<const LanguageStrings> strings);
+
   static bool language_has_strings(Language *language, const vector<string> &keys);
 
-  static void load_language_string_unsafe(Language *language, const string &key, const string &value);
+  static string get_database_string_value(const string &value);
   static bool load_language_strings(LanguageDatabase *database, Language *language, const vector<string> &keys);
 
-  static td_api::object_ptr<td_api::LanguagePackStringValue> get_language_pack_string_value_object(const string &value);
-  static td_api::object_ptr<td_api::LanguagePackStringValue> get_language_pack_string_value_object(
-      const PluralizedString &value);
-  static td_api::object_ptr<td_api::LanguagePackStringValue> get_language_pack_string_value_object();
+  static td_api::object_ptr<td_api::LanguagePackStringValue> get_language_pack_string_value_object(Slice value);
 
-  static td_api::object_ptr<td_api::languagePackString> get_language_pack_string_object(
-      const std::pair<string, string> &str);
-  static td_api::object_ptr<td_api::languagePackString> get_language_pack_string_object(
-      const std::pair<string, PluralizedString> &str);
-  static td_api::object_ptr<td_api::languagePackString> get_language_pack_string_object(const string &str);
+  static td_api::object_ptr<td_api::languagePackString> get_language_pack_string_object(Slice key, Slice value);
 
   static td_api::object_ptr<td_api::LanguagePackStringValue> get_language_pack_string_value_object(
-      const Language *language, const string &key);
-
-  static td_api::object_ptr<td_api::languagePackString> get_language_pack_string_object(const Language *language,
-                                                                                        const string &key);
+      const LanguageStrings *strings, const string &key);
 
   static td_api::object_ptr<td_api::languagePackStrings> get_language_pack_strings_object(Language *language,
                                                                                           const vector<string> &keys);
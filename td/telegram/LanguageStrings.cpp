@@ -0,0 +1,138 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/LanguageStrings.h"
+
+#include "td/utils/misc.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace td {
+
+constexpr size_t LanguageStrings::MIN_MAX_OVERLAY_SIZE;
+
+size_t LanguageStrings::Table::find(Slice key) const {
+  size_t left = 0;
+  size_t right = entries_.size();
+  while (left < right) {
+    auto middle = left + (right - left) / 2;
+    if (get_key(middle) < key) {
+      left = middle + 1;
+    } else {
+      right = middle;
+    }
+  }
+  if (left == entries_.size() || get_key(left) != key) {
+    return entries_.size();
+  }
+  return left;
+}
+
+std::shared_ptr<const LanguageStrings::Table> LanguageStrings::Table::merge(
+    const Table &old_table, const vector<std::pair<Slice, Slice>> &changes, bool drop_deleted) {
+  auto result = std::make_shared<Table>();
+  result->data_.reserve(old_table.data_.size());
+  result->entries_.reserve(old_table.entries_.size() + changes.size());
+  auto add_string = [&result, drop_deleted](Slice key, Slice value) {
+    if (drop_deleted && is_deleted_value(value)) {
+      return;
+    }
+    Entry entry;
+    entry.key_offset = narrow_cast<uint32>(result->data_.size());
+    entry.key_size = narrow_cast<uint32>(key.size());
+    entry.value_size = narrow_cast<uint32>(value.size());
+    result->data_.append(key.begin(), key.size());
+    result->data_.append(value.begin(), value.size());
+    result->entries_.push_back(entry);
+  };
+
+  size_t i = 0;
+  for (auto &change : changes) {
+    while (i < old_table.size() && old_table.get_key(i) < change.first) {
+      add_string(old_table.get_key(i), old_table.get_value(i));
+      i++;
+    }
+    if (i < old_table.size() && old_table.get_key(i) == change.first) {
+      i++;
+    }
+    add_string(change.first, change.second);
+  }
+  for (; i < old_table.size(); i++) {
+    add_string(old_table.get_key(i), old_table.get_value(i));
+  }
+  result->data_.shrink_to_fit();
+  return std::move(result);
+}
+
+LanguageStrings::LanguageStrings() : table_(std::make_shared<Table>()), overlay_(table_) {
+}
+
+Slice LanguageStrings::get_value(Slice key) const {
+  auto pos = overlay_->find(key);
+  if (pos != overlay_->size()) {
+    return overlay_->get_value(pos);
+  }
+  pos = table_->find(key);
+  if (pos != table_->size()) {
+    return table_->get_value(pos);
+  }
+  return Slice();
+}
+
+size_t LanguageStrings::get_max_overlay_size(size_t table_size) {
+  // adding of k strings costs O(k + sqrt(N)) amortized, where N is the total number of strings
+  return max(MIN_MAX_OVERLAY_SIZE, static_cast<size_t>(std::sqrt(static_cast<double>(table_size))));
+}
+
+std::shared_ptr<const LanguageStrings> LanguageStrings::apply_changes(const LanguageStrings &old_strings,
+                                                                      vector<std::pair<string, string>> changes,
+                                                                      bool is_full) {
+  std::stable_sort(changes.begin(), changes.end(),
+                   [](const std::pair<string, string> &lhs, const std::pair<string, string> &rhs) {
+                     return lhs.first < rhs.first;
+                   });
+  vector<std::pair<Slice, Slice>> sorted_changes;
+  sorted_changes.reserve(changes.size());
+  for (size_t i = 0; i < changes.size(); i++) {
+    if (i + 1 < changes.size() && changes[i + 1].first == changes[i].first) {
+      continue;
+    }
+    sorted_changes.emplace_back(changes[i].first, changes[i].second);
+  }
+
+  auto result = std::make_shared<LanguageStrings>();
+  result->is_full_ = is_full;
+  const Table &overlay = *old_strings.overlay_;
+  if (!is_full && overlay.size() + sorted_changes.size() <= get_max_overlay_size(old_strings.table_->size())) {
+    result->table_ = old_strings.table_;
+    result->overlay_ = Table::merge(overlay, sorted_changes, false);
+    return std::move(result);
+  }
+
+  // the overlay is merged into the table together with the changes, which take precedence
+  vector<std::pair<Slice, Slice>> all_changes;
+  all_changes.reserve(overlay.size() + sorted_changes.size());
+  size_t i = 0;
+  for (auto &change : sorted_changes) {
+    while (i < overlay.size() && overlay.get_key(i) < change.first) {
+      all_changes.emplace_back(overlay.get_key(i), overlay.get_value(i));
+      i++;
+    }
+    if (i < overlay.size() && overlay.get_key(i) == change.first) {
+      i++;
+    }
+    all_changes.push_back(change);
+  }
+  for (; i < overlay.size(); i++) {
+    all_changes.emplace_back(overlay.get_key(i), overlay.get_value(i));
+  }
+  result->table_ = Table::merge(*old_strings.table_, all_changes, is_full);
+  result->overlay_ = std::make_shared<Table>();
+  return std::move(result);
+}
+
+}  // namespace td
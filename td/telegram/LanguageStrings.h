@@ -0,0 +1,111 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/Slice.h"
+
+#include <memory>
+#include <utility>
+
+namespace td {
+
+// Immutable snapshot of strings of a language, which can be read without locks.
+// Values are stored in the same format as in the database: '1' and the value for ordinary strings,
+// '2' and 6 values separated by '\x00' for pluralized strings and '3' for deleted strings.
+// Strings, which are loaded by small batches, are added to a small overlay table, which is merged into the main table
+// only when it becomes too big, so loading of a string doesn't copy all other strings.
+class LanguageStrings {
+  // table of strings, sorted by key
+  class Table {
+   public:
+    size_t size() const {
+      return entries_.size();
+    }
+
+    Slice get_key(size_t i) const {
+      return Slice(data_).substr(entries_[i].key_offset, entries_[i].key_size);
+    }
+
+    Slice get_value(size_t i) const {
+      return Slice(data_).substr(entries_[i].key_offset + entries_[i].key_size, entries_[i].value_size);
+    }
+
+    // returns size() if there is no such key
+    size_t find(Slice key) const;
+
+    // changes must be sorted by key and have no duplicate keys
+    static std::shared_ptr<const Table> merge(const Table &old_table, const vector<std::pair<Slice, Slice>> &changes,
+                                              bool drop_deleted);
+
+   private:
+    struct Entry {
+      uint32 key_offset;
+      uint32 key_size;
+      uint32 value_size;  // the value is stored right after the key
+    };
+    string data_;
+    vector<Entry> entries_;
+  };
+
+ public:
+  static constexpr size_t MIN_MAX_OVERLAY_SIZE = 64;
+
+  LanguageStrings();
+
+  // if the language is full, then all its strings are known and deleted strings may be not stored
+  bool is_full() const {
+    return is_full_;
+  }
+
+  // returns empty value if the string is unknown
+  Slice get_value(Slice key) const;
+
+  size_t get_overlay_size() const {
+    return overlay_->size();
+  }
+
+  // calls f(key, value) for all strings in the order of keys
+  template <class F>
+  void for_each(F &&f) const {
+    const Table &table = *table_;
+    const Table &overlay = *overlay_;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < table.size() || j < overlay.size()) {
+      if (j == overlay.size() || (i < table.size() && table.get_key(i) < overlay.get_key(j))) {
+        f(table.get_key(i), table.get_value(i));
+        i++;
+      } else {
+        if (i < table.size() && table.get_key(i) == overlay.get_key(j)) {
+          i++;
+        }
+        f(overlay.get_key(j), overlay.get_value(j));
+        j++;
+      }
+    }
+  }
+
+  static bool is_deleted_value(Slice value) {
+    return value == "3";
+  }
+
+  // returns the strings with applied changes, leaving the old strings unmodified; later changes of a key take
+  // precedence
+  static std::shared_ptr<const LanguageStrings> apply_changes(const LanguageStrings &old_strings,
+                                                              vector<std::pair<string, string>> changes,
+                                                              bool is_full);
+
+ private:
+  std::shared_ptr<const Table> table_;
+  std::shared_ptr<const Table> overlay_;  // strings from the overlay take precedence over the strings from the table
+  bool is_full_ = false;
+
+  static size_t get_max_overlay_size(size_t table_size);
+};
+
+}  // namespace td
@@ -15,6 +15,8 @@
 #include "td/telegram/TdDb.h"
 
 #include "td/db/SqliteDb.h"
+#include "td/db/SqliteKeyValue.h"
+#include "td/db/SqliteKeyValueAsync.h"
 
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
@@ -39,9 +41,11 @@ void StorageManager::start_up() {
   schedule_next_gc();
 
   load_fast_stat();
+  load_file_stats_index();
 }
 
-void StorageManager::on_new_file(int64 size, int64 real_size, int32 cnt) {
+void StorageManager::on_new_file(FileType file_type, DialogId owner_dialog_id, int64 size, int64 real_size,
+                                 int32 cnt) {
   LOG(INFO) << "Add " << cnt << " file of size " << size << " with real size " << real_size
             << " to fast storage statistics";
   fast_stat_.cnt += cnt;
@@ -57,6 +61,17 @@ void StorageManager::on_new_file(int64 size, int64 real_size, int32 cnt) {
     fast_stat_ = FileTypeStat();
   }
   save_fast_stat();
+  if (cnt > 0) {
+    schedule_overflow_gc();
+  }
+
+  if (file_stats_index_.get_date() != 0) {
+    file_stats_index_.add(owner_dialog_id, file_type, add_size, cnt);
+    is_file_stats_index_changed_ = true;
+    if (Time::now() >= next_file_stats_index_save_at_) {
+      save_file_stats_index();
+    }
+  }
 }
 
 void StorageManager::get_storage_stats(bool need_all_files, int32 dialog_limit, Promise<FileStats> promise) {
@@ -72,6 +87,12 @@ void StorageManager::get_storage_stats(bool need_all_files, int32 dialog_limit,
     //TODO group same queries
     close_stats_worker();
   }
+  if (!need_all_files && is_file_stats_index_fresh()) {
+    bool split_by_owner_dialog_id = dialog_limit != 0 && G()->parameters().use_chat_info_db;
+    std::vector<Promise<FileStats>> promises;
+    promises.push_back(std::move(promise));
+    return send_stats(file_stats_index_.get_file_stats(split_by_owner_dialog_id), dialog_limit, std::move(promises));
+  }
   if (!pending_run_gc_[0].empty() || !pending_run_gc_[1].empty()) {
     close_gc_worker();
   }
@@ -79,8 +100,10 @@ void StorageManager::get_storage_stats(bool need_all_files, int32 dialog_limit,
   stats_need_all_files_ = need_all_files;
   pending_storage_stats_.emplace_back(std::move(promise));
 
+  // without all files the full scan is needed only to rebuild the index, which must be split by owner dialog
+  bool split_by_owner_dialog_id = !need_all_files || stats_dialog_limit_ != 0;
   create_stats_worker();
-  send_closure(stats_worker_, &FileStatsWorker::get_stats, need_all_files, stats_dialog_limit_ != 0,
+  send_closure(stats_worker_, &FileStatsWorker::get_stats, need_all_files, split_by_owner_dialog_id,
                PromiseCreator::lambda(
                    [actor_id = actor_id(this), stats_generation = stats_generation_](Result<FileStats> file_stats) {
                      send_closure(actor_id, &StorageManager::on_file_stats, std::move(file_stats), stats_generation);
@@ -141,6 +164,12 @@ void StorageManager::on_file_stats(Result<FileStats> r_file_stats, uint32 genera
   }
 
   update_fast_stats(r_file_stats.ok());
+  reset_file_stats_index(r_file_stats.ok());
+  if (!stats_need_all_files_) {
+    bool split_by_owner_dialog_id = stats_dialog_limit_ != 0 && G()->parameters().use_chat_info_db;
+    return send_stats(file_stats_index_.get_file_stats(split_by_owner_dialog_id), stats_dialog_limit_,
+                      std::move(pending_storage_stats_));
+  }
   send_stats(r_file_stats.move_as_ok(), stats_dialog_limit_, std::move(pending_storage_stats_));
 }
 
@@ -228,6 +257,8 @@ void StorageManager::on_gc_finished(int32 dialog_limit, Result<FileGcResult> r_f
   }
 
   update_fast_stats(r_file_gc_result.ok().kept_file_stats_);
+  // deleted files can't be attributed to owner dialogs, if the statistics aren't split
+  reset_file_stats_index(r_file_gc_result.ok().kept_file_stats_);
 
   auto kept_file_promises = std::move(pending_run_gc_[0]);
   auto removed_file_promises = std::move(pending_run_gc_[1]);
@@ -247,6 +278,47 @@ void StorageManager::load_fast_stat() {
   LOG(INFO) << "Loaded fast storage statistics with " << fast_stat_.cnt << " files of total size " << fast_stat_.size;
 }
 
+bool StorageManager::is_file_stats_index_fresh() const {
+  auto date = file_stats_index_.get_date();
+  return date != 0 && Clocks::system() < date + static_cast<double>(FILE_STATS_INDEX_CHECK_PERIOD);
+}
+
+void StorageManager::reset_file_stats_index(const FileStats &stats) {
+  if (stats.split_by_owner_dialog_id || !G()->parameters().use_chat_info_db) {
+    file_stats_index_.reset(stats, static_cast<uint32>(Clocks::system()));
+  } else {
+    file_stats_index_ = FileStatsIndex();
+  }
+  LOG(INFO) << "Reset file statistics index";
+  is_file_stats_index_changed_ = true;
+  save_file_stats_index();
+}
+
+void StorageManager::save_file_stats_index() {
+  if (!is_file_stats_index_changed_) {
+    return;
+  }
+  is_file_stats_index_changed_ = false;
+  next_file_stats_index_save_at_ = Time::now() + FILE_STATS_INDEX_SAVE_DELAY;
+  if (!G()->parameters().use_file_db) {
+    // the whole index is rewritten on every save, so it isn't stored in the binlog and is kept only in memory
+    return;
+  }
+  G()->td_db()->get_sqlite_pmc()->set("file_stats_index", log_event_store(file_stats_index_).as_slice().str(),
+                                      Auto());
+}
+
+void StorageManager::load_file_stats_index() {
+  if (!G()->parameters().use_file_db) {
+    return;
+  }
+  auto status = log_event_parse(file_stats_index_, G()->td_db()->get_sqlite_sync_pmc()->get("file_stats_index"));
+  if (status.is_error()) {
+    file_stats_index_ = FileStatsIndex();
+  }
+  LOG(INFO) << "Loaded file statistics index from " << file_stats_index_.get_date();
+}
+
 void StorageManager::update_fast_stats(const FileStats &stats) {
   fast_stat_ = stats.get_total_nontemp_stat();
   LOG(INFO) << "Recalculate fast storage statistics to " << fast_stat_.cnt << " files of total size "
@@ -308,6 +380,7 @@ void StorageManager::close_gc_worker() {
 
 void StorageManager::hangup() {
   is_closed_ = true;
+  save_file_stats_index();
   close_stats_worker();
   close_gc_worker();
   hangup_shared();
@@ -349,6 +422,30 @@ void StorageManager::schedule_next_gc() {
   set_timeout_at(next_gc_at_);
 }
 
+void StorageManager::schedule_overflow_gc() {
+  if (next_gc_at_ == 0) {
+    // storage optimizer is disabled or files gc is already running
+    return;
+  }
+  // the scheduled files gc uses limits from the storage_* options, so a one-off request doesn't change them
+  if (fast_stat_.size <= FileGcParameters().max_files_size) {
+    return;
+  }
+
+  // keep files under the limit without waiting for the daily files gc
+  auto sys_time = static_cast<uint32>(Clocks::system());
+  uint32 next_gc_in = GC_DELAY;
+  if (last_gc_timestamp_ + GC_OVERFLOW_DELAY > sys_time + next_gc_in) {
+    next_gc_in = last_gc_timestamp_ + GC_OVERFLOW_DELAY - sys_time;
+  }
+  auto next_gc_at = Time::now() + next_gc_in;
+  if (next_gc_at < next_gc_at_) {
+    LOG(INFO) << "Schedule next file gc in " << next_gc_in << " because files have size " << fast_stat_.size;
+    next_gc_at_ = next_gc_at;
+    set_timeout_at(next_gc_at_);
+  }
+}
+
 void StorageManager::timeout_expired() {
   if (next_gc_at_ == 0) {
     return;
@@ -9,9 +9,11 @@
 #include "td/actor/actor.h"
 #include "td/actor/PromiseFuture.h"
 
+#include "td/telegram/DialogId.h"
 #include "td/telegram/files/FileGcWorker.h"
 #include "td/telegram/files/FileStats.h"
 #include "td/telegram/files/FileStatsWorker.h"
+#include "td/telegram/files/FileType.h"
 #include "td/telegram/td_api.h"
 
 #include "td/utils/CancellationToken.h"
@@ -38,12 +40,14 @@ class StorageManager : public Actor {
   void run_gc(FileGcParameters parameters, bool return_deleted_file_statistics, Promise<FileStats> promise);
   void update_use_storage_optimizer();
 
-  void on_new_file(int64 size, int64 real_size, int32 cnt);
+  void on_new_file(FileType file_type, DialogId owner_dialog_id, int64 size, int64 real_size, int32 cnt);
 
  private:
   static constexpr int GC_EACH = 60 * 60 * 24;  // 1 day
   static constexpr int GC_DELAY = 60;
   static constexpr int GC_RAND_DELAY = 60 * 15;
+  // minimal interval between files gc, started because the files exceeded storage_max_files_size
+  static constexpr int GC_OVERFLOW_DELAY = 60 * 60;  // 1 hour
 
   ActorShared<> parent_;
 
@@ -58,6 +62,13 @@ class StorageManager : public Actor {
 
   FileTypeStat fast_stat_;
 
+  // storage statistics are returned from the index, unless it is older than FILE_STATS_INDEX_CHECK_PERIOD
+  static constexpr int32 FILE_STATS_INDEX_CHECK_PERIOD = 60 * 60 * 24;  // 1 day
+  static constexpr int32 FILE_STATS_INDEX_SAVE_DELAY = 60;
+  FileStatsIndex file_stats_index_;
+  bool is_file_stats_index_changed_ = false;
+  double next_file_stats_index_save_at_ = 0;
+
   CancellationTokenSource stats_cancellation_token_source_;
   CancellationTokenSource gc_cancellation_token_source_;
 
@@ -68,6 +79,12 @@ class StorageManager : public Actor {
 
   void save_fast_stat();
   void load_fast_stat();
+
+  bool is_file_stats_index_fresh() const;
+  void reset_file_stats_index(const FileStats &stats);
+  void save_file_stats_index();
+  void load_file_stats_index();
+
   static int64 get_database_size();
   static int64 get_language_pack_database_size();
   static int64 get_log_size();
@@ -98,6 +115,7 @@ class StorageManager : public Actor {
   uint32 load_last_gc_timestamp();
   void save_last_gc_timestamp();
   void schedule_next_gc();
+  void schedule_overflow_gc();
 
   void timeout_expired() override;
 };
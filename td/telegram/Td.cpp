@@ -104,6 +104,7 @@
 
 #include "td/actor/actor.h"
 #include "td/actor/PromiseFuture.h"
+#include "td/actor/SchedulerMetrics.h"
 
 #include "td/db/binlog/BinlogEvent.h"
 
@@ -127,8 +128,10 @@
 #include "td/utils/Random.h"
 #include "td/utils/Slice.h"
 #include "td/utils/Status.h"
+#include "td/utils/Time.h"
 #include "td/utils/Timer.h"
 #include "td/utils/tl_parsers.h"
+#include "td/utils/TraceRecorder.h"
 #include "td/utils/utf8.h"
 
 #include <cmath>
@@ -3334,6 +3337,9 @@ bool Td::is_synchronous_request(int32 id) {
     case td_api::setLogTagVerbosityLevel::ID:
     case td_api::getLogTagVerbosityLevel::ID:
     case td_api::addLogMessage::ID:
+    case td_api::setRequestTracing::ID:
+    case td_api::getRequestTrace::ID:
+    case td_api::getSchedulerMetrics::ID:
     case td_api::testReturnError::ID:
       return true;
     default:
@@ -3446,6 +3452,12 @@ void Td::request(uint64 id, tl_object_ptr<td_api::Function> function) {
     return send_error_impl(id, make_error(400, "Request is empty"));
   }
 
+  uint64 trace_id = 0;
+  if (TraceRecorder::is_enabled()) {
+    trace_id = start_request_trace(id, *function);
+  }
+  TraceIdGuard trace_id_guard(trace_id);
+
   VLOG(td_requests) << "Receive request " << id << ": " << to_string(function);
   int32 function_id = function->get_id();
   if (is_synchronous_request(function_id)) {
@@ -4438,8 +4450,9 @@ void Td::init_file_manager() {
     explicit FileManagerContext(Td *td) : td_(td) {
     }
 
-    void on_new_file(int64 size, int64 real_size, int32 cnt) final {
-      send_closure(G()->storage_manager(), &StorageManager::on_new_file, size, real_size, cnt);
+    void on_new_file(FileType file_type, DialogId owner_dialog_id, int64 size, int64 real_size, int32 cnt) final {
+      send_closure(G()->storage_manager(), &StorageManager::on_new_file, file_type, owner_dialog_id, size, real_size,
+                   cnt);
     }
 
     void on_file_updated(FileId file_id) final {
@@ -4600,6 +4613,9 @@ void Td::send_result(uint64 id, tl_object_ptr<td_api::Object> object) {
   auto it = request_set_.find(id);
   if (it != request_set_.end()) {
     request_set_.erase(it);
+    if (!traced_requests_.empty()) {
+      finish_request_trace(id);
+    }
     VLOG(td_requests) << "Sending result for request " << id << ": " << to_string(object);
     if (object == nullptr) {
       object = make_tl_object<td_api::error>(404, "Not Found");
@@ -4614,6 +4630,9 @@ void Td::send_error_impl(uint64 id, tl_object_ptr<td_api::error> error) {
   auto it = request_set_.find(id);
   if (it != request_set_.end()) {
     request_set_.erase(it);
+    if (!traced_requests_.empty()) {
+      finish_request_trace(id);
+    }
     VLOG(td_requests) << "Sending error for request " << id << ": " << oneline(to_string(error));
     callback_->on_error(id, std::move(error));
   }
@@ -4628,6 +4647,48 @@ void Td::send_error_raw(uint64 id, int32 code, CSlice error) {
   send_closure(actor_id(this), &Td::send_error_impl, id, make_error(code, error));
 }
 
+uint64 Td::start_request_trace(uint64 id, td_api::Function &function) {
+  auto &request = traced_requests_[id];
+  if (request.trace_id != 0) {
+    // a request with the same identifier is still being processed
+    TraceRecorder::finish_trace(request.trace_id);
+  }
+  // request identifiers are chosen by clients, so they can't be used as trace identifiers
+  request.trace_id = (static_cast<uint64>(td_options_.client_id) << 32) | ++last_trace_number_;
+  if (request.trace_id == 0) {
+    request.trace_id = ++last_trace_number_;
+  }
+  request.start_time = Time::now();
+  request.function_id = function.get_id();
+
+  auto &name = request_trace_names_[request.function_id];
+  if (name.empty()) {
+    // the name is taken from an empty object of the same type to avoid converting the whole request to string
+    downcast_call(function, [&name](auto &request) {
+      using RequestT = std::decay_t<decltype(request)>;
+      name = to_string(RequestT());
+    });
+    auto name_end = name.find(' ');
+    if (name_end != string::npos) {
+      name.resize(name_end);
+    }
+  }
+
+  TraceRecorder::start_trace(request.trace_id);
+  return request.trace_id;
+}
+
+void Td::finish_request_trace(uint64 id) {
+  auto it = traced_requests_.find(id);
+  if (it != traced_requests_.end()) {
+    auto &request = it->second;
+    TraceRecorder::add_span(request.trace_id, request_trace_names_[request.function_id], request.start_time,
+                            Time::now());
+    TraceRecorder::finish_trace(request.trace_id);
+    traced_requests_.erase(it);
+  }
+}
+
 void Td::answer_ok_query(uint64 id, Status status) {
   if (status.is_error()) {
     send_closure(actor_id(this), &Td::send_error, id, std::move(status));
@@ -7031,6 +7092,24 @@ void Td::on_request(uint64 id, td_api::getOption &request) {
         return;
       }
       break;
+    case 'f':
+      // sizes of the file tables are computed on request and aren't sent in updates
+      if (file_manager_ != nullptr) {
+        if (request.name_ == "file_id_count") {
+          option_value =
+              make_tl_object<td_api::optionValueInteger>(file_manager_->get_file_id_table_stats().live_slot_count);
+        } else if (request.name_ == "file_node_count") {
+          option_value =
+              make_tl_object<td_api::optionValueInteger>(file_manager_->get_file_node_table_stats().live_slot_count);
+        } else if (request.name_ == "free_file_id_count") {
+          option_value =
+              make_tl_object<td_api::optionValueInteger>(file_manager_->get_file_id_table_stats().free_slot_count);
+        } else if (request.name_ == "free_file_node_count") {
+          option_value =
+              make_tl_object<td_api::optionValueInteger>(file_manager_->get_file_node_table_stats().free_slot_count);
+        }
+      }
+      break;
     case 'i':
       if (!is_bot && request.name_ == "ignore_sensitive_content_restrictions") {
         auto promise = PromiseCreator::lambda([actor_id = actor_id(this), id](Result<Unit> &&result) {
@@ -7299,6 +7378,9 @@ void Td::on_request(uint64 id, td_api::setOption &request) {
       if (set_integer_option("session_count", 0, 50)) {
         return;
       }
+      if (set_integer_option("session_connection_count", 0, 8)) {
+        return;
+      }
       if (set_integer_option("storage_max_files_size")) {
         return;
       }
@@ -7347,6 +7429,9 @@ void Td::on_request(uint64 id, td_api::setOption &request) {
       return send_closure(actor_id(this), &Td::send_result, id, make_tl_object<td_api::ok>());
     }
     case 'u':
+      if (set_boolean_option("use_file_deduplication")) {
+        return;
+      }
       if (set_boolean_option("use_pfs")) {
         return;
       }
@@ -7993,6 +8078,18 @@ void Td::on_request(uint64 id, const td_api::addLogMessage &request) {
   UNREACHABLE();
 }
 
+void Td::on_request(uint64 id, const td_api::setRequestTracing &request) {
+  UNREACHABLE();
+}
+
+void Td::on_request(uint64 id, const td_api::getRequestTrace &request) {
+  UNREACHABLE();
+}
+
+void Td::on_request(uint64 id, const td_api::getSchedulerMetrics &request) {
+  UNREACHABLE();
+}
+
 td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::getTextEntities &request) {
   if (!check_utf8(request.text_)) {
     return make_error(400, "Text must be encoded in UTF-8");
@@ -8191,6 +8288,22 @@ td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::addLogMes
   return td_api::make_object<td_api::ok>();
 }
 
+td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::setRequestTracing &request) {
+  if (request.max_span_count_ < 0 || request.max_span_count_ > 1000000) {
+    return make_error(400, "Wrong maximum number of spans specified");
+  }
+  TraceRecorder::set_max_span_count(static_cast<size_t>(request.max_span_count_));
+  return td_api::make_object<td_api::ok>();
+}
+
+td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::getRequestTrace &request) {
+  return td_api::make_object<td_api::text>(TraceRecorder::export_chrome_trace());
+}
+
+td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::getSchedulerMetrics &request) {
+  return td_api::make_object<td_api::text>(SchedulerMetricsRegistry::export_prometheus());
+}
+
 td_api::object_ptr<td_api::Object> Td::do_static_request(td_api::testReturnError &request) {
   if (request.error_ == nullptr) {
     return td_api::make_object<td_api::error>(404, "Not Found");
@@ -98,6 +98,7 @@ class Td final : public NetQueryCallback {
 
   struct Options {
     std::shared_ptr<NetQueryStats> net_query_stats;
+    int32 client_id = 0;  // identifier of the client in the ClientManager; used to make trace identifiers unique
   };
 
   Td(unique_ptr<TdCallback> callback, Options options);
@@ -247,6 +248,9 @@ class Td final : public NetQueryCallback {
   void send_error_raw(uint64 id, int32 code, CSlice error);
   void answer_ok_query(uint64 id, Status status);
 
+  uint64 start_request_trace(uint64 id, td_api::Function &function);
+  void finish_request_trace(uint64 id);
+
   ActorShared<Td> create_reference();
 
   void inc_actor_refcnt();
@@ -270,6 +274,15 @@ class Td final : public NetQueryCallback {
   StateManager::State connection_state_;
 
   std::unordered_multiset<uint64> request_set_;
+
+  struct TracedRequest {
+    uint64 trace_id = 0;
+    double start_time = 0;
+    int32 function_id = 0;
+  };
+  std::unordered_map<uint64, TracedRequest> traced_requests_;
+  std::unordered_map<int32, string> request_trace_names_;  // function identifier -> function name
+  uint32 last_trace_number_ = 0;
   int actor_refcnt_ = 0;
   int request_actor_refcnt_ = 0;
   int stop_cnt_ = 2;
@@ -1133,6 +1146,12 @@ class Td final : public NetQueryCallback {
 
   void on_request(uint64 id, const td_api::addLogMessage &request);
 
+  void on_request(uint64 id, const td_api::setRequestTracing &request);
+
+  void on_request(uint64 id, const td_api::getRequestTrace &request);
+
+  void on_request(uint64 id, const td_api::getSchedulerMetrics &request);
+
   // test
   void on_request(uint64 id, const td_api::testNetwork &request);
   void on_request(uint64 id, td_api::testProxy &request);
@@ -1172,6 +1191,9 @@ class Td final : public NetQueryCallback {
   static td_api::object_ptr<td_api::Object> do_static_request(const td_api::setLogTagVerbosityLevel &request);
   static td_api::object_ptr<td_api::Object> do_static_request(const td_api::getLogTagVerbosityLevel &request);
   static td_api::object_ptr<td_api::Object> do_static_request(const td_api::addLogMessage &request);
+  static td_api::object_ptr<td_api::Object> do_static_request(const td_api::setRequestTracing &request);
+  static td_api::object_ptr<td_api::Object> do_static_request(const td_api::getRequestTrace &request);
+  static td_api::object_ptr<td_api::Object> do_static_request(const td_api::getSchedulerMetrics &request);
   static td_api::object_ptr<td_api::Object> do_static_request(td_api::testReturnError &request);
 
   static DbKey as_db_key(string key);
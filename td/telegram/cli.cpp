@@ -4350,6 +4350,27 @@ class CliClient final : public Actor {
       } else {
         execute(std::move(request));
       }
+    } else if (op == "srt" || op == "srte") {
+      auto request = td_api::make_object<td_api::setRequestTracing>(to_integer<int32>(args));
+      if (op == "srt") {
+        send_request(std::move(request));
+      } else {
+        execute(std::move(request));
+      }
+    } else if (op == "grt" || op == "grte") {
+      auto request = td_api::make_object<td_api::getRequestTrace>();
+      if (op == "grt") {
+        send_request(std::move(request));
+      } else {
+        execute(std::move(request));
+      }
+    } else if (op == "gsm" || op == "gsme") {
+      auto request = td_api::make_object<td_api::getSchedulerMetrics>();
+      if (op == "gsm") {
+        send_request(std::move(request));
+      } else {
+        execute(std::move(request));
+      }
     } else if (op == "q" || op == "Quit") {
       quit();
     } else if (op == "dnq" || op == "DumpNetQueries") {
@@ -0,0 +1,106 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/files/FileContentStore.h"
+
+#include "td/telegram/files/FileLoaderUtils.h"
+
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+#include "td/utils/port/path.h"
+#include "td/utils/port/Stat.h"
+
+#include <unordered_set>
+
+namespace td {
+
+string get_files_content_dir(FileType file_type) {
+  return PSTRING() << get_files_base_dir(file_type) << "content" << TD_DIR_SLASH;
+}
+
+static Status check_file_unchanged(CSlice path, const Stat &hashed_stat) {
+  TRY_RESULT(path_stat, stat(path));
+  if (path_stat.inode_ != hashed_stat.inode_ || path_stat.size_ != hashed_stat.size_ ||
+      path_stat.mtime_nsec_ != hashed_stat.mtime_nsec_) {
+    return Status::Error("File was changed");
+  }
+  return Status::OK();
+}
+
+Result<uint64> deduplicate_file(CSlice content_dir, CSlice path, const Stat &hashed_stat, Slice sha256) {
+  if (sha256.size() != 32) {
+    return Status::Error("Wrong content hash");
+  }
+  TRY_STATUS(mkpath(content_dir, 0750));
+  auto content_path = PSTRING() << content_dir << hex_encode(sha256);
+
+  auto r_content_stat = stat(content_path);
+  if (r_content_stat.is_error()) {
+    // the content is new; store it
+    TRY_STATUS(check_file_unchanged(path, hashed_stat));
+    TRY_STATUS(link(path, content_path));
+    auto status = check_file_unchanged(content_path, hashed_stat);
+    if (status.is_error()) {
+      // the file was rewritten in the meantime, so the stored content doesn't match the hash
+      unlink(content_path).ignore();
+      return std::move(status);
+    }
+    return hashed_stat.mtime_nsec_;
+  }
+  auto content_stat = r_content_stat.move_as_ok();
+  if (content_stat.size_ != hashed_stat.size_) {
+    return Status::Error(PSLICE() << "Stored content has size " << content_stat.size_ << " instead of "
+                                  << hashed_stat.size_);
+  }
+  // atomically replace the file with a link to the content
+  auto temp_path = PSTRING() << path << ".dedup";
+  unlink(temp_path).ignore();
+  TRY_STATUS(link(content_path, temp_path));
+  // the file could have been rewritten with the same size after it was hashed
+  auto status = check_file_unchanged(path, hashed_stat);
+  if (status.is_ok()) {
+    status = rename(temp_path, path);
+  }
+  // if the file is already a link to the content, rename does nothing and the temporary link must be removed too
+  unlink(temp_path).ignore();
+  TRY_STATUS(std::move(status));
+  // the file now has the modification time of the stored content
+  return content_stat.mtime_nsec_;
+}
+
+vector<string> get_file_content_paths() {
+  vector<string> paths;
+  std::unordered_set<string> scanned_dirs;
+  for (int32 i = 0; i < MAX_FILE_TYPE; i++) {
+    auto dir = get_files_content_dir(static_cast<FileType>(i));
+    if (scanned_dirs.insert(dir).second) {
+      append(paths, get_file_content_paths(dir));
+    }
+  }
+  return paths;
+}
+
+vector<string> get_file_content_paths(CSlice content_dir) {
+  vector<string> paths;
+  walk_path(content_dir, [&](CSlice path, WalkPath::Type type) {
+    if (type == WalkPath::Type::NotDir) {
+      paths.push_back(path.str());
+    }
+  }).ignore();
+  return paths;
+}
+
+bool remove_file_content_if_unused(CSlice content_path) {
+  auto r_stat = stat(content_path);
+  if (r_stat.is_error() || r_stat.ok().link_count_ > 1) {
+    return false;
+  }
+  auto status = unlink(content_path);
+  LOG_IF(WARNING, status.is_error()) << "Failed to unlink unused file content: " << status;
+  return status.is_ok();
+}
+
+}  // namespace td
@@ -0,0 +1,42 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/telegram/files/FileType.h"
+
+#include "td/utils/common.h"
+#include "td/utils/port/Stat.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Status.h"
+
+namespace td {
+
+// Content-addressed store of local files. Every stored file has a hard link named after the SHA256 of its content
+// in the "content" subdirectory of the files directory. A file with the same content as an already stored file is
+// replaced with another hard link to it, so the content is stored on the disk only once. The number of references
+// to the content is the number of hard links minus one, so the content without references can be found by files gc.
+
+constexpr int64 MIN_DEDUPLICATED_FILE_SIZE = 1 << 16;
+
+string get_files_content_dir(FileType file_type);
+
+// stores the content of the file in the content_dir or replaces the file with a link to the already stored content;
+// hashed_stat is the state of the file, when it was hashed, and the file isn't touched, if it has changed since then;
+// returns the modification time of the file after deduplication, which changes, if the file was replaced with a link
+Result<uint64> deduplicate_file(CSlice content_dir, CSlice path, const Stat &hashed_stat,
+                                Slice sha256) TD_WARN_UNUSED_RESULT;
+
+// returns paths of the stored contents of files of all types
+vector<string> get_file_content_paths();
+
+// returns paths of the contents stored in the content_dir
+vector<string> get_file_content_paths(CSlice content_dir);
+
+// removes the stored content, if it has no references; returns true, if the content was removed
+bool remove_file_content_if_unused(CSlice content_path);
+
+}  // namespace td
@@ -31,6 +31,9 @@
 #include "td/utils/tl_parsers.h"
 #include "td/utils/tl_storers.h"
 
+#include <mutex>
+#include <unordered_map>
+
 namespace td {
 
 Status drop_file_db(SqliteDb &db, int32 version) {
@@ -61,12 +64,113 @@ Status init_file_db(SqliteDb &db, int32 version) {
   return Status::OK();
 }
 
+// Write-through cache of rows of the files key-value table, which is shared between the FileDbActor and
+// synchronous readers. Location keys and file data are looked up on every file loaded from the database,
+// so the cache saves SQLite point queries when the same files are resolved again. When the cache is full,
+// a row, which wasn't used since the previous pass of the clock hand, is evicted.
+// Rows are written only by the FileDbActor. Erased rows are cached as empty values, like SqliteKeyValue::get
+// returns them. A reader adds a row only if there were no writes while the row was read from the database, so
+// a row read before a concurrent write can't replace the written value, even if it was already evicted.
+class FileDbCache {
+ public:
+  explicit FileDbCache(size_t max_size) : max_size_(max_size) {
+    // iterators in clock_rows_ stay valid, because there are no rehashes
+    rows_.reserve(max_size_ + 1);
+    clock_rows_.reserve(max_size_);
+  }
+
+  string get(SqliteKeyValue &pmc, const string &key) {
+    if (max_size_ == 0) {
+      return pmc.get(key);
+    }
+    uint64 generation;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      auto it = rows_.find(key);
+      if (it != rows_.end()) {
+        it->second.is_used = true;
+        return it->second.value;
+      }
+      generation = write_generation_;
+    }
+    auto value = pmc.get(key);
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (generation == write_generation_) {
+      put(key, value);
+    }
+    return value;
+  }
+
+  void set(SqliteKeyValue &pmc, string key, string value) {
+    pmc.set(key, value);
+    if (max_size_ == 0) {
+      return;
+    }
+    std::lock_guard<std::mutex> guard(mutex_);
+    write_generation_++;
+    put(std::move(key), std::move(value));
+  }
+
+  void erase(SqliteKeyValue &pmc, string key) {
+    pmc.erase(key);
+    if (max_size_ == 0) {
+      return;
+    }
+    std::lock_guard<std::mutex> guard(mutex_);
+    write_generation_++;
+    put(std::move(key), string());
+  }
+
+ private:
+  struct Row {
+    string value;
+    bool is_used = false;
+  };
+  using Rows = std::unordered_map<string, Row>;
+
+  size_t max_size_;
+  std::mutex mutex_;
+  uint64 write_generation_ = 0;
+  Rows rows_;
+  vector<Rows::iterator> clock_rows_;
+  size_t clock_hand_ = 0;
+
+  void put(string key, string value) {
+    auto it = rows_.find(key);
+    if (it != rows_.end()) {
+      it->second.value = std::move(value);
+      it->second.is_used = true;
+      return;
+    }
+
+    if (clock_rows_.size() < max_size_) {
+      clock_rows_.push_back(rows_.emplace(std::move(key), Row{std::move(value), false}).first);
+      return;
+    }
+    while (clock_rows_[clock_hand_]->second.is_used) {
+      clock_rows_[clock_hand_]->second.is_used = false;
+      advance_clock_hand();
+    }
+    rows_.erase(clock_rows_[clock_hand_]);
+    clock_rows_[clock_hand_] = rows_.emplace(std::move(key), Row{std::move(value), false}).first;
+    advance_clock_hand();
+  }
+
+  void advance_clock_hand() {
+    clock_hand_++;
+    if (clock_hand_ == clock_rows_.size()) {
+      clock_hand_ = 0;
+    }
+  }
+};
+
 class FileDb : public FileDbInterface {
  public:
   class FileDbActor : public Actor {
    public:
-    FileDbActor(FileDbId current_pmc_id, std::shared_ptr<SqliteKeyValueSafe> file_kv_safe)
-        : current_pmc_id_(current_pmc_id), file_kv_safe_(std::move(file_kv_safe)) {
+    FileDbActor(FileDbId current_pmc_id, std::shared_ptr<SqliteKeyValueSafe> file_kv_safe,
+                std::shared_ptr<FileDbCache> cache)
+        : current_pmc_id_(current_pmc_id), file_kv_safe_(std::move(file_kv_safe)), cache_(std::move(cache)) {
     }
 
     void close(Promise<> promise) {
@@ -77,7 +181,7 @@ class FileDb : public FileDbInterface {
     }
 
     void load_file_data(const string &key, Promise<FileData> promise) {
-      promise.set_result(load_file_data_impl(actor_id(this), file_pmc(), key, current_pmc_id_));
+      promise.set_result(load_file_data_impl(actor_id(this), file_pmc(), *cache_, key, current_pmc_id_));
     }
 
     void clear_file_data(FileDbId id, const string &remote_key, const string &local_key, const string &generate_key) {
@@ -92,19 +196,19 @@ class FileDb : public FileDbInterface {
         current_pmc_id_ = id;
       }
 
-      pmc.erase(PSTRING() << "file" << id.get());
+      cache_->erase(pmc, PSTRING() << "file" << id.get());
       LOG(DEBUG) << "ERASE " << format::as_hex_dump<4>(Slice(PSLICE() << "file" << id.get()));
 
       if (!remote_key.empty()) {
-        pmc.erase(remote_key);
+        cache_->erase(pmc, remote_key);
         LOG(DEBUG) << "ERASE remote " << format::as_hex_dump<4>(Slice(remote_key));
       }
       if (!local_key.empty()) {
-        pmc.erase(local_key);
+        cache_->erase(pmc, local_key);
         LOG(DEBUG) << "ERASE local " << format::as_hex_dump<4>(Slice(local_key));
       }
       if (!generate_key.empty()) {
-        pmc.erase(generate_key);
+        cache_->erase(pmc, generate_key);
       }
     }
     void store_file_data(FileDbId id, const string &file_data, const string &remote_key, const string &local_key,
@@ -120,16 +224,16 @@ class FileDb : public FileDbInterface {
         current_pmc_id_ = id;
       }
 
-      pmc.set(PSTRING() << "file" << id.get(), file_data);
+      cache_->set(pmc, PSTRING() << "file" << id.get(), file_data);
 
       if (!remote_key.empty()) {
-        pmc.set(remote_key, to_string(id.get()));
+        cache_->set(pmc, remote_key, to_string(id.get()));
       }
       if (!local_key.empty()) {
-        pmc.set(local_key, to_string(id.get()));
+        cache_->set(pmc, local_key, to_string(id.get()));
       }
       if (!generate_key.empty()) {
-        pmc.set(generate_key, to_string(id.get()));
+        cache_->set(pmc, generate_key, to_string(id.get()));
       }
     }
     void store_file_data_ref(FileDbId id, FileDbId new_id) {
@@ -162,22 +266,24 @@ class FileDb : public FileDbInterface {
    private:
     FileDbId current_pmc_id_;
     std::shared_ptr<SqliteKeyValueSafe> file_kv_safe_;
+    std::shared_ptr<FileDbCache> cache_;
 
     SqliteKeyValue &file_pmc() {
       return file_kv_safe_->get();
     }
 
     void do_store_file_data_ref(FileDbId id, FileDbId new_id) {
-      file_pmc().set(PSTRING() << "file" << id.get(), PSTRING() << "@@" << new_id.get());
+      cache_->set(file_pmc(), PSTRING() << "file" << id.get(), PSTRING() << "@@" << new_id.get());
     }
   };
 
-  explicit FileDb(std::shared_ptr<SqliteKeyValueSafe> kv_safe, int scheduler_id = -1) {
+  FileDb(std::shared_ptr<SqliteKeyValueSafe> kv_safe, int scheduler_id, size_t cache_size) {
     file_kv_safe_ = std::move(kv_safe);
     CHECK(file_kv_safe_);
+    cache_ = std::make_shared<FileDbCache>(cache_size);
     current_pmc_id_ = FileDbId(to_integer<uint64>(file_kv_safe_->get().get("file_id")));
-    file_db_actor_ =
-        create_actor_on_scheduler<FileDbActor>("FileDbActor", scheduler_id, current_pmc_id_, file_kv_safe_);
+    file_db_actor_ = create_actor_on_scheduler<FileDbActor>("FileDbActor", scheduler_id, current_pmc_id_,
+                                                            file_kv_safe_, cache_);
   }
 
   FileDbId create_pmc_id() override {
@@ -194,7 +300,7 @@ class FileDb : public FileDbInterface {
   }
 
   Result<FileData> get_file_data_sync_impl(string key) override {
-    return load_file_data_impl(file_db_actor_.get(), file_kv_safe_->get(), key, current_pmc_id_);
+    return load_file_data_impl(file_db_actor_.get(), file_kv_safe_->get(), *cache_, key, current_pmc_id_);
   }
 
   void clear_file_data(FileDbId id, const FileData &file_data) override {
@@ -245,11 +351,12 @@ class FileDb : public FileDbInterface {
   ActorOwn<FileDbActor> file_db_actor_;
   FileDbId current_pmc_id_;
   std::shared_ptr<SqliteKeyValueSafe> file_kv_safe_;
+  std::shared_ptr<FileDbCache> cache_;
 
   static Result<FileData> load_file_data_impl(ActorId<FileDbActor> file_db_actor_id, SqliteKeyValue &pmc,
-                                              const string &key, FileDbId current_pmc_id) {
+                                              FileDbCache &cache, const string &key, FileDbId current_pmc_id) {
     //LOG(DEBUG) << "Load by key " << format::as_hex_dump<4>(Slice(key));
-    TRY_RESULT(id, get_id(pmc, key));
+    TRY_RESULT(id, get_id(pmc, cache, key));
 
     vector<FileDbId> ids;
     string data_str;
@@ -261,7 +368,7 @@ class FileDb : public FileDbInterface {
       }
       attempt_count++;
 
-      data_str = pmc.get(PSTRING() << "file" << id.get());
+      data_str = cache.get(pmc, PSTRING() << "file" << id.get());
       auto data_slice = Slice(data_str);
 
       if (data_slice.substr(0, 2) == "@@") {
@@ -290,8 +397,8 @@ class FileDb : public FileDbInterface {
     return std::move(data);
   }
 
-  static Result<FileDbId> get_id(SqliteKeyValue &pmc, const string &key) TD_WARN_UNUSED_RESULT {
-    auto id_str = pmc.get(key);
+  static Result<FileDbId> get_id(SqliteKeyValue &pmc, FileDbCache &cache, const string &key) TD_WARN_UNUSED_RESULT {
+    auto id_str = cache.get(pmc, key);
     //LOG(DEBUG) << "Found id " << id_str << " by key " << format::as_hex_dump<4>(Slice(key));
     if (id_str.empty()) {
       return Status::Error("There is no such a key in database");
@@ -300,9 +407,10 @@ class FileDb : public FileDbInterface {
   }
 };
 
-std::shared_ptr<FileDbInterface> create_file_db(std::shared_ptr<SqliteConnectionSafe> connection, int scheduler_id) {
+std::shared_ptr<FileDbInterface> create_file_db(std::shared_ptr<SqliteConnectionSafe> connection, int scheduler_id,
+                                                size_t cache_size) {
   auto kv = std::make_shared<SqliteKeyValueSafe>("files", std::move(connection));
-  return std::make_shared<FileDb>(std::move(kv), scheduler_id);
+  return std::make_shared<FileDb>(std::move(kv), scheduler_id, cache_size);
 }
 
 Status fix_file_remote_location_key_bug(SqliteDb &db) {
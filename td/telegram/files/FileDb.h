@@ -29,8 +29,13 @@ Status drop_file_db(SqliteDb &db, int32 version) TD_WARN_UNUSED_RESULT;
 Status init_file_db(SqliteDb &db, int32 version) TD_WARN_UNUSED_RESULT;
 
 class FileDbInterface;
+
+// rows of the file database, which are cached in memory by default; pass cache_size == 0 to disable the cache
+constexpr size_t DEFAULT_FILE_DB_CACHE_SIZE = 1 << 15;
+
 std::shared_ptr<FileDbInterface> create_file_db(std::shared_ptr<SqliteConnectionSafe> connection,
-                                                int32 scheduler_id = -1) TD_WARN_UNUSED_RESULT;
+                                                int32 scheduler_id = -1,
+                                                size_t cache_size = DEFAULT_FILE_DB_CACHE_SIZE) TD_WARN_UNUSED_RESULT;
 
 class FileDbInterface {
  public:
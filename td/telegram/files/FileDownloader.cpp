@@ -35,12 +35,14 @@ namespace td {
 
 FileDownloader::FileDownloader(const FullRemoteFileLocation &remote, const LocalFileLocation &local, int64 size,
                                string name, const FileEncryptionKey &encryption_key, bool is_small, bool search_file,
-                               int64 offset, int64 limit, unique_ptr<Callback> callback)
+                               int64 offset, int64 limit, ActorId<FileIoService> file_io_service,
+                               unique_ptr<Callback> callback)
     : remote_(remote)
     , local_(local)
     , size_(size)
     , name_(std::move(name))
     , encryption_key_(encryption_key)
+    , file_io_service_(std::move(file_io_service))
     , callback_(std::move(callback))
     , is_small_(is_small)
     , search_file_(search_file)
@@ -81,18 +83,18 @@ Result<FileLoader::FileInfo> FileDownloader::init() {
         encryption_key_.mutable_iv() = as<UInt256>(partial.iv_.data());
         next_part_ = narrow_cast<int32>(bitmask.get_ready_parts(0));
       }
-      fd_ = result_fd.move_as_ok();
+      fd_ = std::make_shared<FileFd>(result_fd.move_as_ok());
       part_size = partial.part_size_;
     }
   }
-  if (search_file_ && fd_.empty() && size_ > 0 && size_ < 1000 * (1 << 20) && encryption_key_.empty() &&
+  if (search_file_ && fd_ == nullptr && size_ > 0 && size_ < 1000 * (1 << 20) && encryption_key_.empty() &&
       !remote_.is_web()) {
     [&] {
       TRY_RESULT(path, search_file(get_files_dir(remote_.file_type_), name_, size_));
       TRY_RESULT(fd, FileFd::open(path, FileFd::Read));
       LOG(INFO) << "Check hash of local file " << path;
       path_ = std::move(path);
-      fd_ = std::move(fd);
+      fd_ = std::make_shared<FileFd>(std::move(fd));
       need_check_ = true;
       only_check_ = true;
       part_size = 32 * (1 << 10);
@@ -123,7 +125,7 @@ Status FileDownloader::on_ok(int64 size) {
   auto dir = get_files_dir(remote_.file_type_);
 
   std::string path;
-  fd_.close();
+  fd_.reset();
   if (encryption_key_.is_secure()) {
     TRY_RESULT(file_path, open_temp_file(remote_.file_type_));
     string tmp_path;
@@ -144,7 +146,7 @@ Status FileDownloader::on_ok(int64 size) {
 }
 
 void FileDownloader::on_error(Status status) {
-  fd_.close();
+  fd_.reset();
   callback_->on_error(std::move(status));
 }
 
@@ -370,7 +372,18 @@ Result<size_t> FileDownloader::process_part(Part part, NetQueryPtr net_query) {
   auto slice = bytes.as_slice().truncate(part.size);
   TRY_STATUS(acquire_fd());
   LOG(INFO) << "Got " << slice.size() << " bytes at offset " << part.offset << " for \"" << path_ << '"';
-  TRY_RESULT(written, fd_.pwrite(slice, part.offset));
+  if (!encryption_key_.is_secret()) {
+    // the part is written in the FileIoService; the stored IV of partially downloaded secret files
+    // must match the ready parts, so they are still written synchronously
+    auto size = slice.size();
+    bytes.truncate(size);
+    send_closure(file_io_service_, &FileIoService::write, fd_, part.offset, std::move(bytes),
+                 PromiseCreator::lambda([actor_id = actor_id(this), part, size](Result<size_t> r_written) {
+                   send_closure(actor_id, &FileDownloader::on_part_written, part, size, std::move(r_written));
+                 }));
+    return PART_IN_PROGRESS;
+  }
+  TRY_RESULT(written, fd_->pwrite(slice, part.offset));
   LOG(INFO) << "Written " << written << " bytes";
   // may write less than part.size, when size of downloadable file is unknown
   if (written != slice.size()) {
@@ -379,6 +392,17 @@ Result<size_t> FileDownloader::process_part(Part part, NetQueryPtr net_query) {
   return written;
 }
 
+void FileDownloader::on_part_written(Part part, size_t size, Result<size_t> r_written) {
+  if (r_written.is_ok()) {
+    LOG(INFO) << "Written " << r_written.ok() << " bytes";
+    // may write less than part.size, when size of downloadable file is unknown
+    if (r_written.ok() != size) {
+      r_written = Status::Error("Failed to save file part to the file");
+    }
+  }
+  on_part_processed(part, std::move(r_written));
+}
+
 void FileDownloader::on_progress(Progress progress) {
   if (progress.is_ready) {
     // do not send partial location. will lead to wrong local_size
@@ -426,17 +450,26 @@ Result<FileLoader::CheckInfo> FileDownloader::check_loop(int64 checked_prefix_si
   SCOPE_EXIT {
     try_release_fd();
   };
+  TRY_STATUS(std::move(hash_check_status_));
   CheckInfo info;
-  while (checked_prefix_size < ready_prefix_size) {
-    //LOG(ERROR) << "NEED TO CHECK: " << checked_prefix_size << "->" << ready_prefix_size - checked_prefix_size;
+  while (!checked_hash_ranges_.empty() && checked_hash_ranges_.begin()->first <= checked_prefix_size) {
+    auto it = checked_hash_ranges_.begin();
+    if (it->second > checked_prefix_size) {
+      checked_prefix_size = it->second;
+      info.changed = true;
+    }
+    checked_hash_ranges_.erase(it);
+  }
+  auto offset = max(checked_prefix_size, next_hash_check_offset_);
+  while (offset < ready_prefix_size && hash_check_count_ < MAX_HASH_CHECK_COUNT) {
+    //LOG(ERROR) << "NEED TO CHECK: " << offset << "->" << ready_prefix_size - offset;
     HashInfo search_info;
-    search_info.offset = checked_prefix_size;
+    search_info.offset = offset;
     auto it = hash_info_.upper_bound(search_info);
     if (it != hash_info_.begin()) {
       --it;
     }
-    if (it != hash_info_.end() && it->offset <= checked_prefix_size &&
-        it->offset + narrow_cast<int64>(it->size) > checked_prefix_size) {
+    if (it != hash_info_.end() && it->offset <= offset && it->offset + narrow_cast<int64>(it->size) > offset) {
       int64 begin_offset = it->offset;
       int64 end_offset = it->offset + narrow_cast<int64>(it->size);
       if (ready_prefix_size < end_offset) {
@@ -446,30 +479,21 @@ Result<FileLoader::CheckInfo> FileDownloader::check_loop(int64 checked_prefix_si
         end_offset = ready_prefix_size;
       }
       size_t size = narrow_cast<size_t>(end_offset - begin_offset);
-      auto slice = BufferSlice(size);
+      hash_check_count_++;
+      next_hash_check_offset_ = end_offset;
+      offset = end_offset;
+      auto promise = PromiseCreator::lambda([actor_id = actor_id(this), begin_offset, end_offset,
+                                             expected_hash = it->hash](Result<string> r_hash) mutable {
+        send_closure(actor_id, &FileDownloader::on_hash_computed, begin_offset, end_offset, std::move(expected_hash),
+                     std::move(r_hash));
+      });
       TRY_STATUS(acquire_fd());
-      TRY_RESULT(read_size, fd_.pread(slice.as_slice(), begin_offset));
-      if (size != read_size) {
-        return Status::Error("Failed to read file to check hash");
-      }
-      string hash(32, ' ');
-      sha256(slice.as_slice(), hash);
-
-      if (hash != it->hash) {
-        if (only_check_) {
-          return Status::Error("FILE_DOWNLOAD_RESTART");
-        }
-        return Status::Error("Hash mismatch");
-      }
-
-      checked_prefix_size = end_offset;
-      info.changed = true;
+      send_closure(file_io_service_, &FileIoService::compute_sha256, fd_, begin_offset, size, std::move(promise));
       continue;
     }
     if (!has_hash_query_) {
       has_hash_query_ = true;
-      auto query =
-          telegram_api::upload_getFileHashes(remote_.as_input_file_location(), narrow_cast<int32>(checked_prefix_size));
+      auto query = telegram_api::upload_getFileHashes(remote_.as_input_file_location(), narrow_cast<int32>(offset));
       auto net_query_type = is_small_ ? NetQuery::Type::DownloadSmall : NetQuery::Type::Download;
       auto net_query = G()->net_query_creator().create(query, remote_.get_dc_id(), net_query_type);
       info.queries.push_back(std::move(net_query));
@@ -483,6 +507,20 @@ Result<FileLoader::CheckInfo> FileDownloader::check_loop(int64 checked_prefix_si
   return std::move(info);
 }
 
+void FileDownloader::on_hash_computed(int64 begin_offset, int64 end_offset, string expected_hash,
+                                      Result<string> r_hash) {
+  CHECK(hash_check_count_ > 0);
+  hash_check_count_--;
+  if (r_hash.is_error()) {
+    hash_check_status_ = r_hash.move_as_error();
+  } else if (r_hash.ok() != expected_hash) {
+    hash_check_status_ = only_check_ ? Status::Error("FILE_DOWNLOAD_RESTART") : Status::Error("Hash mismatch");
+  } else {
+    checked_hash_ranges_[begin_offset] = end_offset;
+  }
+  yield();
+}
+
 void FileDownloader::add_hash_info(const std::vector<telegram_api::object_ptr<telegram_api::fileHash>> &hashes) {
   for (auto &hash : hashes) {
     //LOG(ERROR) << "ADD HASH " << hash->offset_ << "->" << hash->limit_;
@@ -500,18 +538,20 @@ void FileDownloader::keep_fd_flag(bool keep_fd) {
 }
 
 void FileDownloader::try_release_fd() {
-  if (!keep_fd_ && !fd_.empty()) {
-    fd_.close();
+  if (!keep_fd_) {
+    fd_.reset();
   }
 }
 
 Status FileDownloader::acquire_fd() {
-  if (fd_.empty()) {
+  if (fd_ == nullptr) {
+    FileFd fd;
     if (path_.empty()) {
-      TRY_RESULT_ASSIGN(std::tie(fd_, path_), open_temp_file(remote_.file_type_));
+      TRY_RESULT_ASSIGN(std::tie(fd, path_), open_temp_file(remote_.file_type_));
     } else {
-      TRY_RESULT_ASSIGN(fd_, FileFd::open(path_, (only_check_ ? 0 : FileFd::Write) | FileFd::Read));
+      TRY_RESULT_ASSIGN(fd, FileFd::open(path_, (only_check_ ? 0 : FileFd::Write) | FileFd::Read));
     }
+    fd_ = std::make_shared<FileFd>(std::move(fd));
   }
   return Status::OK();
 }
@@ -9,6 +9,7 @@
 #include "td/telegram/telegram_api.h"
 
 #include "td/telegram/files/FileEncryptionKey.h"
+#include "td/telegram/files/FileIoService.h"
 #include "td/telegram/files/FileLoader.h"
 #include "td/telegram/files/FileLocation.h"
 #include "td/telegram/net/DcId.h"
@@ -19,6 +20,7 @@
 #include "td/utils/Status.h"
 
 #include <map>
+#include <memory>
 #include <set>
 #include <utility>
 
@@ -35,7 +37,7 @@ class FileDownloader : public FileLoader {
 
   FileDownloader(const FullRemoteFileLocation &remote, const LocalFileLocation &local, int64 size, string name,
                  const FileEncryptionKey &encryption_key, bool is_small, bool search_file, int64 offset, int64 limit,
-                 unique_ptr<Callback> callback);
+                 ActorId<FileIoService> file_io_service, unique_ptr<Callback> callback);
 
   // Should just implement all parent pure virtual methods.
   // Must not call any of them...
@@ -47,11 +49,12 @@ class FileDownloader : public FileLoader {
   int64 size_;
   string name_;
   FileEncryptionKey encryption_key_;
+  ActorId<FileIoService> file_io_service_;
   unique_ptr<Callback> callback_;
   bool only_check_{false};
 
   string path_;
-  FileFd fd_;
+  std::shared_ptr<FileFd> fd_;  // shared with part writes and hash checks in the FileIoService
 
   int32 next_part_ = 0;
   bool next_part_stop_ = false;
@@ -80,6 +83,12 @@ class FileDownloader : public FileLoader {
   };
   std::set<HashInfo> hash_info_;
   bool has_hash_query_ = false;
+  // independent hash ranges are checked concurrently in the FileIoService
+  static constexpr int32 MAX_HASH_CHECK_COUNT = 4;
+  int32 hash_check_count_ = 0;
+  int64 next_hash_check_offset_ = 0;
+  std::map<int64, int64> checked_hash_ranges_;  // begin -> end of checked, but not yet merged ranges
+  Status hash_check_status_;
 
   Result<FileInfo> init() override TD_WARN_UNUSED_RESULT;
   Status on_ok(int64 size) override TD_WARN_UNUSED_RESULT;
@@ -88,10 +97,12 @@ class FileDownloader : public FileLoader {
   Result<std::pair<NetQueryPtr, bool>> start_part(Part part, int32 part_count,
                                                   int64 streaming_offset) override TD_WARN_UNUSED_RESULT;
   Result<size_t> process_part(Part part, NetQueryPtr net_query) override TD_WARN_UNUSED_RESULT;
+  void on_part_written(Part part, size_t size, Result<size_t> r_written);
   void on_progress(Progress progress) override;
   FileLoader::Callback *get_callback() override;
   Status process_check_query(NetQueryPtr net_query) override;
   Result<CheckInfo> check_loop(int64 checked_prefix_size, int64 ready_prefix_size, bool is_ready) override;
+  void on_hash_computed(int64 begin_offset, int64 end_offset, string expected_hash, Result<string> r_hash);
   void add_hash_info(const std::vector<telegram_api::object_ptr<telegram_api::fileHash>> &hashes);
 
   bool keep_fd_ = false;
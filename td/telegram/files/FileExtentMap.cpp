@@ -0,0 +1,113 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/files/FileExtentMap.h"
+
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+
+#include <iterator>
+
+namespace td {
+
+FileExtentMap::FileExtentMap(const Bitmask &bitmask, int64 part_size) {
+  if (part_size <= 0) {
+    return;
+  }
+  auto part_count = bitmask.size();
+  int64 part_i = 0;
+  while (part_i < part_count) {
+    if (!bitmask.get(part_i)) {
+      part_i++;
+      continue;
+    }
+    auto ready_parts = bitmask.get_ready_parts(part_i);
+    // parts are added in increasing order, so the extents are never merged here
+    extents_.emplace_hint(extents_.end(), part_i * part_size, (part_i + ready_parts) * part_size);
+    total_size_ += ready_parts * part_size;
+    part_i += ready_parts;
+  }
+}
+
+void FileExtentMap::add(int64 begin, int64 end) {
+  CHECK(0 <= begin);
+  if (begin >= end) {
+    return;
+  }
+  auto it = extents_.upper_bound(begin);
+  if (it != extents_.begin()) {
+    auto prev = std::prev(it);
+    if (prev->second >= begin) {
+      if (prev->second >= end) {
+        return;
+      }
+      begin = prev->first;
+      total_size_ -= prev->second - prev->first;
+      it = extents_.erase(prev);
+    }
+  }
+  while (it != extents_.end() && it->first <= end) {
+    end = max(end, it->second);
+    total_size_ -= it->second - it->first;
+    it = extents_.erase(it);
+  }
+  extents_.emplace_hint(it, begin, end);
+  total_size_ += end - begin;
+}
+
+bool FileExtentMap::is_ready(int64 begin, int64 end, int64 file_size) const {
+  if (file_size != 0) {
+    end = min(end, file_size);
+  }
+  if (begin >= end) {
+    return true;
+  }
+  return get_ready_prefix_size(begin, file_size) >= end - begin;
+}
+
+int64 FileExtentMap::get_ready_prefix_size(int64 offset, int64 file_size) const {
+  if (offset < 0) {
+    return 0;
+  }
+  auto it = extents_.upper_bound(offset);
+  if (it == extents_.begin()) {
+    return 0;
+  }
+  --it;
+  if (it->second <= offset) {
+    return 0;
+  }
+  auto ready_end = it->second;
+  if (file_size != 0 && ready_end > file_size) {
+    ready_end = file_size;
+    if (offset > file_size) {
+      offset = file_size;
+    }
+  }
+  return ready_end - offset;
+}
+
+int64 FileExtentMap::get_total_size(int64 file_size) const {
+  if (file_size == 0) {
+    return total_size_;
+  }
+  auto result = total_size_;
+  // subtract parts of the extents after the end of the file
+  for (auto it = extents_.rbegin(); it != extents_.rend() && it->second > file_size; ++it) {
+    result -= it->second - max(it->first, file_size);
+  }
+  return result;
+}
+
+StringBuilder &operator<<(StringBuilder &sb, const FileExtentMap &extent_map) {
+  sb << '[';
+  for (auto &extent : extent_map.extents_) {
+    sb << '[' << extent.first << ", " << extent.second << ')';
+  }
+  return sb << ']';
+}
+
+}  // namespace td
@@ -0,0 +1,43 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/telegram/files/FileBitmask.h"
+
+#include "td/utils/common.h"
+#include "td/utils/StringBuilder.h"
+
+#include <map>
+
+namespace td {
+
+// Ready byte ranges of a partially downloaded file as a map of disjoint extents.
+// Unlike Bitmask, answers queries about ready ranges in O(log n) without decoding.
+class FileExtentMap {
+ public:
+  FileExtentMap() = default;
+  FileExtentMap(const Bitmask &bitmask, int64 part_size);
+
+  void add(int64 begin, int64 end);
+
+  // file_size == 0 means that the size is unknown
+  bool is_ready(int64 begin, int64 end, int64 file_size) const;
+  int64 get_ready_prefix_size(int64 offset, int64 file_size) const;
+  int64 get_total_size(int64 file_size) const;
+
+  size_t get_extent_count() const {
+    return extents_.size();
+  }
+
+  friend StringBuilder &operator<<(StringBuilder &sb, const FileExtentMap &extent_map);
+
+ private:
+  std::map<int64, int64> extents_;  // begin -> end, extents are neither intersecting nor adjacent
+  int64 total_size_ = 0;
+};
+
+}  // namespace td
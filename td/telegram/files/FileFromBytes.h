@@ -45,7 +45,7 @@ class FileFromBytes : public FileLoaderActor {
   string path_;
 
   void wakeup() override;
-  void set_resource_manager(ActorShared<ResourceManager>) override {
+  void set_resource_manager(ActorShared<ResourceManager>, size_t) override {
   }
   void update_priority(int8 priority) override {
   }
@@ -0,0 +1,66 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/files/FileGcQueue.h"
+
+#include <algorithm>
+
+namespace td {
+
+namespace {
+// comparator for a heap with the least recently accessed file on top
+bool is_accessed_later(const FullFileInfo &lhs, const FullFileInfo &rhs) {
+  return lhs.atime_nsec > rhs.atime_nsec;
+}
+}  // namespace
+
+FileGcQueue::FileGcQueue(vector<FullFileInfo> expired_files, vector<FullFileInfo> files, size_t max_file_count,
+                         int64 max_files_size)
+    : expired_files_(std::move(expired_files)), candidate_files_(std::move(files)) {
+  // 1. Total size must be less than max_files_size
+  // 2. Total file count must be less than max_file_count
+  if (candidate_files_.size() > max_file_count) {
+    remove_count_ = candidate_files_.size() - max_file_count;
+  }
+  remove_size_ = -max_files_size;
+  for (auto &file : candidate_files_) {
+    remove_size_ += file.size;
+  }
+
+  std::make_heap(candidate_files_.begin(), candidate_files_.end(), is_accessed_later);
+}
+
+bool FileGcQueue::pop(FullFileInfo &file, Reason &reason) {
+  if (!expired_files_.empty()) {
+    file = std::move(expired_files_.back());
+    expired_files_.pop_back();
+    reason = Reason::Expired;
+    return true;
+  }
+  if (candidate_files_.empty() || (remove_count_ == 0 && remove_size_ <= 0)) {
+    return false;
+  }
+
+  std::pop_heap(candidate_files_.begin(), candidate_files_.end(), is_accessed_later);
+  file = std::move(candidate_files_.back());
+  candidate_files_.pop_back();
+  if (remove_count_ > 0) {
+    remove_count_--;
+    reason = Reason::Count;
+  } else {
+    reason = Reason::Size;
+  }
+  remove_size_ -= file.size;
+  return true;
+}
+
+vector<FullFileInfo> FileGcQueue::extract_kept_files() {
+  auto result = std::move(candidate_files_);
+  candidate_files_.clear();
+  return result;
+}
+
+}  // namespace td
@@ -0,0 +1,40 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/telegram/files/FileStats.h"
+
+#include "td/utils/common.h"
+
+namespace td {
+
+// Files, which are removed by files gc, in the order of removal: all expired files first, and then the least recently
+// accessed files while the number or the total size of the remaining files exceed the limits. Only the removed files
+// are extracted from the heap, so the files can be removed in slices without sorting all of them beforehand.
+class FileGcQueue {
+ public:
+  enum class Reason : int32 { Expired, Count, Size };
+
+  FileGcQueue() = default;
+  FileGcQueue(vector<FullFileInfo> expired_files, vector<FullFileInfo> files, size_t max_file_count,
+              int64 max_files_size);
+
+  // returns false, if there are no more files to remove
+  bool pop(FullFileInfo &file, Reason &reason);
+
+  // returns the files, which will not be removed
+  vector<FullFileInfo> extract_kept_files();
+
+ private:
+  vector<FullFileInfo> expired_files_;
+  // heap of the files, which can be removed because of limits, with the least recently accessed file on top
+  vector<FullFileInfo> candidate_files_;
+  size_t remove_count_ = 0;
+  int64 remove_size_ = 0;
+};
+
+}  // namespace td
@@ -6,6 +6,7 @@
 //
 #include "td/telegram/files/FileGcWorker.h"
 
+#include "td/telegram/files/FileContentStore.h"
 #include "td/telegram/files/FileLocation.h"
 #include "td/telegram/files/FileManager.h"
 #include "td/telegram/files/FileType.h"
@@ -28,11 +29,12 @@ int VERBOSITY_NAME(file_gc) = VERBOSITY_NAME(INFO);
 
 void FileGcWorker::run_gc(const FileGcParameters &parameters, std::vector<FullFileInfo> files,
                           Promise<FileGcResult> promise) {
-  auto begin_time = Time::now();
+  if (promise_) {
+    promise_.set_error(Status::Error(500, "Request aborted"));
+  }
+  promise_ = std::move(promise);
+  begin_time_ = Time::now();
   VLOG(file_gc) << "Start files gc with " << parameters;
-  // quite stupid implementations
-  // needs a lot of memory
-  // may write something more clever, but i will need at least 2 passes over the files
   // TODO update atime for all files in android (?)
 
   std::array<bool, MAX_FILE_TYPE> immune_types{{false}};
@@ -63,130 +65,157 @@ void FileGcWorker::run_gc(const FileGcParameters &parameters, std::vector<FullFi
     immune_types[narrow_cast<size_t>(FileType::EncryptedThumbnail)] = true;
   }
 
-  auto file_cnt = files.size();
-  int32 type_immunity_ignored_cnt = 0;
-  int32 time_immunity_ignored_cnt = 0;
-  int32 exclude_owner_dialog_id_ignored_cnt = 0;
-  int32 owner_dialog_id_ignored_cnt = 0;
-  int32 remove_by_atime_cnt = 0;
-  int32 remove_by_count_cnt = 0;
-  int32 remove_by_size_cnt = 0;
-  int64 total_removed_size = 0;
-  int64 total_size = 0;
+  file_cnt_ = files.size();
+  type_immunity_ignored_cnt_ = 0;
+  time_immunity_ignored_cnt_ = 0;
+  exclude_owner_dialog_id_ignored_cnt_ = 0;
+  owner_dialog_id_ignored_cnt_ = 0;
+  remove_by_atime_cnt_ = 0;
+  remove_by_count_cnt_ = 0;
+  remove_by_size_cnt_ = 0;
+  remove_unused_content_cnt_ = 0;
+  total_removed_size_ = 0;
+  total_size_ = 0;
   for (auto &info : files) {
     if (info.atime_nsec < info.mtime_nsec) {
       info.atime_nsec = info.mtime_nsec;
     }
-    total_size += info.size;
+    total_size_ += info.size;
   }
 
-  FileStats new_stats;
-  FileStats removed_stats;
-  removed_stats.split_by_owner_dialog_id = new_stats.split_by_owner_dialog_id = parameters.dialog_limit != 0;
-
-  auto do_remove_file = [&removed_stats](const FullFileInfo &info) {
-    removed_stats.add_copy(info);
-    auto status = unlink(info.path);
-    LOG_IF(WARNING, status.is_error()) << "Failed to unlink file \"" << info.path << "\" during files gc: " << status;
-    send_closure(G()->file_manager(), &FileManager::on_file_unlink,
-                 FullLocalFileLocation(info.file_type, info.path, info.mtime_nsec));
-  };
+  new_stats_ = FileStats();
+  removed_stats_ = FileStats();
+  removed_stats_.split_by_owner_dialog_id = new_stats_.split_by_owner_dialog_id = parameters.dialog_limit != 0;
 
   double now = Clocks::system();
 
   // Keep all immune files
   // Remove all files with (atime > now - max_time_from_last_access)
-  td::remove_if(files, [&](const FullFileInfo &info) {
-    if (token_) {
-      return false;
-    }
+  // The files are only classified here; they are removed later in slices
+  std::vector<FullFileInfo> expired_files;
+  td::remove_if(files, [&](FullFileInfo &info) {
     if (immune_types[narrow_cast<size_t>(info.file_type)]) {
-      type_immunity_ignored_cnt++;
-      new_stats.add_copy(info);
+      type_immunity_ignored_cnt_++;
+      new_stats_.add_copy(info);
       return true;
     }
     if (td::contains(parameters.exclude_owner_dialog_ids, info.owner_dialog_id)) {
-      exclude_owner_dialog_id_ignored_cnt++;
-      new_stats.add_copy(info);
+      exclude_owner_dialog_id_ignored_cnt_++;
+      new_stats_.add_copy(info);
       return true;
     }
     if (!parameters.owner_dialog_ids.empty() && !td::contains(parameters.owner_dialog_ids, info.owner_dialog_id)) {
-      owner_dialog_id_ignored_cnt++;
-      new_stats.add_copy(info);
+      owner_dialog_id_ignored_cnt_++;
+      new_stats_.add_copy(info);
       return true;
     }
     if (static_cast<double>(info.mtime_nsec) * 1e-9 > now - parameters.immunity_delay) {
       // new files are immune to gc
-      time_immunity_ignored_cnt++;
-      new_stats.add_copy(info);
+      time_immunity_ignored_cnt_++;
+      new_stats_.add_copy(info);
       return true;
     }
 
     if (static_cast<double>(info.atime_nsec) * 1e-9 < now - parameters.max_time_from_last_access) {
-      do_remove_file(info);
-      total_removed_size += info.size;
-      remove_by_atime_cnt++;
+      expired_files.push_back(std::move(info));
       return true;
     }
     return false;
   });
-  if (token_) {
-    return promise.set_error(Status::Error(500, "Request aborted"));
-  }
 
-  // sort by max(atime, mtime)
-  std::sort(files.begin(), files.end(), [](const auto &a, const auto &b) { return a.atime_nsec < b.atime_nsec; });
+  queue_ = FileGcQueue(std::move(expired_files), std::move(files), parameters.max_file_count,
+                       parameters.max_files_size);
+  are_file_contents_listed_ = false;
+  file_content_paths_.clear();
 
-  // 1. Total size must be less than parameters.max_files_size
-  // 2. Total file count must be less than parameters.max_file_count
-  size_t remove_count = 0;
-  if (files.size() > parameters.max_file_count) {
-    remove_count = files.size() - parameters.max_file_count;
+  loop();
+}
+
+void FileGcWorker::do_remove_file(const FullFileInfo &info) {
+  removed_stats_.add_copy(info);
+  total_removed_size_ += info.size;
+  auto status = unlink(info.path);
+  LOG_IF(WARNING, status.is_error()) << "Failed to unlink file \"" << info.path << "\" during files gc: " << status;
+  send_closure(G()->file_manager(), &FileManager::on_file_unlink,
+               FullLocalFileLocation(info.file_type, info.path, info.mtime_nsec));
+}
+
+void FileGcWorker::loop() {
+  if (!promise_) {
+    return;
   }
-  int64 remove_size = -parameters.max_files_size;
-  for (auto &file : files) {
-    remove_size += file.size;
+  if (token_) {
+    queue_ = FileGcQueue();
+    file_content_paths_.clear();
+    return promise_.set_error(Status::Error(500, "Request aborted"));
   }
 
-  size_t pos = 0;
-  while (pos < files.size() && (remove_count > 0 || remove_size > 0)) {
-    if (token_) {
-      return promise.set_error(Status::Error(500, "Request aborted"));
-    }
-    if (remove_count > 0) {
-      remove_by_count_cnt++;
-    } else {
-      remove_by_size_cnt++;
+  auto slice_end_time = Time::now() + GC_SLICE_TIME;
+  while (Time::now() < slice_end_time) {
+    FullFileInfo file;
+    FileGcQueue::Reason reason;
+    if (!queue_.pop(file, reason)) {
+      // contents of deduplicated files, all links to which were removed, are now unused
+      if (!are_file_contents_listed_) {
+        file_content_paths_ = get_file_content_paths();
+        are_file_contents_listed_ = true;
+        continue;
+      }
+      if (file_content_paths_.empty()) {
+        return finish_gc();
+      }
+      if (remove_file_content_if_unused(file_content_paths_.back())) {
+        remove_unused_content_cnt_++;
+      }
+      file_content_paths_.pop_back();
+      continue;
     }
-
-    if (remove_count > 0) {
-      remove_count--;
+    switch (reason) {
+      case FileGcQueue::Reason::Expired:
+        remove_by_atime_cnt_++;
+        break;
+      case FileGcQueue::Reason::Count:
+        remove_by_count_cnt_++;
+        break;
+      case FileGcQueue::Reason::Size:
+        remove_by_size_cnt_++;
+        break;
+      default:
+        UNREACHABLE();
     }
-    remove_size -= files[pos].size;
-
-    total_removed_size += files[pos].size;
-    do_remove_file(files[pos]);
-    pos++;
+    do_remove_file(file);
   }
 
-  while (pos < files.size()) {
-    new_stats.add_copy(files[pos]);
-    pos++;
+  // continue after other actors of the scheduler have run
+  yield();
+}
+
+void FileGcWorker::finish_gc() {
+  for (auto &file : queue_.extract_kept_files()) {
+    new_stats_.add_copy(file);
   }
 
   auto end_time = Time::now();
 
-  VLOG(file_gc) << "Finish files gc: " << tag("time", end_time - begin_time) << tag("total", file_cnt)
-                << tag("removed", remove_by_atime_cnt + remove_by_count_cnt + remove_by_size_cnt)
-                << tag("total_size", format::as_size(total_size))
-                << tag("total_removed_size", format::as_size(total_removed_size))
-                << tag("by_atime", remove_by_atime_cnt) << tag("by_count", remove_by_count_cnt)
-                << tag("by_size", remove_by_size_cnt) << tag("type_immunity", type_immunity_ignored_cnt)
-                << tag("time_immunity", time_immunity_ignored_cnt)
-                << tag("owner_dialog_id_immunity", owner_dialog_id_ignored_cnt)
-                << tag("exclude_owner_dialog_id_immunity", exclude_owner_dialog_id_ignored_cnt);
-
-  promise.set_value({std::move(new_stats), std::move(removed_stats)});
+  VLOG(file_gc) << "Finish files gc: " << tag("time", end_time - begin_time_) << tag("total", file_cnt_)
+                << tag("removed", remove_by_atime_cnt_ + remove_by_count_cnt_ + remove_by_size_cnt_)
+                << tag("total_size", format::as_size(total_size_))
+                << tag("total_removed_size", format::as_size(total_removed_size_))
+                << tag("by_atime", remove_by_atime_cnt_) << tag("by_count", remove_by_count_cnt_)
+                << tag("by_size", remove_by_size_cnt_) << tag("unused_contents", remove_unused_content_cnt_)
+                << tag("type_immunity", type_immunity_ignored_cnt_)
+                << tag("time_immunity", time_immunity_ignored_cnt_)
+                << tag("owner_dialog_id_immunity", owner_dialog_id_ignored_cnt_)
+                << tag("exclude_owner_dialog_id_immunity", exclude_owner_dialog_id_ignored_cnt_);
+
+  promise_.set_value({std::move(new_stats_), std::move(removed_stats_)});
+}
+
+void FileGcWorker::hangup() {
+  if (promise_) {
+    promise_.set_error(Status::Error(500, "Request aborted"));
+  }
+  stop();
 }
 
 }  // namespace td
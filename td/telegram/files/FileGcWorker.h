@@ -10,6 +10,7 @@
 #include "td/actor/PromiseFuture.h"
 
 #include "td/telegram/files/FileGcParameters.h"
+#include "td/telegram/files/FileGcQueue.h"
 #include "td/telegram/files/FileStats.h"
 
 #include "td/utils/CancellationToken.h"
@@ -31,8 +32,42 @@ class FileGcWorker : public Actor {
   void run_gc(const FileGcParameters &parameters, std::vector<FullFileInfo> files, Promise<FileGcResult> promise);
 
  private:
+  // files are removed in slices, so that the scheduler isn't blocked for a long time by a big cache
+  static constexpr double GC_SLICE_TIME = 0.01;
+
   ActorShared<> parent_;
   CancellationToken token_;
+
+  Promise<FileGcResult> promise_;
+  double begin_time_ = 0;
+
+  FileGcQueue queue_;
+
+  // contents of deduplicated files, which are checked for references after the files are removed
+  bool are_file_contents_listed_ = false;
+  vector<string> file_content_paths_;
+
+  FileStats new_stats_;
+  FileStats removed_stats_;
+
+  size_t file_cnt_ = 0;
+  int32 type_immunity_ignored_cnt_ = 0;
+  int32 time_immunity_ignored_cnt_ = 0;
+  int32 exclude_owner_dialog_id_ignored_cnt_ = 0;
+  int32 owner_dialog_id_ignored_cnt_ = 0;
+  int32 remove_by_atime_cnt_ = 0;
+  int32 remove_by_count_cnt_ = 0;
+  int32 remove_by_size_cnt_ = 0;
+  int32 remove_unused_content_cnt_ = 0;
+  int64 total_removed_size_ = 0;
+  int64 total_size_ = 0;
+
+  void do_remove_file(const FullFileInfo &info);
+
+  void finish_gc();
+
+  void loop() override;
+  void hangup() override;
 };
 
 }  // namespace td
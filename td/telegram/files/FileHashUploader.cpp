@@ -21,7 +21,6 @@
 #include "td/utils/misc.h"
 #include "td/utils/PathView.h"
 #include "td/utils/port/FileFd.h"
-#include "td/utils/port/PollFlags.h"
 #include "td/utils/Status.h"
 
 namespace td {
@@ -33,6 +32,7 @@ void FileHashUploader::start_up() {
     stop_flag_ = true;
     return;
   }
+  yield();
 }
 
 Status FileHashUploader::init() {
@@ -41,11 +41,6 @@ Status FileHashUploader::init() {
   if (file_size != size_) {
     return Status::Error("Size mismatch");
   }
-  fd_ = BufferedFd<FileFd>(std::move(fd));
-  sha256_state_.init();
-
-  resource_state_.set_unit_size(1024);
-  resource_state_.update_estimated_limit(size_);
   return Status::OK();
 }
 
@@ -64,15 +59,19 @@ void FileHashUploader::loop() {
 
 Status FileHashUploader::loop_impl() {
   if (state_ == State::CalcSha) {
-    TRY_STATUS(loop_sha());
+    // the whole file is hashed in the FileIoService, so no network resources are needed until the hash is known
+    auto promise = PromiseCreator::lambda([actor_id = actor_id(this)](Result<string> r_hash) {
+      send_closure(actor_id, &FileHashUploader::on_sha256, std::move(r_hash));
+    });
+    send_closure(file_io_service_, &FileIoService::compute_file_sha256, local_.path_, size_,
+                 sha256_cancellation_token_source_.get_cancellation_token(), std::move(promise));
+    state_ = State::WaitSha;
   }
   if (state_ == State::NetRequest) {
     // messages.getDocumentByHash#338e2464 sha256:bytes size:int mime_type:string = Document;
-    auto hash = BufferSlice(32);
-    sha256_state_.extract(hash.as_slice(), true);
     auto mime_type = MimeType::from_extension(PathView(local_.path_).extension(), "image/gif");
-    auto query =
-        telegram_api::messages_getDocumentByHash(std::move(hash), static_cast<int32>(size_), std::move(mime_type));
+    auto query = telegram_api::messages_getDocumentByHash(BufferSlice(hash_), static_cast<int32>(size_),
+                                                          std::move(mime_type));
     LOG(INFO) << "Send getDocumentByHash request: " << to_string(query);
     auto ptr = G()->net_query_creator().create(query);
     G()->net_query_dispatcher().dispatch_with_callback(std::move(ptr), actor_shared(this));
@@ -81,38 +80,19 @@ Status FileHashUploader::loop_impl() {
   return Status::OK();
 }
 
-Status FileHashUploader::loop_sha() {
-  auto limit = resource_state_.unused();
-  if (limit == 0) {
-    return Status::OK();
-  }
-  if (limit > size_left_) {
-    limit = size_left_;
-  }
-  resource_state_.start_use(limit);
-
-  fd_.get_poll_info().add_flags(PollFlags::Read());
-  TRY_RESULT(read_size, fd_.flush_read(static_cast<size_t>(limit)));
-  if (read_size != static_cast<size_t>(limit)) {
-    return Status::Error("Unexpected end of file");
-  }
-  while (true) {
-    auto ready = fd_.input_buffer().prepare_read();
-    if (ready.empty()) {
-      break;
-    }
-    sha256_state_.feed(ready);
-    fd_.input_buffer().confirm_read(ready.size());
+void FileHashUploader::on_sha256(Result<string> r_hash) {
+  if (stop_flag_) {
+    return;
   }
-  resource_state_.stop_use(limit);
-
-  size_left_ -= narrow_cast<int64>(read_size);
-  CHECK(size_left_ >= 0);
-  if (size_left_ == 0) {
-    state_ = State::NetRequest;
-    return Status::OK();
+  CHECK(state_ == State::WaitSha);
+  if (r_hash.is_error()) {
+    callback_->on_error(r_hash.move_as_error());
+    stop_flag_ = true;
+    return;
   }
-  return Status::OK();
+  hash_ = r_hash.move_as_ok();
+  state_ = State::NetRequest;
+  loop();
 }
 
 void FileHashUploader::on_result(NetQueryPtr net_query) {
@@ -6,15 +6,15 @@
 //
 #pragma once
 
+#include "td/telegram/files/FileIoService.h"
 #include "td/telegram/files/FileLoaderActor.h"
 #include "td/telegram/files/FileLocation.h"
 #include "td/telegram/files/ResourceManager.h"
 
 #include "td/actor/actor.h"
 
-#include "td/utils/BufferedFd.h"
-#include "td/utils/crypto.h"
-#include "td/utils/port/FileFd.h"
+#include "td/utils/CancellationToken.h"
+#include "td/utils/common.h"
 #include "td/utils/Status.h"
 
 namespace td {
@@ -31,11 +31,12 @@ class FileHashUploader : public FileLoaderActor {
     virtual void on_error(Status status) = 0;
   };
 
-  FileHashUploader(const FullLocalFileLocation &local, int64 size, unique_ptr<Callback> callback)
-      : local_(local), size_(size), size_left_(size), callback_(std::move(callback)) {
+  FileHashUploader(const FullLocalFileLocation &local, int64 size, ActorId<FileIoService> file_io_service,
+                   unique_ptr<Callback> callback)
+      : local_(local), size_(size), file_io_service_(std::move(file_io_service)), callback_(std::move(callback)) {
   }
 
-  void set_resource_manager(ActorShared<ResourceManager> resource_manager) override {
+  void set_resource_manager(ActorShared<ResourceManager> resource_manager, size_t part_size_hint) override {
     resource_manager_ = std::move(resource_manager);
     send_closure(resource_manager_, &ResourceManager::update_resources, resource_state_);
   }
@@ -53,18 +54,18 @@ class FileHashUploader : public FileLoaderActor {
 
  private:
   ResourceState resource_state_;
-  BufferedFd<FileFd> fd_;
 
   FullLocalFileLocation local_;
   int64 size_;
-  int64 size_left_;
+  ActorId<FileIoService> file_io_service_;
   unique_ptr<Callback> callback_;
 
   ActorShared<ResourceManager> resource_manager_;
+  CancellationTokenSource sha256_cancellation_token_source_;  // hashing is cancelled together with the uploader
 
-  enum class State : int32 { CalcSha, NetRequest, WaitNetResult } state_ = State::CalcSha;
+  enum class State : int32 { CalcSha, WaitSha, NetRequest, WaitNetResult } state_ = State::CalcSha;
   bool stop_flag_ = false;
-  Sha256State sha256_state_;
+  string hash_;
 
   void start_up() override;
   Status init();
@@ -73,7 +74,7 @@ class FileHashUploader : public FileLoaderActor {
 
   Status loop_impl();
 
-  Status loop_sha();
+  void on_sha256(Result<string> r_hash);
 
   void on_result(NetQueryPtr net_query) override;
 
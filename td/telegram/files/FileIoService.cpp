@@ -0,0 +1,526 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/files/FileIoService.h"
+
+#include "td/telegram/files/FileContentStore.h"
+
+#include "td/utils/crypto.h"
+#include "td/utils/filesystem.h"
+#include "td/utils/logging.h"
+#include "td/utils/port/FileFd.h"
+#include "td/utils/port/PollFlags.h"
+#include "td/utils/port/Stat.h"
+#include "td/utils/port/thread.h"
+#include "td/utils/Status.h"
+
+#if TD_LINUX
+#include <fcntl.h>
+#endif
+
+#include <mutex>
+#include <utility>
+
+namespace td {
+
+class FileIoService::Job {
+ public:
+  Job() = default;
+  Job(const Job &) = delete;
+  Job &operator=(const Job &) = delete;
+  Job(Job &&) = delete;
+  Job &operator=(Job &&) = delete;
+  virtual ~Job() = default;
+
+  // called in a worker thread
+  virtual void run() = 0;
+
+  // called in the scheduler of the service; unfinished jobs are run again after the jobs queued in the meantime
+  virtual bool is_finished() const {
+    return true;
+  }
+
+  // called in the scheduler of the service
+  virtual void finish() = 0;
+
+  std::shared_ptr<JobQueue> finished_jobs_;
+  std::shared_ptr<std::atomic<bool>> is_service_closed_;
+};
+
+class FileIoService::WorkerPool {
+ public:
+  explicit WorkerPool(int32 thread_count) : workers_(static_cast<size_t>(thread_count)) {
+    for (auto &worker : workers_) {
+      worker.queue = std::make_shared<JobQueue>();
+      worker.queue->init();
+      worker.worker_thread = thread(run_worker, &worker);
+    }
+  }
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+  WorkerPool(WorkerPool &&) = delete;
+  WorkerPool &operator=(WorkerPool &&) = delete;
+  ~WorkerPool() {
+    for (auto &worker : workers_) {
+      worker.queue->writer_put(nullptr);
+    }
+    for (auto &worker : workers_) {
+      worker.worker_thread.join();
+    }
+  }
+
+  // returns the pool, shared by all alive services
+  static std::shared_ptr<WorkerPool> acquire(int32 thread_count) {
+    static std::mutex mutex;
+    static std::weak_ptr<WorkerPool> weak_pool;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto pool = weak_pool.lock();
+    if (pool == nullptr) {
+      pool = std::make_shared<WorkerPool>(thread_count);
+      weak_pool = pool;
+    }
+    return pool;
+  }
+
+  void add_job(JobPtr job) {
+    // a slow job blocks only its worker, so new jobs are sent to the least loaded worker
+    size_t worker_id = 0;
+    for (size_t i = 1; i < workers_.size(); i++) {
+      if (workers_[i].job_count.load(std::memory_order_relaxed) <
+          workers_[worker_id].job_count.load(std::memory_order_relaxed)) {
+        worker_id = i;
+      }
+    }
+    auto &worker = workers_[worker_id];
+    worker.job_count.fetch_add(1, std::memory_order_relaxed);
+    worker.queue->writer_put(std::move(job));
+  }
+
+ private:
+  struct Worker {
+    std::shared_ptr<JobQueue> queue;
+    thread worker_thread;
+    std::atomic<size_t> job_count{0};
+  };
+  vector<Worker> workers_;
+
+  static void run_worker(Worker *worker) {
+    while (true) {
+      auto ready_n = worker->queue->reader_wait();
+      while (ready_n-- > 0) {
+        auto job = worker->queue->reader_get_unsafe();
+        if (job == nullptr) {
+          return;
+        }
+        if (!job->is_service_closed_->load(std::memory_order_relaxed)) {
+          job->run();
+        }
+        worker->job_count.fetch_sub(1, std::memory_order_relaxed);
+        auto finished_jobs = job->finished_jobs_;
+        finished_jobs->writer_put(std::move(job));
+      }
+      worker->queue->reader_flush();
+    }
+  }
+};
+
+namespace {
+
+class ReadJob final : public FileIoService::Job {
+ public:
+  ReadJob(std::shared_ptr<FileFd> fd, int64 offset, size_t size, Promise<BufferSlice> promise)
+      : fd_(std::move(fd)), offset_(offset), size_(size), promise_(std::move(promise)) {
+  }
+
+  void run() final {
+    result_ = [&]() -> Result<BufferSlice> {
+      BufferSlice bytes(size_);
+      TRY_RESULT(read_size, fd_->pread(bytes.as_slice(), offset_));
+      bytes.truncate(read_size);
+      return std::move(bytes);
+    }();
+    fd_.reset();
+  }
+
+  void finish() final {
+    promise_.set_result(std::move(result_));
+  }
+
+ private:
+  std::shared_ptr<FileFd> fd_;
+  int64 offset_;
+  size_t size_;
+  Promise<BufferSlice> promise_;
+  Result<BufferSlice> result_;
+};
+
+class ReadStringJob final : public FileIoService::Job {
+ public:
+  ReadStringJob(string path, int64 offset, size_t size, Promise<string> promise)
+      : path_(std::move(path)), offset_(offset), size_(size), promise_(std::move(promise)) {
+  }
+
+  void run() final {
+    result_ = [&]() -> Result<string> {
+      TRY_RESULT(fd, FileFd::open(path_, FileFd::Read));
+      string data(size_, '\0');
+      TRY_RESULT(read_size, fd.pread(data, offset_));
+      if (read_size != size_) {
+        return Status::Error("Read less bytes than expected");
+      }
+      return std::move(data);
+    }();
+  }
+
+  void finish() final {
+    promise_.set_result(std::move(result_));
+  }
+
+ private:
+  string path_;
+  int64 offset_;
+  size_t size_;
+  Promise<string> promise_;
+  Result<string> result_;
+};
+
+class ReadFileJob final : public FileIoService::Job {
+ public:
+  ReadFileJob(string path, Promise<BufferSlice> promise) : path_(std::move(path)), promise_(std::move(promise)) {
+  }
+
+  void run() final {
+    result_ = read_file(path_);
+  }
+
+  void finish() final {
+    promise_.set_result(std::move(result_));
+  }
+
+ private:
+  string path_;
+  Promise<BufferSlice> promise_;
+  Result<BufferSlice> result_;
+};
+
+class WriteJob final : public FileIoService::Job {
+ public:
+  WriteJob(std::shared_ptr<FileFd> fd, int64 offset, BufferSlice data, Promise<size_t> promise)
+      : fd_(std::move(fd)), offset_(offset), data_(std::move(data)), promise_(std::move(promise)) {
+  }
+
+  void run() final {
+    result_ = fd_->pwrite(data_.as_slice(), offset_);
+    data_ = BufferSlice();
+    fd_.reset();
+  }
+
+  void finish() final {
+    promise_.set_result(std::move(result_));
+  }
+
+ private:
+  std::shared_ptr<FileFd> fd_;
+  int64 offset_;
+  BufferSlice data_;
+  Promise<size_t> promise_;
+  Result<size_t> result_;
+};
+
+class Sha256Job final : public FileIoService::Job {
+ public:
+  Sha256Job(std::shared_ptr<FileFd> fd, int64 offset, size_t size, Promise<string> promise)
+      : fd_(std::move(fd)), offset_(offset), size_(size), promise_(std::move(promise)) {
+  }
+
+  void run() final {
+    result_ = [&]() -> Result<string> {
+      BufferSlice bytes(size_);
+      TRY_RESULT(read_size, fd_->pread(bytes.as_slice(), offset_));
+      if (read_size != size_) {
+        return Status::Error("Failed to read file to check hash");
+      }
+      string hash(32, ' ');
+      sha256(bytes.as_slice(), hash);
+      return std::move(hash);
+    }();
+    fd_.reset();
+  }
+
+  void finish() final {
+    promise_.set_result(std::move(result_));
+  }
+
+ private:
+  std::shared_ptr<FileFd> fd_;
+  int64 offset_;
+  size_t size_;
+  Promise<string> promise_;
+  Result<string> result_;
+};
+
+// computes SHA256 of a whole file in slices
+class FileSha256Computation {
+ public:
+  FileSha256Computation(string path, int64 size, CancellationToken cancellation_token)
+      : path_(std::move(path)), size_(size), cancellation_token_(std::move(cancellation_token)) {
+  }
+
+  const string &get_path() const {
+    return path_;
+  }
+
+  // the state of the file, when it was opened
+  const Stat &get_file_stat() const {
+    return file_stat_;
+  }
+
+  // returns the hash after the last slice and an empty string after other slices
+  Result<string> run_slice() {
+    if (fd_.empty()) {
+      TRY_RESULT_ASSIGN(fd_, FileFd::open(path_, FileFd::Read));
+      TRY_RESULT_ASSIGN(file_stat_, fd_.stat());
+      if (file_stat_.size_ != size_) {
+        return Status::Error("Size mismatch");
+      }
+#if TD_LINUX
+      // ask for more aggressive kernel read-ahead, so the disk works while the previous chunk is hashed
+      posix_fadvise(fd_.get_native_fd().fd(), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+      sha256_state_.init();
+      chunk_ = BufferSlice(CHUNK_SIZE);
+    }
+
+    auto slice_end = min(offset_ + SLICE_SIZE, size_);
+    while (offset_ < slice_end) {
+      if (cancellation_token_) {
+        return Status::Error(500, "Request aborted");
+      }
+      auto size = static_cast<size_t>(min(static_cast<int64>(CHUNK_SIZE), size_ - offset_));
+      TRY_RESULT(read_size, fd_.pread(chunk_.as_slice().truncate(size), offset_));
+      if (read_size != size) {
+        return Status::Error("Unexpected end of file");
+      }
+      sha256_state_.feed(chunk_.as_slice().truncate(size));
+      offset_ += static_cast<int64>(size);
+    }
+    if (offset_ < size_) {
+      return string();
+    }
+    string hash(32, ' ');
+    sha256_state_.extract(hash, true);
+    return std::move(hash);
+  }
+
+  void close() {
+    fd_.close();
+    chunk_ = BufferSlice();
+  }
+
+ private:
+  static constexpr size_t CHUNK_SIZE = 1 << 20;
+  static constexpr int64 SLICE_SIZE = 1 << 24;
+
+  string path_;
+  int64 size_;
+  CancellationToken cancellation_token_;
+
+  FileFd fd_;
+  Stat file_stat_;
+  Sha256State sha256_state_;
+  BufferSlice chunk_;
+  int64 offset_ = 0;
+};
+
+class FileSha256Job final : public FileIoService::Job {
+ public:
+  FileSha256Job(string path, int64 size, CancellationToken cancellation_token, Promise<string> promise)
+      : computation_(std::move(path), size, std::move(cancellation_token)), promise_(std::move(promise)) {
+  }
+
+  void run() final {
+    auto r_hash = computation_.run_slice();
+    if (r_hash.is_error() || !r_hash.ok().empty()) {
+      computation_.close();
+      result_ = std::move(r_hash);
+      is_finished_ = true;
+    }
+  }
+
+  bool is_finished() const final {
+    return is_finished_;
+  }
+
+  void finish() final {
+    promise_.set_result(std::move(result_));
+  }
+
+ private:
+  FileSha256Computation computation_;
+  Promise<string> promise_;
+  Result<string> result_;
+  bool is_finished_ = false;
+};
+
+class DeduplicateFileJob final : public FileIoService::Job {
+ public:
+  DeduplicateFileJob(string content_dir, string path, int64 size, CancellationToken cancellation_token,
+                     Promise<uint64> promise)
+      : content_dir_(std::move(content_dir))
+      , computation_(std::move(path), size, std::move(cancellation_token))
+      , promise_(std::move(promise)) {
+  }
+
+  void run() final {
+    auto r_hash = computation_.run_slice();
+    if (r_hash.is_ok() && r_hash.ok().empty()) {
+      return;
+    }
+    computation_.close();
+    is_finished_ = true;
+    if (r_hash.is_error()) {
+      result_ = r_hash.move_as_error();
+      return;
+    }
+    result_ = deduplicate_file(content_dir_, computation_.get_path(), computation_.get_file_stat(), r_hash.ok());
+  }
+
+  bool is_finished() const final {
+    return is_finished_;
+  }
+
+  void finish() final {
+    promise_.set_result(std::move(result_));
+  }
+
+ private:
+  string content_dir_;
+  FileSha256Computation computation_;
+  Promise<uint64> promise_;
+  Result<uint64> result_;
+  bool is_finished_ = false;
+};
+
+}  // namespace
+
+FileIoService::FileIoService(int32 thread_count) : thread_count_(thread_count) {
+}
+
+FileIoService::~FileIoService() = default;
+
+void FileIoService::read(std::shared_ptr<FileFd> fd, int64 offset, size_t size, Promise<BufferSlice> promise) {
+  CHECK(fd != nullptr);
+  add_job(td::make_unique<ReadJob>(std::move(fd), offset, size, std::move(promise)));
+}
+
+void FileIoService::read_string(string path, int64 offset, size_t size, Promise<string> promise) {
+  add_job(td::make_unique<ReadStringJob>(std::move(path), offset, size, std::move(promise)));
+}
+
+void FileIoService::read_file(string path, Promise<BufferSlice> promise) {
+  add_job(td::make_unique<ReadFileJob>(std::move(path), std::move(promise)));
+}
+
+void FileIoService::write(std::shared_ptr<FileFd> fd, int64 offset, BufferSlice data, Promise<size_t> promise) {
+  CHECK(fd != nullptr);
+  add_job(td::make_unique<WriteJob>(std::move(fd), offset, std::move(data), std::move(promise)));
+}
+
+void FileIoService::compute_sha256(std::shared_ptr<FileFd> fd, int64 offset, size_t size, Promise<string> promise) {
+  CHECK(fd != nullptr);
+  add_job(td::make_unique<Sha256Job>(std::move(fd), offset, size, std::move(promise)));
+}
+
+void FileIoService::compute_file_sha256(string path, int64 size, CancellationToken cancellation_token,
+                                        Promise<string> promise) {
+  add_job(td::make_unique<FileSha256Job>(std::move(path), size, std::move(cancellation_token), std::move(promise)));
+}
+
+void FileIoService::deduplicate_file(string content_dir, string path, int64 size,
+                                     CancellationToken cancellation_token, Promise<uint64> promise) {
+  add_job(td::make_unique<DeduplicateFileJob>(std::move(content_dir), std::move(path), size,
+                                              std::move(cancellation_token), std::move(promise)));
+}
+
+void FileIoService::add_job(JobPtr job) {
+  if (worker_pool_ == nullptr) {
+    do {
+      job->run();
+    } while (!job->is_finished());
+    job->finish();
+    return;
+  }
+
+  job->finished_jobs_ = finished_jobs_;
+  job->is_service_closed_ = is_closed_;
+  job_count_++;
+  worker_pool_->add_job(std::move(job));
+}
+
+void FileIoService::start_up() {
+#if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED && !TD_PORT_WINDOWS
+  if (thread_count_ <= 0) {
+    return;
+  }
+  finished_jobs_ = std::make_shared<JobQueue>();
+  finished_jobs_->init();
+  auto &fd = finished_jobs_->reader_get_event_fd();
+  Scheduler::subscribe(fd.get_poll_info().extract_pollable_fd(this), PollFlags::Read());
+  is_subscribed_ = true;
+  is_closed_ = std::make_shared<std::atomic<bool>>(false);
+
+  worker_pool_ = WorkerPool::acquire(thread_count_);
+  yield();
+#endif
+}
+
+void FileIoService::loop() {
+  if (finished_jobs_ == nullptr) {
+    return;
+  }
+  auto ready_n = finished_jobs_->reader_wait_nonblock();
+  if (ready_n == 0) {
+    return;
+  }
+  while (ready_n-- > 0) {
+    auto job = finished_jobs_->reader_get_unsafe();
+    CHECK(job_count_ > 0);
+    job_count_--;
+    if (!job->is_finished()) {
+      add_job(std::move(job));
+      continue;
+    }
+    job->finish();
+  }
+  finished_jobs_->reader_flush();
+  yield();
+}
+
+void FileIoService::tear_down() {
+  if (is_subscribed_) {
+    Scheduler::unsubscribe(finished_jobs_->reader_get_event_fd().get_poll_info().get_pollable_fd_ref());
+    is_subscribed_ = false;
+  }
+  if (worker_pool_ == nullptr) {
+    return;
+  }
+
+  // queued jobs are returned without running, so only currently running jobs need to be waited for;
+  // promises of unfinished jobs are destroyed together with the jobs in the scheduler of the service
+  is_closed_->store(true, std::memory_order_relaxed);
+  while (job_count_ > 0) {
+    auto ready_n = finished_jobs_->reader_wait();
+    CHECK(static_cast<size_t>(ready_n) <= job_count_);
+    job_count_ -= ready_n;
+    while (ready_n-- > 0) {
+      finished_jobs_->reader_get_unsafe();
+    }
+    finished_jobs_->reader_flush();
+  }
+  worker_pool_.reset();
+}
+
+}  // namespace td
@@ -0,0 +1,81 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/actor/actor.h"
+#include "td/actor/PromiseFuture.h"
+
+#include "td/utils/buffer.h"
+#include "td/utils/CancellationToken.h"
+#include "td/utils/common.h"
+#include "td/utils/MpscPollableQueue.h"
+#include "td/utils/port/FileFd.h"
+
+#include <atomic>
+#include <memory>
+
+namespace td {
+
+// Executes blocking file reads, writes and hash computations in a pool of worker threads, which is shared by all
+// services in the process, so the number of threads doesn't grow with the number of clients.
+// Promises are set in the scheduler of the service, so it should be created in the scheduler of its users.
+// Part jobs use the file descriptor of the caller, which stays open until the job finishes even if the caller releases
+// it or the file is renamed. Whole-file jobs open the file by path once.
+class FileIoService final : public Actor {
+ public:
+  // the thread count is used only if there is no worker pool yet; if it is 0, then jobs are run synchronously
+  explicit FileIoService(int32 thread_count);
+  FileIoService(const FileIoService &) = delete;
+  FileIoService &operator=(const FileIoService &) = delete;
+  FileIoService(FileIoService &&) = delete;
+  FileIoService &operator=(FileIoService &&) = delete;
+  ~FileIoService() override;
+
+  // returns less than size bytes only if the end of the file is reached
+  void read(std::shared_ptr<FileFd> fd, int64 offset, size_t size, Promise<BufferSlice> promise);
+
+  // reads the bytes directly into a string, which can be moved to a td_api object; fails if there are less bytes
+  void read_string(string path, int64 offset, size_t size, Promise<string> promise);
+
+  void read_file(string path, Promise<BufferSlice> promise);
+
+  void write(std::shared_ptr<FileFd> fd, int64 offset, BufferSlice data, Promise<size_t> promise);
+
+  void compute_sha256(std::shared_ptr<FileFd> fd, int64 offset, size_t size, Promise<string> promise);
+
+  // streams the whole file, which must have the specified size, through SHA256; big files are hashed in slices,
+  // between which other jobs can run and the computation can be cancelled
+  void compute_file_sha256(string path, int64 size, CancellationToken cancellation_token, Promise<string> promise);
+
+  // hashes the file like compute_file_sha256 and then deduplicates it in the content_dir like deduplicate_file;
+  // returns the modification time of the file after deduplication
+  void deduplicate_file(string content_dir, string path, int64 size, CancellationToken cancellation_token,
+                        Promise<uint64> promise);
+
+  class Job;
+
+ private:
+  using JobPtr = unique_ptr<Job>;
+  using JobQueue = MpscPollableQueue<JobPtr>;
+
+  class WorkerPool;
+
+  int32 thread_count_;
+  std::shared_ptr<WorkerPool> worker_pool_;
+  std::shared_ptr<JobQueue> finished_jobs_;
+  std::shared_ptr<std::atomic<bool>> is_closed_;  // jobs of a closed service are returned without running
+  size_t job_count_ = 0;
+  bool is_subscribed_ = false;
+
+  void start_up() override;
+  void loop() override;
+  void tear_down() override;
+
+  void add_job(JobPtr job);
+};
+
+}  // namespace td
@@ -6,16 +6,18 @@
 //
 #include "td/telegram/files/FileLoadManager.h"
 
+#include "td/telegram/files/FileContentStore.h"
 #include "td/telegram/Global.h"
 #include "td/telegram/net/DcId.h"
 
 #include "td/utils/common.h"
-#include "td/utils/filesystem.h"
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
 
 namespace td {
 
+constexpr int32 FileLoadManager::FILE_IO_THREAD_COUNT;
+
 FileLoadManager::FileLoadManager(ActorShared<Callback> callback, ActorShared<> parent)
     : callback_(std::move(callback)), parent_(std::move(parent)) {
 }
@@ -25,6 +27,7 @@ void FileLoadManager::start_up() {
       create_actor<ResourceManager>("UploadResourceManager", !G()->parameters().use_file_db /*tdlib_engine*/
                                                                  ? ResourceManager::Mode::Greedy
                                                                  : ResourceManager::Mode::Baseline);
+  file_io_service_ = create_actor<FileIoService>("FileIoService", FILE_IO_THREAD_COUNT);
 }
 
 ActorOwn<ResourceManager> &FileLoadManager::get_download_resource_manager(bool is_small, DcId dc_id) {
@@ -53,7 +56,7 @@ void FileLoadManager::download(QueryId id, const FullRemoteFileLocation &remote_
   bool is_small = size < 20 * 1024;
   node->loader_ =
       create_actor<FileDownloader>("Downloader", remote_location, local, size, std::move(name), encryption_key,
-                                   is_small, search_file, offset, limit, std::move(callback));
+                                   is_small, search_file, offset, limit, file_io_service_.get(), std::move(callback));
   DcId dc_id = remote_location.is_web() ? G()->get_webfile_dc_id() : remote_location.get_dc_id();
   auto &resource_manager = get_download_resource_manager(is_small, dc_id);
   send_closure(resource_manager, &ResourceManager::register_worker,
@@ -74,7 +77,7 @@ void FileLoadManager::upload(QueryId id, const LocalFileLocation &local_location
   node->query_id_ = id;
   auto callback = make_unique<FileUploaderCallback>(actor_shared(this, node_id));
   node->loader_ = create_actor<FileUploader>("Uploader", local_location, remote_location, expected_size, encryption_key,
-                                             std::move(bad_parts), std::move(callback));
+                                             std::move(bad_parts), file_io_service_.get(), std::move(callback));
   send_closure(upload_resource_manager_, &ResourceManager::register_worker,
                ActorShared<FileLoaderActor>(node->loader_.get(), static_cast<uint64>(-1)), priority);
   query_id_to_node_id_[id] = node_id;
@@ -91,7 +94,8 @@ void FileLoadManager::upload_by_hash(QueryId id, const FullLocalFileLocation &lo
   CHECK(node);
   node->query_id_ = id;
   auto callback = make_unique<FileHashUploaderCallback>(actor_shared(this, node_id));
-  node->loader_ = create_actor<FileHashUploader>("HashUploader", local_location, size, std::move(callback));
+  node->loader_ = create_actor<FileHashUploader>("HashUploader", local_location, size, file_io_service_.get(),
+                                                 std::move(callback));
   send_closure(upload_resource_manager_, &ResourceManager::register_worker,
                ActorShared<FileLoaderActor>(node->loader_.get(), static_cast<uint64>(-1)), priority);
   query_id_to_node_id_[id] = node_id;
@@ -128,8 +132,35 @@ void FileLoadManager::from_bytes(QueryId id, FileType type, BufferSlice bytes, s
 }
 
 void FileLoadManager::get_content(const FullLocalFileLocation &local_location, Promise<BufferSlice> promise) {
-  // TODO: send query to other thread
-  promise.set_result(read_file(local_location.path_));
+  send_closure(file_io_service_, &FileIoService::read_file, local_location.path_, std::move(promise));
+}
+
+void FileLoadManager::read_file_part(string path, int64 offset, size_t size, Promise<string> promise) {
+  send_closure(file_io_service_, &FileIoService::read_string, std::move(path), offset, size, std::move(promise));
+}
+
+void FileLoadManager::deduplicate(const FullLocalFileLocation &local_location, int64 size) {
+  if (stop_flag_) {
+    return;
+  }
+  auto promise = PromiseCreator::lambda([actor_id = actor_id(this), local_location](Result<uint64> r_mtime_nsec) {
+    if (r_mtime_nsec.is_error()) {
+      LOG(INFO) << "Failed to deduplicate " << local_location << ": " << r_mtime_nsec.error();
+    } else if (r_mtime_nsec.ok() != local_location.mtime_nsec_) {
+      LOG(INFO) << "Replace " << local_location << " with a link to the same stored content";
+      send_closure(actor_id, &FileLoadManager::on_deduplicated, local_location, r_mtime_nsec.ok());
+    }
+  });
+  send_closure(file_io_service_, &FileIoService::deduplicate_file, get_files_content_dir(local_location.file_type_),
+               local_location.path_, size, deduplicate_cancellation_token_source_.get_cancellation_token(),
+               std::move(promise));
+}
+
+void FileLoadManager::on_deduplicated(const FullLocalFileLocation &local, uint64 mtime_nsec) {
+  if (stop_flag_) {
+    return;
+  }
+  send_closure(callback_, &Callback::on_file_deduplicated, local, mtime_nsec);
 }
 
 // void upload_reload_parts(QueryId id, vector<int32> parts);
@@ -176,6 +207,7 @@ void FileLoadManager::update_downloaded_part(QueryId id, int64 offset, int64 lim
 
 void FileLoadManager::hangup() {
   nodes_container_.for_each([](auto id, auto &node) { node.loader_.reset(); });
+  deduplicate_cancellation_token_source_.cancel();
   stop_flag_ = true;
   loop();
 }
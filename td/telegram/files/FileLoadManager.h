@@ -13,6 +13,7 @@
 #include "td/telegram/files/FileEncryptionKey.h"
 #include "td/telegram/files/FileFromBytes.h"
 #include "td/telegram/files/FileHashUploader.h"
+#include "td/telegram/files/FileIoService.h"
 #include "td/telegram/files/FileLocation.h"
 #include "td/telegram/files/FileType.h"
 #include "td/telegram/files/FileUploader.h"
@@ -20,6 +21,7 @@
 #include "td/telegram/net/DcId.h"
 
 #include "td/utils/buffer.h"
+#include "td/utils/CancellationToken.h"
 #include "td/utils/Container.h"
 #include "td/utils/Status.h"
 
@@ -45,6 +47,7 @@ class FileLoadManager final : public Actor {
     virtual void on_upload_full_ok(QueryId id, const FullRemoteFileLocation &remote) = 0;
     virtual void on_download_ok(QueryId id, const FullLocalFileLocation &local, int64 size, bool is_new) = 0;
     virtual void on_error(QueryId id, Status status) = 0;
+    virtual void on_file_deduplicated(const FullLocalFileLocation &local, uint64 mtime_nsec) = 0;
   };
 
   explicit FileLoadManager(ActorShared<Callback> callback, ActorShared<> parent);
@@ -60,6 +63,9 @@ class FileLoadManager final : public Actor {
   void update_local_file_location(QueryId id, const LocalFileLocation &local);
   void update_downloaded_part(QueryId id, int64 offset, int64 limit);
   void get_content(const FullLocalFileLocation &local_location, Promise<BufferSlice> promise);
+  void read_file_part(string path, int64 offset, size_t size, Promise<string> promise);
+  // replaces the file with a link to the same already stored content, if any
+  void deduplicate(const FullLocalFileLocation &local_location, int64 size);
 
  private:
   struct Node {
@@ -69,9 +75,13 @@ class FileLoadManager final : public Actor {
   };
   using NodeId = uint64;
 
+  static constexpr int32 FILE_IO_THREAD_COUNT = 4;  // the threads are shared by all clients in the process
+
   std::map<DcId, ActorOwn<ResourceManager>> download_resource_manager_map_;
   std::map<DcId, ActorOwn<ResourceManager>> download_small_resource_manager_map_;
   ActorOwn<ResourceManager> upload_resource_manager_;
+  ActorOwn<FileIoService> file_io_service_;
+  CancellationTokenSource deduplicate_cancellation_token_source_;
 
   Container<Node> nodes_container_;
   ActorShared<Callback> callback_;
@@ -96,6 +106,7 @@ class FileLoadManager final : public Actor {
   void on_ok_upload_full(const FullRemoteFileLocation &remote);
   void on_error(Status status);
   void on_error_impl(NodeId node_id, Status status);
+  void on_deduplicated(const FullLocalFileLocation &local, uint64 mtime_nsec);
 
   class FileDownloaderCallback : public FileDownloader::Callback {
    public:
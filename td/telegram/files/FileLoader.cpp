@@ -8,6 +8,7 @@
 
 #include "td/telegram/files/FileLoaderUtils.h"
 #include "td/telegram/files/ResourceManager.h"
+#include "td/telegram/files/TransferEstimator.h"
 #include "td/telegram/Global.h"
 #include "td/telegram/net/NetQueryDispatcher.h"
 #include "td/telegram/UniqueId.h"
@@ -17,12 +18,23 @@
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
 #include "td/utils/ScopeGuard.h"
+#include "td/utils/Time.h"
 
 #include <tuple>
 
 namespace td {
 
-void FileLoader::set_resource_manager(ActorShared<ResourceManager> resource_manager) {
+constexpr size_t FileLoader::PART_IN_PROGRESS;
+
+void FileLoader::set_resource_manager(ActorShared<ResourceManager> resource_manager, size_t part_size_hint) {
+  // on high bandwidth-delay product links bigger parts are needed to fill the link with fewer queries
+  if (!stop_flag_ && can_change_part_size_ && parts_manager_.increase_part_size(part_size_hint)) {
+    VLOG(file_loader) << "Increase part size to " << part_size_hint;
+    resource_state_.set_unit_size(parts_manager_.get_part_size());
+    update_estimated_limit();
+    on_progress_impl();
+  }
+  can_change_part_size_ = false;
   resource_manager_ = std::move(resource_manager);
   send_closure(resource_manager_, &ResourceManager::update_resources, resource_state_);
 }
@@ -77,13 +89,16 @@ void FileLoader::update_downloaded_part(int64 offset, int64 limit) {
     auto begin_part_id = parts_manager_.set_streaming_offset(offset, limit);
     auto new_end_part_id = limit <= 0 ? parts_manager_.get_part_count()
                                       : static_cast<int32>((offset + limit - 1) / parts_manager_.get_part_size()) + 1;
-    auto max_parts = static_cast<int32>(ResourceManager::MAX_RESOURCE_LIMIT / parts_manager_.get_part_size());
+    auto max_in_flight = td::max(resource_state_.active_limit(), TransferEstimator::MIN_IN_FLIGHT_LIMIT);
+    auto max_parts = static_cast<int32>(max_in_flight / static_cast<int64>(parts_manager_.get_part_size()));
     auto end_part_id = begin_part_id + td::min(max_parts, new_end_part_id - begin_part_id);
     VLOG(file_loader) << "Protect parts " << begin_part_id << " ... " << end_part_id - 1;
     for (auto &it : part_map_) {
-      if (!it.second.second.empty() && !(begin_part_id <= it.second.first.id && it.second.first.id < end_part_id)) {
-        VLOG(file_loader) << "Cancel part " << it.second.first.id;
-        it.second.second.reset();  // cancel_query(it.second.second);
+      auto &part_query = it.second;
+      if (!part_query.cancel_signal.empty() &&
+          !(begin_part_id <= part_query.part.id && part_query.part.id < end_part_id)) {
+        VLOG(file_loader) << "Cancel part " << part_query.part.id;
+        part_query.cancel_signal.reset();  // cancel_query(part_query.cancel_signal);
       }
     }
   } else {
@@ -130,6 +145,7 @@ void FileLoader::start_up() {
   if (file_info.only_check) {
     parts_manager_.set_checked_prefix_size(0);
   }
+  can_change_part_size_ = part_size == 0 && ready_parts.empty() && !file_info.only_check && !is_upload;
   parts_manager_.set_streaming_offset(file_info.offset, file_info.limit);
   if (ordered_flag_) {
     ordered_parts_ = OrderedEventsProcessor<std::pair<Part, NetQueryPtr>>(parts_manager_.get_ready_prefix_count());
@@ -208,30 +224,62 @@ Status FileLoader::do_loop() {
     NetQueryPtr query;
     bool is_blocking;
     std::tie(query, is_blocking) = std::move(query_flag);
-    uint64 id = UniqueId::next();
-    if (is_blocking) {
-      CHECK(blocking_id_ == 0);
-      blocking_id_ = id;
-    }
-    part_map_[id] = std::make_pair(part, query->cancel_slot_.get_signal_new());
-    // part_map_[id] = std::make_pair(part, query.get_weak());
-
-    auto callback = actor_shared(this, id);
-    if (delay_dispatcher_.empty()) {
-      G()->net_query_dispatcher().dispatch_with_callback(std::move(query), std::move(callback));
-    } else {
-      query->debug("sent to DelayDispatcher");
-      send_closure(delay_dispatcher_, &DelayDispatcher::send_with_callback_and_delay, std::move(query),
-                   std::move(callback), next_delay_);
-      next_delay_ = max(next_delay_ * 0.8, 0.003);
+    if (query.empty()) {
+      CHECK(!is_blocking);
+      VLOG(file_loader) << "Wait for query for part " << tag("id", part.id);
+      continue;
     }
+    send_part_query(part, std::move(query), is_blocking);
   }
   return Status::OK();
 }
 
+void FileLoader::send_part_query(Part part, NetQueryPtr query, bool is_blocking) {
+  uint64 id = UniqueId::next();
+  if (is_blocking) {
+    CHECK(blocking_id_ == 0);
+    blocking_id_ = id;
+  }
+  part_map_[id] = PartQuery{part, query->cancel_slot_.get_signal_new(), Time::now()};
+  // part_map_[id] = std::make_pair(part, query.get_weak());
+
+  auto callback = actor_shared(this, id);
+  if (delay_dispatcher_.empty()) {
+    G()->net_query_dispatcher().dispatch_with_callback(std::move(query), std::move(callback));
+  } else {
+    query->debug("sent to DelayDispatcher");
+    send_closure(delay_dispatcher_, &DelayDispatcher::send_with_callback_and_delay, std::move(query),
+                 std::move(callback), next_delay_);
+    next_delay_ = max(next_delay_ * 0.8, 0.003);
+  }
+}
+
+void FileLoader::on_part_started(Part part, Result<NetQueryPtr> r_query) {
+  if (stop_flag_) {
+    return;
+  }
+  if (r_query.is_error()) {
+    on_error(r_query.move_as_error());
+    stop_flag_ = true;
+    return;
+  }
+  send_part_query(part, r_query.move_as_ok(), false);
+}
+
+void FileLoader::on_part_restarted(Part part) {
+  if (stop_flag_) {
+    return;
+  }
+  VLOG(file_loader) << "Restart part " << tag("id", part.id) << tag("size", part.size);
+  resource_state_.stop_use(static_cast<int64>(part.size));
+  parts_manager_.on_part_failed(part.id);
+  update_estimated_limit();
+  loop();
+}
+
 void FileLoader::tear_down() {
   for (auto &it : part_map_) {
-    it.second.second.reset();  // cancel_query(it.second.second);
+    it.second.cancel_signal.reset();  // cancel_query(it.second.cancel_signal);
   }
   ordered_parts_.clear([](auto &&part) { part.second->clear(); });
   if (!delay_dispatcher_.empty()) {
@@ -270,8 +318,9 @@ void FileLoader::on_result(NetQueryPtr query) {
     return;
   }
 
-  Part part = it->second.first;
-  it->second.second.release();
+  Part part = it->second.part;
+  auto sent_at = it->second.sent_at;
+  it->second.cancel_signal.release();
   CHECK(query->is_ready());
   part_map_.erase(it);
 
@@ -297,6 +346,9 @@ void FileLoader::on_result(NetQueryPtr query) {
   }
 
   if (next) {
+    if (query->is_ok() && !resource_manager_.empty()) {
+      send_closure(resource_manager_, &ResourceManager::on_part_transferred, static_cast<int64>(part.size), sent_at);
+    }
     if (ordered_flag_) {
       auto seq_no = part.id;
       ordered_parts_.add(seq_no, std::make_pair(part, std::move(query)),
@@ -331,6 +383,28 @@ void FileLoader::on_common_query(NetQueryPtr query) {
 
 Status FileLoader::try_on_part_query(Part part, NetQueryPtr query) {
   TRY_RESULT(size, process_part(part, std::move(query)));
+  if (size == PART_IN_PROGRESS) {
+    VLOG(file_loader) << "Wait for processing of part " << tag("id", part.id);
+    return Status::OK();
+  }
+  return on_part_ok(part, size);
+}
+
+void FileLoader::on_part_processed(Part part, Result<size_t> r_size) {
+  if (stop_flag_) {
+    return;
+  }
+  auto status = r_size.is_error() ? r_size.move_as_error() : on_part_ok(part, r_size.ok());
+  if (status.is_error()) {
+    on_error(std::move(status));
+    stop_flag_ = true;
+    return;
+  }
+  update_estimated_limit();
+  loop();
+}
+
+Status FileLoader::on_part_ok(Part part, size_t size) {
   VLOG(file_loader) << "Ok part " << tag("id", part.id) << tag("size", part.size);
   resource_state_.stop_use(static_cast<int64>(part.size));
   auto old_ready_prefix_count = parts_manager_.get_unchecked_ready_prefix_count();
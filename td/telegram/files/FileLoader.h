@@ -33,7 +33,7 @@ class FileLoader : public FileLoaderActor {
     Callback &operator=(const Callback &) = delete;
     virtual ~Callback() = default;
   };
-  void set_resource_manager(ActorShared<ResourceManager> resource_manager) override;
+  void set_resource_manager(ActorShared<ResourceManager> resource_manager, size_t part_size_hint) override;
   void update_priority(int8 priority) override;
   void update_resources(const ResourceState &other) override;
 
@@ -67,11 +67,18 @@ class FileLoader : public FileLoaderActor {
   virtual Status before_start_parts() {
     return Status::OK();
   }
+  // may return an empty query, if it will be created asynchronously and passed to on_part_started
   virtual Result<std::pair<NetQueryPtr, bool>> start_part(Part part, int part_count,
                                                           int64 streaming_offset) TD_WARN_UNUSED_RESULT = 0;
   virtual void after_start_parts() {
   }
+  // may return PART_IN_PROGRESS, if the part is processed asynchronously and on_part_processed will be called later
   virtual Result<size_t> process_part(Part part, NetQueryPtr net_query) TD_WARN_UNUSED_RESULT = 0;
+  static constexpr size_t PART_IN_PROGRESS = static_cast<size_t>(-1);
+  void on_part_started(Part part, Result<NetQueryPtr> r_query);
+  // the part, which was started, but whose query wasn't created, will be started again
+  void on_part_restarted(Part part);
+  void on_part_processed(Part part, Result<size_t> r_size);
   struct Progress {
     int32 part_count{0};
     int32 part_size{0};
@@ -114,7 +121,13 @@ class FileLoader : public FileLoaderActor {
   ResourceState resource_state_;
   PartsManager parts_manager_;
   uint64 blocking_id_{0};
-  std::map<uint64, std::pair<Part, ActorShared<>>> part_map_;
+  struct PartQuery {
+    Part part;
+    ActorShared<> cancel_signal;
+    double sent_at;
+  };
+  std::map<uint64, PartQuery> part_map_;
+  bool can_change_part_size_ = false;
   bool ordered_flag_ = false;
   OrderedEventsProcessor<std::pair<Part, NetQueryPtr>> ordered_parts_;
   ActorOwn<DelayDispatcher> delay_dispatcher_;
@@ -135,9 +148,11 @@ class FileLoader : public FileLoaderActor {
   void on_progress_impl();
 
   void on_result(NetQueryPtr query) override;
+  void send_part_query(Part part, NetQueryPtr query, bool is_blocking);
   void on_part_query(Part part, NetQueryPtr query);
   void on_common_query(NetQueryPtr query);
   Status try_on_part_query(Part part, NetQueryPtr query);
+  Status on_part_ok(Part part, size_t size);
 };
 
 }  // namespace td
@@ -18,7 +18,7 @@ class ResourceManager;
 
 class FileLoaderActor : public NetQueryCallback {
  public:
-  virtual void set_resource_manager(ActorShared<ResourceManager> resource_manager) = 0;
+  virtual void set_resource_manager(ActorShared<ResourceManager> resource_manager, size_t part_size_hint) = 0;
   virtual void update_priority(int8 priority) = 0;
   virtual void update_resources(const ResourceState &other) = 0;
 
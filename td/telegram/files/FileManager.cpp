@@ -10,6 +10,7 @@
 
 #include "td/telegram/ConfigShared.h"
 #include "td/telegram/FileReferenceManager.h"
+#include "td/telegram/files/FileContentStore.h"
 #include "td/telegram/files/FileData.h"
 #include "td/telegram/files/FileDb.h"
 #include "td/telegram/files/FileLoaderUtils.h"
@@ -157,8 +158,7 @@ void FileNode::recalc_ready_prefix_size(int64 prefix_offset, int64 ready_prefix_
   if (download_offset_ == prefix_offset) {
     new_local_ready_prefix_size = ready_prefix_size;
   } else {
-    new_local_ready_prefix_size = Bitmask(Bitmask::Decode{}, local_.partial().ready_bitmask_)
-                                      .get_ready_prefix_size(download_offset_, local_.partial().part_size_, size_);
+    new_local_ready_prefix_size = local_ready_extents_.get_ready_prefix_size(download_offset_, size_);
   }
   if (new_local_ready_prefix_size != local_ready_prefix_size_) {
     VLOG(update_file) << "File " << main_file_id_ << " has changed local_ready_prefix_size from "
@@ -169,12 +169,23 @@ void FileNode::recalc_ready_prefix_size(int64 prefix_offset, int64 ready_prefix_
 }
 
 void FileNode::init_ready_size() {
+  init_ready_extents();
   if (local_.type() != LocalFileLocation::Type::Partial) {
     return;
   }
-  auto bitmask = Bitmask(Bitmask::Decode{}, local_.partial().ready_bitmask_);
-  local_ready_prefix_size_ = bitmask.get_ready_prefix_size(0, local_.partial().part_size_, size_);
-  local_ready_size_ = bitmask.get_total_size(local_.partial().part_size_, size_);
+  local_ready_prefix_size_ = local_ready_extents_.get_ready_prefix_size(0, size_);
+  local_ready_size_ = local_ready_extents_.get_total_size(size_);
+}
+
+void FileNode::init_ready_extents() {
+  // the bitmask is decoded once per change of the local location, so that streaming readers can ask
+  // for ready prefix at any offset without decoding it again
+  if (local_.type() != LocalFileLocation::Type::Partial) {
+    local_ready_extents_ = FileExtentMap();
+    return;
+  }
+  local_ready_extents_ = FileExtentMap(Bitmask(Bitmask::Decode{}, local_.partial().ready_bitmask_),
+                                       local_.partial().part_size_);
 }
 
 void FileNode::set_download_offset(int64 download_offset) {
@@ -221,6 +232,7 @@ void FileNode::set_local_location(const LocalFileLocation &local, int64 ready_si
   if (local_ != local) {
     VLOG(update_file) << "File " << main_file_id_ << " has changed local location";
     local_ = local;
+    init_ready_extents();
 
     recalc_ready_prefix_size(prefix_offset, ready_prefix_size);
 
@@ -595,8 +607,7 @@ int64 FileView::downloaded_prefix(int64 offset) const {
         // File is not decrypted and verified yet
         return 0;
       }
-      return Bitmask(Bitmask::Decode{}, node_->local_.partial().ready_bitmask_)
-          .get_ready_prefix_size(offset, node_->local_.partial().part_size_, node_->size_);
+      return node_->local_ready_extents_.get_ready_prefix_size(offset, node_->size_);
     default:
       UNREACHABLE();
       return 0;
@@ -1065,6 +1076,7 @@ void FileManager::try_forget_file_id(FileId file_id) {
   CHECK(is_removed);
   *info = FileIdInfo();
   empty_file_ids_.push_back(file_id.get());
+  on_file_slot_freed();
 }
 
 FileId FileManager::register_empty(FileType type) {
@@ -1658,7 +1670,10 @@ Result<FileId> FileManager::merge(FileId x_file_id, FileId y_file_id, bool no_sy
     }
   }
 
+  // nodes are referenced only through file_id_info_, so the node can be reused after all its file_ids are moved
   file_nodes_[node_ids[other_node_i]] = nullptr;
+  empty_file_node_ids_.push_back(node_ids[other_node_i]);
+  on_file_slot_freed();
 
   run_generate(node);
   run_download(node, false);
@@ -2036,30 +2051,31 @@ void FileManager::read_file_part(FileId file_id, int32 offset, int32 count, int
     return promise.set_error(Status::Error(400, "There is not enough downloaded bytes in the file to read"));
   }
 
-  const string *path = nullptr;
+  string path;
   bool is_partial = false;
   if (file_view.has_local_location()) {
-    path = &file_view.local_location().path_;
-    if (!begins_with(*path, get_files_dir(file_view.get_type()))) {
+    path = file_view.local_location().path_;
+    if (!begins_with(path, get_files_dir(file_view.get_type()))) {
       return promise.set_error(Status::Error(400, "File is not inside the cache"));
     }
   } else {
     CHECK(node->local_.type() == LocalFileLocation::Type::Partial);
-    path = &node->local_.partial().path_;
+    path = node->local_.partial().path_;
     is_partial = true;
   }
 
-  // TODO move file reading to another thread
-  auto r_bytes = [&]() -> Result<string> {
-    TRY_RESULT(fd, FileFd::open(*path, FileFd::Read));
-    string data;
-    data.resize(count);
-    TRY_RESULT(read_bytes, fd.pread(data, offset));
-    if (read_bytes != static_cast<size_t>(count)) {
-      return Status::Error("Read less bytes than expected");
-    }
-    return std::move(data);
-  }();
+  // the bytes are read in the FileIoService directly into the string, which is returned in the td_api object
+  send_closure(file_load_manager_, &FileLoadManager::read_file_part, std::move(path), offset,
+               static_cast<size_t>(count),
+               PromiseCreator::lambda([actor_id = actor_id(this), file_id, offset, count, left_tries, is_partial,
+                                       promise = std::move(promise)](Result<string> r_bytes) mutable {
+                 send_closure(actor_id, &FileManager::on_read_file_part, file_id, offset, count, left_tries,
+                              is_partial, std::move(r_bytes), std::move(promise));
+               }));
+}
+
+void FileManager::on_read_file_part(FileId file_id, int32 offset, int32 count, int left_tries, bool is_partial,
+                                    Result<string> r_bytes, Promise<td_api::object_ptr<td_api::filePart>> promise) {
   if (r_bytes.is_error()) {
     LOG(INFO) << "Failed to read file bytes: " << r_bytes.error();
     if (--left_tries == 0 || !is_partial) {
@@ -2098,7 +2114,8 @@ void FileManager::delete_file(FileId file_id, Promise<Unit> promise, const char
       LOG(INFO) << "Unlink file " << file_id << " at " << file_view.local_location().path_;
       clear_from_pmc(node);
 
-      context_->on_new_file(-file_view.size(), -file_view.get_allocated_local_size(), -1);
+      context_->on_new_file(file_view.get_type(), file_view.owner_dialog_id(), -file_view.size(),
+                            -file_view.get_allocated_local_size(), -1);
       unlink(file_view.local_location().path_).ignore();
       node->drop_local_location();
       try_flush_node(node, "delete_file 1");
@@ -3249,11 +3266,45 @@ FileId FileManager::next_file_id() {
 }
 
 FileManager::FileNodeId FileManager::next_file_node_id() {
+  if (!empty_file_node_ids_.empty()) {
+    auto res = empty_file_node_ids_.back();
+    empty_file_node_ids_.pop_back();
+    CHECK(file_nodes_[res] == nullptr);
+    return res;
+  }
   FileNodeId res = static_cast<FileNodeId>(file_nodes_.size());
   file_nodes_.emplace_back(nullptr);
   return res;
 }
 
+void FileManager::on_file_slot_freed() {
+  freed_slot_count_++;
+  auto table_size = static_cast<int32>(file_id_info_.size() + file_nodes_.size());
+  if (freed_slot_count_ >= MIN_COMPACTION_FREED_SLOT_COUNT && freed_slot_count_ >= table_size / 8) {
+    compact_file_tables();
+  }
+}
+
+void FileManager::compact_file_tables() {
+  freed_slot_count_ = 0;
+  compact_file_table(file_id_info_, empty_file_ids_);
+  compact_file_table(file_nodes_, empty_file_node_ids_);
+
+  auto file_id_stats = get_file_id_table_stats();
+  auto file_node_stats = get_file_node_table_stats();
+  LOG(INFO) << "Compact file tables: have " << file_id_stats.live_slot_count << " live and "
+            << file_id_stats.free_slot_count << " free file identifiers, " << file_node_stats.live_slot_count
+            << " live and " << file_node_stats.free_slot_count << " free file nodes";
+}
+
+FileTableStats FileManager::get_file_id_table_stats() const {
+  return get_file_table_stats(file_id_info_, empty_file_ids_);
+}
+
+FileTableStats FileManager::get_file_node_table_stats() const {
+  return get_file_table_stats(file_nodes_, empty_file_node_ids_);
+}
+
 void FileManager::on_start_download(QueryId query_id) {
   if (is_closed_) {
     return;
@@ -3367,7 +3418,12 @@ void FileManager::on_download_ok(QueryId query_id, const FullLocalFileLocation &
     status = Status::Error(PSLICE() << "Can't register local file after download: " << r_new_file_id.error().message());
   } else {
     if (is_new) {
-      context_->on_new_file(size, get_file_view(r_new_file_id.ok()).get_allocated_local_size(), 1);
+      auto new_file_view = get_file_view(r_new_file_id.ok());
+      auto file_node = get_file_node(file_id);
+      auto owner_dialog_id = file_node ? file_node->owner_dialog_id_ : DialogId();
+      context_->on_new_file(new_file_view.get_type(), owner_dialog_id, size, new_file_view.get_allocated_local_size(),
+                            1);
+      deduplicate_file(new_file_view.local_location(), size);
     }
     auto r_file_id = merge(r_new_file_id.ok(), file_id);
     if (r_file_id.is_error()) {
@@ -3541,7 +3597,11 @@ void FileManager::on_generate_ok(QueryId query_id, const FullLocalFileLocation &
 
   FileView file_view(file_node);
   if (!file_view.has_generate_location() || !begins_with(file_view.generate_location().conversion_, "#file_id#")) {
-    context_->on_new_file(file_view.size(), file_view.get_allocated_local_size(), 1);
+    context_->on_new_file(file_view.get_type(), file_view.owner_dialog_id(), file_view.size(),
+                          file_view.get_allocated_local_size(), 1);
+    if (file_view.has_local_location()) {
+      deduplicate_file(file_view.local_location(), file_view.size());
+    }
   }
 
   run_upload(file_node, {});
@@ -3704,6 +3764,39 @@ void FileManager::on_error_impl(FileNodePtr node, Query::Type type, bool was_act
   }
 }
 
+void FileManager::deduplicate_file(const FullLocalFileLocation &local, int64 size) {
+  if (!G()->shared_config().get_option_boolean("use_file_deduplication") || size < MIN_DEDUPLICATED_FILE_SIZE ||
+      !begins_with(local.path_, get_files_base_dir(local.file_type_))) {
+    return;
+  }
+  send_closure(file_load_manager_, &FileLoadManager::deduplicate, local, size);
+}
+
+void FileManager::on_file_deduplicated(const FullLocalFileLocation &local, uint64 mtime_nsec) {
+  if (is_closed_) {
+    return;
+  }
+
+  auto it = local_location_to_file_id_.find(local);
+  if (it == local_location_to_file_id_.end()) {
+    return;
+  }
+  auto file_id = it->second;
+  auto file_node = get_sync_file_node(file_id);
+  CHECK(file_node);
+  if (file_node->local_.type() != LocalFileLocation::Type::Full || file_node->local_.full() != local) {
+    return;
+  }
+
+  // the file is now a link to the stored content and has its modification time
+  FullLocalFileLocation new_local(local.file_type_, local.path_, mtime_nsec);
+  VLOG(file_loader) << "Change modification time of deduplicated " << local << " to " << mtime_nsec;
+  local_location_to_file_id_.erase(it);
+  local_location_to_file_id_.emplace(new_local, file_id);
+  file_node->set_local_location(LocalFileLocation(new_local), file_node->local_ready_size_, -1, -1);
+  try_flush_node(file_node, "on_file_deduplicated");
+}
+
 std::pair<FileManager::Query, bool> FileManager::finish_query(QueryId query_id) {
   SCOPE_EXIT {
     queries_container_.erase(query_id);
@@ -12,12 +12,14 @@
 #include "td/telegram/DialogId.h"
 #include "td/telegram/files/FileDbId.h"
 #include "td/telegram/files/FileEncryptionKey.h"
+#include "td/telegram/files/FileExtentMap.h"
 #include "td/telegram/files/FileGenerateManager.h"
 #include "td/telegram/files/FileId.h"
 #include "td/telegram/files/FileLoadManager.h"
 #include "td/telegram/files/FileLocation.h"
 #include "td/telegram/files/FileSourceId.h"
 #include "td/telegram/files/FileStats.h"
+#include "td/telegram/files/FileTable.h"
 #include "td/telegram/files/FileType.h"
 #include "td/telegram/Location.h"
 #include "td/telegram/PhotoSizeSource.h"
@@ -134,6 +136,7 @@ class FileNode {
   int64 download_limit_ = 0;
   int64 local_ready_size_ = 0;         // PartialLocal only
   int64 local_ready_prefix_size_ = 0;  // PartialLocal only
+  FileExtentMap local_ready_extents_;  // PartialLocal only, decoded ready_bitmask_
 
   NewRemoteFileLocation remote_;
 
@@ -184,6 +187,7 @@ class FileNode {
   bool download_was_update_file_reference_{false};
 
   void init_ready_size();
+  void init_ready_extents();
 
   void recalc_ready_prefix_size(int64 prefix_offset, int64 ready_prefix_size);
 };
@@ -375,7 +379,8 @@ class FileManager : public FileLoadManager::Callback {
 
   class Context {
    public:
-    virtual void on_new_file(int64 size, int64 real_size, int32 cnt) = 0;
+    virtual void on_new_file(FileType file_type, DialogId owner_dialog_id, int64 size, int64 real_size,
+                             int32 cnt) = 0;
 
     virtual void on_file_updated(FileId size) = 0;
 
@@ -455,6 +460,10 @@ class FileManager : public FileLoadManager::Callback {
 
   void delete_file(FileId file_id, Promise<Unit> promise, const char *source);
 
+  // numbers of used and reusable slots in the tables of file identifiers and file nodes
+  FileTableStats get_file_id_table_stats() const;
+  FileTableStats get_file_node_table_stats() const;
+
   void external_file_generate_write_part(int64 id, int32 offset, string data, Promise<> promise);
   void external_file_generate_progress(int64 id, int32 expected_size, int32 local_prefix_size, Promise<> promise);
   void external_file_generate_finish(int64 id, Status status, Promise<> promise);
@@ -570,6 +579,8 @@ class FileManager : public FileLoadManager::Callback {
   vector<FileIdInfo> file_id_info_;
   vector<int32> empty_file_ids_;
   vector<unique_ptr<FileNode>> file_nodes_;
+  vector<FileNodeId> empty_file_node_ids_;
+  int32 freed_slot_count_ = 0;  // number of freed file identifiers and file nodes since the last compaction
   ActorOwn<FileLoadManager> file_load_manager_;
   ActorOwn<FileGenerateManager> file_generate_manager_;
 
@@ -579,8 +590,14 @@ class FileManager : public FileLoadManager::Callback {
 
   std::set<std::string> bad_paths_;
 
+  static constexpr int32 MIN_COMPACTION_FREED_SLOT_COUNT = 1 << 12;
+
   FileId next_file_id();
   FileNodeId next_file_node_id();
+  void on_file_slot_freed();
+  // only slots of forgotten file identifiers and of file nodes, which were merged into other nodes, are freed, so
+  // only they are reclaimed by the compaction; other slots stay used until the FileManager is destroyed
+  void compact_file_tables();
   int32 next_pmc_file_id();
   FileId create_file_id(int32 file_node_id, FileNode *file_node);
   void try_forget_file_id(FileId file_id);
@@ -642,12 +659,18 @@ class FileManager : public FileLoadManager::Callback {
                     int64 size) override;
   void on_upload_full_ok(QueryId query_id, const FullRemoteFileLocation &remote) override;
   void on_error(QueryId query_id, Status status) override;
+  void on_file_deduplicated(const FullLocalFileLocation &local, uint64 mtime_nsec) override;
 
   void on_error_impl(FileNodePtr node, Query::Type type, bool was_active, Status status);
 
   void on_partial_generate(QueryId, const PartialLocalFileLocation &partial_local, int32 expected_size);
   void on_generate_ok(QueryId, const FullLocalFileLocation &local);
 
+  void deduplicate_file(const FullLocalFileLocation &local, int64 size);
+
+  void on_read_file_part(FileId file_id, int32 offset, int32 count, int left_tries, bool is_partial,
+                         Result<string> r_bytes, Promise<td_api::object_ptr<td_api::filePart>> promise);
+
   std::pair<Query, bool> finish_query(QueryId query_id);
 
   FullRemoteFileLocation *get_remote(int32 key);
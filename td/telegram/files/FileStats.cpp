@@ -197,6 +197,45 @@ std::vector<DialogId> FileStats::get_dialog_ids() const {
   return res;
 }
 
+void FileStatsIndex::add(DialogId owner_dialog_id, FileType file_type, int64 size, int32 cnt) {
+  // full scan attributes files to the main file type of their directory
+  auto &stat = stat_by_owner_dialog_id_[owner_dialog_id][narrow_cast<size_t>(get_main_file_type(file_type))];
+  stat.size += size;
+  stat.cnt += cnt;
+  if (stat.size < 0 || stat.cnt < 0) {
+    // the index is inconsistent with the files; it will be fixed by the next full scan
+    stat = FileTypeStat();
+  }
+}
+
+void FileStatsIndex::reset(const FileStats &stats, uint32 date) {
+  date_ = date;
+  stat_by_owner_dialog_id_.clear();
+  if (stats.split_by_owner_dialog_id) {
+    stat_by_owner_dialog_id_ = stats.stat_by_owner_dialog_id;
+  } else {
+    stat_by_owner_dialog_id_[DialogId()] = stats.stat_by_type;
+  }
+}
+
+FileStats FileStatsIndex::get_file_stats(bool split_by_owner_dialog_id) const {
+  FileStats stats;
+  stats.split_by_owner_dialog_id = split_by_owner_dialog_id;
+  for (auto &it : stat_by_owner_dialog_id_) {
+    bool is_empty = std::all_of(it.second.begin(), it.second.end(),
+                                [](const FileTypeStat &stat) { return stat.size == 0 && stat.cnt == 0; });
+    if (is_empty) {
+      continue;
+    }
+    auto &stat_by_type = split_by_owner_dialog_id ? stats.stat_by_owner_dialog_id[it.first] : stats.stat_by_type;
+    for (int32 i = 0; i < MAX_FILE_TYPE; i++) {
+      stat_by_type[i].size += it.second[i].size;
+      stat_by_type[i].cnt += it.second[i].cnt;
+    }
+  }
+  return stats;
+}
+
 StringBuilder &operator<<(StringBuilder &sb, const FileTypeStat &stat) {
   return sb << tag("size", format::as_size(stat.size)) << tag("count", stat.cnt);
 }
@@ -94,4 +94,68 @@ struct FileStats {
 
 StringBuilder &operator<<(StringBuilder &sb, const FileStats &file_stats);
 
+// Sizes of files by owner dialog and file type, which are updated incrementally, when files are added or deleted,
+// and are recalculated from FileStats after a full scan of the files
+class FileStatsIndex {
+ public:
+  // removes the files, if cnt is negative
+  void add(DialogId owner_dialog_id, FileType file_type, int64 size, int32 cnt);
+
+  // stats must be split by owner dialog, unless owner dialogs are unknown
+  void reset(const FileStats &stats, uint32 date);
+
+  FileStats get_file_stats(bool split_by_owner_dialog_id) const;
+
+  // date of the last full scan
+  uint32 get_date() const {
+    return date_;
+  }
+
+  template <class StorerT>
+  void store(StorerT &storer) const;
+  template <class ParserT>
+  void parse(ParserT &parser);
+
+ private:
+  uint32 date_ = 0;
+  std::unordered_map<DialogId, FileStats::StatByType, DialogIdHash> stat_by_owner_dialog_id_;
+};
+
+template <class StorerT>
+void FileStatsIndex::store(StorerT &storer) const {
+  using ::td::store;
+  store(date_, storer);
+  store(static_cast<int32>(stat_by_owner_dialog_id_.size()), storer);
+  for (auto &it : stat_by_owner_dialog_id_) {
+    store(it.first, storer);
+    store(static_cast<int32>(it.second.size()), storer);
+    for (auto &stat : it.second) {
+      store(stat, storer);
+    }
+  }
+}
+
+template <class ParserT>
+void FileStatsIndex::parse(ParserT &parser) {
+  using ::td::parse;
+  parse(date_, parser);
+  int32 dialog_count;
+  parse(dialog_count, parser);
+  for (int32 i = 0; i < dialog_count && parser.get_error() == nullptr; i++) {
+    DialogId owner_dialog_id;
+    parse(owner_dialog_id, parser);
+    auto &stat_by_type = stat_by_owner_dialog_id_[owner_dialog_id];
+    int32 file_type_count;
+    parse(file_type_count, parser);
+    for (int32 j = 0; j < file_type_count && parser.get_error() == nullptr; j++) {
+      // file types, unknown to this version, are ignored
+      FileTypeStat stat;
+      parse(stat, parser);
+      if (j < MAX_FILE_TYPE) {
+        stat_by_type[j] = stat;
+      }
+    }
+  }
+}
+
 }  // namespace td
@@ -102,6 +102,7 @@ struct FsFileInfo {
 template <class CallbackT>
 void scan_fs(CancellationToken &token, CallbackT &&callback) {
   std::unordered_set<string> scanned_file_dirs;
+  std::unordered_set<uint64> scanned_shared_inodes;
   for (int32 i = 0; i < MAX_FILE_TYPE; i++) {
     auto file_type = static_cast<FileType>(i);
     auto file_dir = get_files_dir(file_type);
@@ -130,6 +131,10 @@ void scan_fs(CancellationToken &token, CallbackT &&callback) {
       FsFileInfo info;
       info.path = path.str();
       info.size = stat.real_size_;
+      if (stat.link_count_ > 1 && stat.inode_ != 0 && !scanned_shared_inodes.insert(stat.inode_).second) {
+        // the content of deduplicated files is shared by their hard links and occupies the disk space only once
+        info.size = 0;
+      }
       info.file_type = main_file_type;
       info.atime_nsec = stat.atime_nsec_;
       info.mtime_nsec = stat.mtime_nsec_;
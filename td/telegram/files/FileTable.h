@@ -0,0 +1,51 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/misc.h"
+
+#include <algorithm>
+
+namespace td {
+
+// Tables of file identifiers and file nodes are vectors, indexed by the identifier, with a list of free slots, which
+// are reused for new identifiers. The zero slot is reserved.
+
+struct FileTableStats {
+  int32 live_slot_count = 0;
+  int32 free_slot_count = 0;
+};
+
+template <class T>
+FileTableStats get_file_table_stats(const vector<T> &table, const vector<int32> &empty_ids) {
+  FileTableStats stats;
+  stats.free_slot_count = narrow_cast<int32>(empty_ids.size());
+  stats.live_slot_count = narrow_cast<int32>(table.size()) - 1 - stats.free_slot_count;
+  return stats;
+}
+
+// removes free slots from the end of the table and makes the free slots with the least identifiers to be reused first;
+// live slots can't be moved, so free slots in the middle of the table are only reused
+template <class T>
+void compact_file_table(vector<T> &table, vector<int32> &empty_ids) {
+  std::sort(empty_ids.begin(), empty_ids.end());
+  while (!empty_ids.empty() && empty_ids.back() + 1 == static_cast<int32>(table.size())) {
+    empty_ids.pop_back();
+    table.pop_back();
+  }
+  std::reverse(empty_ids.begin(), empty_ids.end());
+
+  if (table.capacity() > 2 * table.size()) {
+    table.shrink_to_fit();
+  }
+  if (empty_ids.capacity() > 2 * empty_ids.size()) {
+    empty_ids.shrink_to_fit();
+  }
+}
+
+}  // namespace td
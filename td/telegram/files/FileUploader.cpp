@@ -29,12 +29,13 @@ namespace td {
 
 FileUploader::FileUploader(const LocalFileLocation &local, const RemoteFileLocation &remote, int64 expected_size,
                            const FileEncryptionKey &encryption_key, std::vector<int> bad_parts,
-                           unique_ptr<Callback> callback)
+                           ActorId<FileIoService> file_io_service, unique_ptr<Callback> callback)
     : local_(local)
     , remote_(remote)
     , expected_size_(expected_size)
     , encryption_key_(encryption_key)
     , bad_parts_(std::move(bad_parts))
+    , file_io_service_(std::move(file_io_service))
     , callback_(std::move(callback)) {
   if (encryption_key_.is_secret()) {
     iv_ = encryption_key_.mutable_iv();
@@ -145,7 +146,7 @@ Result<FileLoader::PrefixInfo> FileUploader::on_update_local_location(const Loca
     is_temp = true;
   }
 
-  if (!path.empty() && (path != fd_path_ || fd_.empty())) {
+  if (!path.empty() && (path != fd_path_ || fd_ == nullptr)) {
     auto res_fd = FileFd::open(path, FileFd::Read);
 
     // Race: partial location could be already deleted. Just ignore such locations
@@ -160,20 +161,22 @@ Result<FileLoader::PrefixInfo> FileUploader::on_update_local_location(const Loca
       return res_fd.move_as_error();
     }
 
-    fd_.close();
-    fd_ = res_fd.move_as_ok();
+    fd_ = std::make_shared<FileFd>(res_fd.move_as_ok());
+    if (path != fd_path_) {
+      fd_generation_++;
+    }
     fd_path_ = path;
     is_temp_ = is_temp;
   }
   if (local_is_ready) {
-    CHECK(!fd_.empty());
-    TRY_RESULT_ASSIGN(local_size, fd_.get_size());
+    CHECK(fd_ != nullptr);
+    TRY_RESULT_ASSIGN(local_size, fd_->get_size());
     LOG(INFO) << "Set file local_size to " << local_size;
     if (local_size == 0) {
       return Status::Error("Can't upload empty file");
     }
-  } else if (!fd_.empty()) {
-    TRY_RESULT(real_local_size, fd_.get_size());
+  } else if (fd_ != nullptr) {
+    TRY_RESULT(real_local_size, fd_->get_size());
     if (real_local_size < local_size) {
       LOG(ERROR) << tag("real_local_size", real_local_size) << " < " << tag("local_size", local_size);
       PrefixInfo info;
@@ -196,7 +199,7 @@ Result<FileLoader::PrefixInfo> FileUploader::on_update_local_location(const Loca
 }
 
 Status FileUploader::on_ok(int64 size) {
-  fd_.close();
+  fd_.reset();
   if (is_temp_) {
     LOG(INFO) << "UNLINK " << fd_path_;
     unlink(fd_path_).ignore();
@@ -205,7 +208,7 @@ Status FileUploader::on_ok(int64 size) {
 }
 
 void FileUploader::on_error(Status status) {
-  fd_.close();
+  fd_.reset();
   if (is_temp_) {
     LOG(INFO) << "UNLINK " << fd_path_;
     unlink(fd_path_).ignore();
@@ -221,10 +224,10 @@ Status FileUploader::generate_iv_map() {
   if (iv_map_.empty()) {
     iv_map_.push_back(encryption_key.mutable_iv());
   }
-  CHECK(!fd_.empty());
+  CHECK(fd_ != nullptr);
   for (; generate_offset_ + static_cast<int64>(part_size) < local_size_;
        generate_offset_ += static_cast<int64>(part_size)) {
-    TRY_RESULT(read_size, fd_.pread(bytes.as_slice(), generate_offset_));
+    TRY_RESULT(read_size, fd_->pread(bytes.as_slice(), generate_offset_));
     if (read_size != part_size) {
       return Status::Error("Failed to read file part (for iv_map)");
     }
@@ -248,12 +251,27 @@ void FileUploader::after_start_parts() {
 }
 
 Result<std::pair<NetQueryPtr, bool>> FileUploader::start_part(Part part, int32 part_count, int64 streaming_offset) {
+  if (!local_is_ready_) {
+    part_count = -1;
+  }
+  if (!encryption_key_.is_secret()) {
+    // the part is read in the FileIoService; secret files are encrypted in the order of parts,
+    // so they are still read synchronously
+    send_closure(file_io_service_, &FileIoService::read, fd_, part.offset, part.size,
+                 PromiseCreator::lambda([actor_id = actor_id(this), part, part_count,
+                                         fd_generation = fd_generation_](Result<BufferSlice> r_bytes) {
+                   send_closure(actor_id, &FileUploader::on_part_read, part, part_count, fd_generation,
+                                std::move(r_bytes));
+                 }));
+    return std::make_pair(NetQueryPtr(), false);
+  }
+
   auto padded_size = part.size;
   if (encryption_key_.is_secret()) {
     padded_size = (padded_size + 15) & ~15;
   }
   BufferSlice bytes(padded_size);
-  TRY_RESULT(size, fd_.pread(bytes.as_slice().truncate(part.size), part.offset));
+  TRY_RESULT(size, fd_->pread(bytes.as_slice().truncate(part.size), part.offset));
   if (encryption_key_.is_secret()) {
     Random::secure_bytes(bytes.as_slice().substr(part.size));
     if (next_offset_ == part.offset) {
@@ -273,17 +291,35 @@ Result<std::pair<NetQueryPtr, bool>> FileUploader::start_part(Part part, int32 p
     return Status::Error("Failed to read file part");
   }
 
+  return std::make_pair(create_part_query(part, part_count, std::move(bytes)), false);
+}
+
+void FileUploader::on_part_read(Part part, int32 part_count, uint64 fd_generation, Result<BufferSlice> r_bytes) {
+  if (r_bytes.is_ok() && r_bytes.ok().size() != part.size) {
+    r_bytes = Status::Error("Failed to read file part");
+  }
+  if (r_bytes.is_error()) {
+    if (fd_generation != fd_generation_) {
+      // the local location has changed while the part was read, for example, because file generation has finished
+      LOG(INFO) << "Restart part " << part.id << " after local location change: " << r_bytes.error();
+      return on_part_restarted(part);
+    }
+    return on_part_started(part, r_bytes.move_as_error());
+  }
+  on_part_started(part, create_part_query(part, part_count, r_bytes.move_as_ok()));
+}
+
+NetQueryPtr FileUploader::create_part_query(Part part, int32 part_count, BufferSlice bytes) const {
   NetQueryPtr net_query;
   if (big_flag_) {
-    auto query =
-        telegram_api::upload_saveBigFilePart(file_id_, part.id, local_is_ready_ ? part_count : -1, std::move(bytes));
+    auto query = telegram_api::upload_saveBigFilePart(file_id_, part.id, part_count, std::move(bytes));
     net_query = G()->net_query_creator().create(query, DcId::main(), NetQuery::Type::Upload);
   } else {
     auto query = telegram_api::upload_saveFilePart(file_id_, part.id, std::move(bytes));
     net_query = G()->net_query_creator().create(query, DcId::main(), NetQuery::Type::Upload);
   }
   net_query->file_type_ = narrow_cast<int32>(file_type_);
-  return std::make_pair(std::move(net_query), false);
+  return net_query;
 }
 
 Result<size_t> FileUploader::process_part(Part part, NetQueryPtr net_query) {
@@ -328,14 +364,15 @@ void FileUploader::keep_fd_flag(bool keep_fd) {
 }
 
 void FileUploader::try_release_fd() {
-  if (!keep_fd_ && !fd_.empty()) {
-    fd_.close();
+  if (!keep_fd_) {
+    fd_.reset();
   }
 }
 
 Status FileUploader::acquire_fd() {
-  if (fd_.empty()) {
-    TRY_RESULT_ASSIGN(fd_, FileFd::open(fd_path_, FileFd::Read));
+  if (fd_ == nullptr) {
+    TRY_RESULT(fd, FileFd::open(fd_path_, FileFd::Read));
+    fd_ = std::make_shared<FileFd>(std::move(fd));
   }
   return Status::OK();
 }
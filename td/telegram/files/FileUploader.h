@@ -7,6 +7,7 @@
 #pragma once
 
 #include "td/telegram/files/FileEncryptionKey.h"
+#include "td/telegram/files/FileIoService.h"
 #include "td/telegram/files/FileLoader.h"
 #include "td/telegram/files/FileLocation.h"
 #include "td/telegram/files/FileType.h"
@@ -15,6 +16,7 @@
 #include "td/utils/Status.h"
 #include "td/utils/UInt.h"
 
+#include <memory>
 #include <utility>
 
 namespace td {
@@ -30,7 +32,8 @@ class FileUploader : public FileLoader {
   };
 
   FileUploader(const LocalFileLocation &local, const RemoteFileLocation &remote, int64 expected_size,
-               const FileEncryptionKey &encryption_key, std::vector<int> bad_parts, unique_ptr<Callback> callback);
+               const FileEncryptionKey &encryption_key, std::vector<int> bad_parts,
+               ActorId<FileIoService> file_io_service, unique_ptr<Callback> callback);
 
   // Should just implement all parent pure virtual methods.
   // Must not call any of them...
@@ -41,6 +44,7 @@ class FileUploader : public FileLoader {
   int64 expected_size_;
   FileEncryptionKey encryption_key_;
   std::vector<int> bad_parts_;
+  ActorId<FileIoService> file_io_service_;
   unique_ptr<Callback> callback_;
   int64 local_size_ = 0;
   bool local_is_ready_ = false;
@@ -52,8 +56,9 @@ class FileUploader : public FileLoader {
   int64 generate_offset_ = 0;
   int64 next_offset_ = 0;
 
-  FileFd fd_;
+  std::shared_ptr<FileFd> fd_;  // shared with part reads in the FileIoService
   string fd_path_;
+  uint64 fd_generation_ = 0;  // changed when fd_path_ changes
   bool is_temp_ = false;
   int64 file_id_;
   bool big_flag_;
@@ -65,6 +70,8 @@ class FileUploader : public FileLoader {
   void after_start_parts() override;
   Result<std::pair<NetQueryPtr, bool>> start_part(Part part, int32 part_count,
                                                   int64 streaming_offset) override TD_WARN_UNUSED_RESULT;
+  void on_part_read(Part part, int32 part_count, uint64 fd_generation, Result<BufferSlice> r_bytes);
+  NetQueryPtr create_part_query(Part part, int32 part_count, BufferSlice bytes) const;
   Result<size_t> process_part(Part part, NetQueryPtr net_query) override TD_WARN_UNUSED_RESULT;
   void on_progress(Progress progress) override;
   FileLoader::Callback *get_callback() override;
@@ -81,6 +81,28 @@ void PartsManager::set_streaming_limit(int64 limit) {
   }
 }
 
+bool PartsManager::increase_part_size(size_t part_size) {
+  if (part_size <= part_size_ || part_size > MAX_PART_SIZE || MAX_PART_SIZE % part_size != 0) {
+    return false;
+  }
+  if (pending_count_ != 0 || ready_size_ != 0 || need_check_ || known_prefix_flag_) {
+    return false;
+  }
+  for (auto status : part_status_) {
+    if (status != PartStatus::Empty) {
+      return false;
+    }
+  }
+
+  part_size_ = part_size;
+  part_count_ = unknown_size_flag_ ? 0 : static_cast<int>(calc_part_count(size_, part_size_));
+  part_status_ = vector<PartStatus>(part_count_);
+  first_empty_part_ = 0;
+  first_not_ready_part_ = 0;
+  set_streaming_offset(streaming_offset_, streaming_limit_);
+  return true;
+}
+
 Status PartsManager::init_no_size(size_t part_size, const std::vector<int> &ready_parts) {
   unknown_size_flag_ = true;
   size_ = 0;
@@ -21,6 +21,8 @@ struct Part {
 
 class PartsManager {
  public:
+  static constexpr size_t MAX_PART_SIZE = 512 * (1 << 10);
+
   Status init(int64 size, int64 expected_size, bool is_size_final, size_t part_size,
               const std::vector<int> &ready_parts, bool use_part_count_limit, bool is_upload) TD_WARN_UNUSED_RESULT;
   bool may_finish();
@@ -37,6 +39,8 @@ class PartsManager {
   void set_checked_prefix_size(int64 size);
   int32 set_streaming_offset(int64 offset, int64 limit);
   void set_streaming_limit(int64 limit);
+  // can be used only before the first part is started; returns false, if the part size wasn't changed
+  bool increase_part_size(size_t part_size);
 
   int64 get_checked_prefix_size() const;
   int64 get_unchecked_ready_prefix_size();
@@ -55,7 +59,6 @@ class PartsManager {
 
  private:
   static constexpr int MAX_PART_COUNT = 4000;
-  static constexpr size_t MAX_PART_SIZE = 512 * (1 << 10);
   static constexpr int64 MAX_FILE_SIZE = static_cast<int64>(MAX_PART_SIZE) * MAX_PART_COUNT;
 
   enum class PartStatus : int32 { Empty, Pending, Ready };
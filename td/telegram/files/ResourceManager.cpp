@@ -13,6 +13,7 @@
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
 #include "td/utils/ScopeGuard.h"
+#include "td/utils/Time.h"
 
 #include <algorithm>
 
@@ -28,7 +29,8 @@ void ResourceManager::register_worker(ActorShared<FileLoaderActor> callback, int
   node->callback_ = std::move(callback);
 
   add_node(node_id, priority);
-  send_closure(node->callback_, &FileLoaderActor::set_resource_manager, actor_shared(this, node_id));
+  send_closure(node->callback_, &FileLoaderActor::set_resource_manager, actor_shared(this, node_id),
+               get_part_size_hint());
 }
 
 void ResourceManager::update_priority(int8 priority) {
@@ -65,6 +67,22 @@ void ResourceManager::update_resources(const ResourceState &resource_state) {
   loop();
 }
 
+void ResourceManager::on_part_transferred(int64 size, double sent_at) {
+  if (stop_flag_) {
+    return;
+  }
+  auto now = Time::now();
+  transfer_estimator_.on_part_transferred(size, sent_at, now);
+  VLOG(file_loader) << "Transferred " << size << " bytes in " << now - sent_at << " seconds; "
+                    << tag("bandwidth", transfer_estimator_.get_bandwidth(now))
+                    << tag("min_rtt", transfer_estimator_.get_min_rtt());
+  loop();
+}
+
+size_t ResourceManager::get_part_size_hint() {
+  return transfer_estimator_.get_part_size(Time::now());
+}
+
 void ResourceManager::hangup_shared() {
   auto node_id = get_link_token();
   auto node_ptr = nodes_container_.get(node_id);
@@ -115,7 +133,7 @@ bool ResourceManager::satisfy_node(NodeId file_node_id) {
   give = min(need, give);
   give -= give % part_size;
   VLOG(file_loader) << tag("give", give);
-  if (give == 0) {
+  if (give <= 0) {
     return false;
   }
   resource_state_.start_use(give);
@@ -131,8 +149,9 @@ void ResourceManager::loop() {
     }
     return;
   }
+  // the limit may decrease below the number of bytes in use; then new parts wait until the old ones are finished
   auto active_limit = resource_state_.active_limit();
-  resource_state_.update_limit(MAX_RESOURCE_LIMIT - active_limit);
+  resource_state_.update_limit(transfer_estimator_.get_in_flight_limit(Time::now()) - active_limit);
   LOG(INFO) << tag("unused", resource_state_.unused());
 
   if (mode_ == Mode::Greedy) {
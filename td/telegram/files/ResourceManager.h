@@ -10,6 +10,7 @@
 
 #include "td/telegram/files/FileLoaderActor.h"
 #include "td/telegram/files/ResourceState.h"
+#include "td/telegram/files/TransferEstimator.h"
 
 #include "td/utils/Container.h"
 #include "td/utils/Heap.h"
@@ -26,11 +27,10 @@ class ResourceManager : public Actor {
   // use through ActorShared
   void update_priority(int8 priority);
   void update_resources(const ResourceState &resource_state);
+  void on_part_transferred(int64 size, double sent_at);
 
   void register_worker(ActorShared<FileLoaderActor> callback, int8 priority);
 
-  static constexpr int64 MAX_RESOURCE_LIMIT = 1 << 21;
-
  private:
   Mode mode_;
   using NodeId = uint64;
@@ -52,6 +52,7 @@ class ResourceManager : public Actor {
   vector<std::pair<int8, NodeId>> to_xload_;
   KHeap<int64> by_estimated_extra_;
   ResourceState resource_state_;
+  TransferEstimator transfer_estimator_;
 
   ActorShared<> parent_;
   bool stop_flag_ = false;
@@ -60,6 +61,8 @@ class ResourceManager : public Actor {
 
   void loop() override;
 
+  size_t get_part_size_hint();
+
   void add_to_heap(Node *node);
   bool satisfy_node(NodeId file_node_id);
   void add_node(NodeId node_id, int8 priority);
@@ -0,0 +1,86 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/files/TransferEstimator.h"
+
+#include "td/telegram/files/PartsManager.h"
+
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+
+#include <algorithm>
+
+namespace td {
+
+constexpr int64 TransferEstimator::MIN_IN_FLIGHT_LIMIT;
+constexpr int64 TransferEstimator::MAX_IN_FLIGHT_LIMIT;
+
+void TransferEstimator::on_part_transferred(int64 size, double sent_at, double now) {
+  CHECK(size >= 0);
+  if (!deliveries_.empty() && now < deliveries_.back().time) {
+    now = deliveries_.back().time;
+  }
+  auto rtt = now - sent_at;
+  if (rtt > 0 && (min_rtt_ == 0 || rtt < min_rtt_)) {
+    min_rtt_ = rtt;
+  }
+
+  // the delivery rate is measured from the last delivery before the part was sent, so that
+  // concurrently transferred parts are accounted for, as it is done in BBR
+  auto bytes = size;
+  auto interval = rtt;
+  auto it = std::upper_bound(deliveries_.begin(), deliveries_.end(), sent_at,
+                             [](double time, const Delivery &delivery) { return time < delivery.time; });
+  if (it != deliveries_.begin()) {
+    --it;
+    bytes = delivered_ + size - it->delivered;
+    interval = now - it->time;
+  }
+  if (interval > 1e-3) {
+    max_bandwidth_.add_event(static_cast<double>(bytes) / interval, now);
+  }
+
+  delivered_ += size;
+  deliveries_.push_back(Delivery{now, delivered_});
+  while (deliveries_.size() > MAX_DELIVERY_COUNT || deliveries_.front().time < now - DELIVERY_HISTORY) {
+    deliveries_.pop_front();
+  }
+}
+
+double TransferEstimator::get_bandwidth(double now) {
+  auto bandwidth = max_bandwidth_.get_stat(now).get_stat();
+  return bandwidth ? bandwidth.value() : 0.0;
+}
+
+double TransferEstimator::get_min_rtt() const {
+  return min_rtt_;
+}
+
+int64 TransferEstimator::get_bdp(double now) {
+  return static_cast<int64>(get_bandwidth(now) * get_min_rtt());
+}
+
+int64 TransferEstimator::get_in_flight_limit(double now) {
+  // the limit is above the bandwidth-delay product to probe for more bandwidth; while the link isn't saturated,
+  // each round trip increases the measured bandwidth, so the limit grows exponentially like in slow start
+  auto limit = static_cast<int64>(IN_FLIGHT_GAIN * static_cast<double>(get_bdp(now)));
+  return clamp(limit, MIN_IN_FLIGHT_LIMIT, MAX_IN_FLIGHT_LIMIT);
+}
+
+size_t TransferEstimator::get_part_size(double now) {
+  auto bdp = get_bdp(now);
+  if (bdp == 0) {
+    return 0;
+  }
+  // there is no need for more parts in flight than PARTS_PER_BDP; bigger parts need fewer queries
+  size_t part_size = 4 << 10;
+  while (part_size < PartsManager::MAX_PART_SIZE && static_cast<int64>(part_size) * PARTS_PER_BDP < bdp) {
+    part_size *= 2;
+  }
+  return part_size;
+}
+
+}  // namespace td
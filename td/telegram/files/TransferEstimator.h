@@ -0,0 +1,60 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/TimedStat.h"
+
+#include <deque>
+
+namespace td {
+
+// BBR-like estimator of the bottleneck bandwidth and the minimal round-trip time of a link,
+// which are used to choose the number of bytes in flight and the part size
+class TransferEstimator {
+ public:
+  static constexpr int64 MIN_IN_FLIGHT_LIMIT = 1 << 21;
+  static constexpr int64 MAX_IN_FLIGHT_LIMIT = 1 << 25;
+
+  // a part of the given size, sent at sent_at, was fully transferred at now
+  void on_part_transferred(int64 size, double sent_at, double now);
+
+  // bytes per second, or 0 if unknown
+  double get_bandwidth(double now);
+
+  // seconds, or 0 if unknown
+  double get_min_rtt() const;
+
+  int64 get_in_flight_limit(double now);
+
+  // returns 0 if there is no recommendation
+  size_t get_part_size(double now);
+
+ private:
+  static constexpr double BANDWIDTH_WINDOW = 5.0;
+  static constexpr double DELIVERY_HISTORY = 10.0;
+  static constexpr double IN_FLIGHT_GAIN = 2.0;
+  static constexpr int64 PARTS_PER_BDP = 16;
+  static constexpr size_t MAX_DELIVERY_COUNT = 1024;
+
+  struct Delivery {
+    double time;
+    int64 delivered;
+  };
+  std::deque<Delivery> deliveries_;
+  int64 delivered_ = 0;
+
+  TimedStat<MaxStat<double>> max_bandwidth_{BANDWIDTH_WINDOW, 0};
+
+  // unlike in BBR, the minimal RTT never expires, because without RTT probing it would be replaced with RTT,
+  // inflated by the queue, which the in-flight limit itself creates; an outdated RTT only decreases the limit
+  double min_rtt_ = 0;
+
+  int64 get_bdp(double now);
+};
+
+}  // namespace td
@@ -18,12 +18,14 @@
 #include "td/utils/common.h"
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
+#include "td/utils/ObjectArena.h"
 #include "td/utils/ObjectPool.h"
 #include "td/utils/Slice.h"
 #include "td/utils/Status.h"
 #include "td/utils/StringBuilder.h"
 #include "td/utils/Time.h"
 #include "td/utils/tl_parsers.h"
+#include "td/utils/TraceRecorder.h"
 #include "td/utils/TsList.h"
 
 #include <atomic>
@@ -77,6 +79,10 @@ class NetQuery : public TsListNode<NetQueryDebug> {
     return tl_constructor_;
   }
 
+  uint64 trace_id() const {
+    return trace_id_;
+  }
+
   void resend(DcId new_dc_id) {
     VLOG(net_query) << "Resend" << *this;
     {
@@ -288,6 +294,7 @@ class NetQuery : public TsListNode<NetQueryDebug> {
   BufferSlice query_;
   BufferSlice answer_;
   int32 tl_constructor_ = 0;
+  uint64 trace_id_ = 0;
 
   NetQueryRef invoke_after_;
   uint32 session_rand_ = 0;
@@ -353,6 +360,7 @@ class NetQuery : public TsListNode<NetQueryDebug> {
       , query_(std::move(query))
       , answer_(std::move(answer))
       , tl_constructor_(tl_constructor)
+      , trace_id_(TraceRecorder::get_trace_id())
       , total_timeout_limit_(total_timeout_limit) {
     auto &data = get_data_unsafe();
     data.my_id_ = get_my_id();
@@ -394,8 +402,10 @@ inline void cancel_query(NetQueryRef &ref) {
   ref->cancel(ref.generation());
 }
 
+namespace detail {
+
 template <class T>
-Result<typename T::ReturnType> fetch_result(const BufferSlice &message) {
+Result<typename T::ReturnType> fetch_result_impl(const BufferSlice &message) {
   TlBufferParser parser(&message);
   auto result = T::fetch_result(parser);
   parser.fetch_end();
@@ -409,6 +419,19 @@ Result<typename T::ReturnType> fetch_result(const BufferSlice &message) {
   return std::move(result);
 }
 
+}  // namespace detail
+
+template <class T>
+Result<typename T::ReturnType> fetch_result(const BufferSlice &message) {
+  constexpr size_t MIN_ARENA_MESSAGE_SIZE = 1 << 14;
+  if (message.size() >= MIN_ARENA_MESSAGE_SIZE) {
+    // big answers contain a lot of small objects, which are allocated much faster from an arena
+    ObjectArena::Guard arena_guard;
+    return detail::fetch_result_impl<T>(message);
+  }
+  return detail::fetch_result_impl<T>(message);
+}
+
 template <class T>
 Result<typename T::ReturnType> fetch_result(NetQueryPtr query) {
   CHECK(!query.empty());
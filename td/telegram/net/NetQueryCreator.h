@@ -33,6 +33,10 @@ class NetQueryCreator {
     object_pool_.set_check_empty(false);
   }
 
+  NetQueryStats *get_net_query_stats() const {
+    return net_query_stats_.get();
+  }
+
   NetQueryPtr create_update(BufferSlice &&buffer) {
     return object_pool_.create(NetQuery::State::OK, 0, BufferSlice(), std::move(buffer), DcId::main(),
                                NetQuery::Type::Common, NetQuery::AuthFlag::On, NetQuery::GzipFlag::Off, 0, 0,
@@ -26,10 +26,23 @@
 #include "td/utils/misc.h"
 #include "td/utils/port/thread.h"
 #include "td/utils/Slice.h"
+#include "td/utils/Time.h"
+#include "td/utils/TraceRecorder.h"
 
 namespace td {
 
 void NetQueryDispatcher::complete_net_query(NetQueryPtr net_query) {
+  if (net_query->trace_id() != 0 && TraceRecorder::is_enabled()) {
+    double start_time;
+    {
+      auto guard = net_query->lock();
+      start_time = net_query->get_data_unsafe().start_timestamp_;
+    }
+    TraceRecorder::add_span(net_query->trace_id(),
+                            PSLICE() << "NetQuery " << format::as_hex(net_query->tl_constructor()), start_time,
+                            Time::now());
+  }
+  TraceIdGuard trace_id_guard(net_query->trace_id());
   auto callback = net_query->move_callback();
   if (callback.empty()) {
     net_query->debug("sent to td (no callback)");
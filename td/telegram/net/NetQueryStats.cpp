@@ -19,9 +19,30 @@ uint64 NetQueryStats::get_count() const {
   return count_.load(std::memory_order_relaxed);
 }
 
+std::shared_ptr<NetQuerySessionStats> NetQueryStats::register_session(string session_name) {
+  auto result = std::make_shared<NetQuerySessionStats>();
+  std::lock_guard<std::mutex> guard(session_stats_mutex_);
+  td::remove_if(session_stats_, [](auto &it) { return it.second.expired(); });
+  session_stats_.emplace_back(std::move(session_name), result);
+  return result;
+}
+
 void NetQueryStats::dump_pending_network_queries() {
   auto n = get_count();
   LOG(WARNING) << tag("pending net queries", n);
+  {
+    std::lock_guard<std::mutex> guard(session_stats_mutex_);
+    for (auto &it : session_stats_) {
+      auto stats = it.second.lock();
+      if (stats == nullptr) {
+        continue;
+      }
+      auto queries_size = static_cast<uint64>(stats->queries_size.load(std::memory_order_relaxed));
+      LOG(WARNING) << it.first << tag("queries", stats->queries_count.load(std::memory_order_relaxed))
+                   << tag("size", format::as_size(queries_size))
+                   << tag("rtt", format::as_time(stats->rtt.load(std::memory_order_relaxed)));
+    }
+  }
 
   if (!use_list_) {
     return;
@@ -12,6 +12,9 @@
 #include "td/utils/TsList.h"
 
 #include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
 
 namespace td {
 
@@ -27,6 +30,13 @@ struct NetQueryDebug {
   bool unknown_state_ = false;
 };
 
+// updated by the owning SessionMultiProxy without locks and read when queries are dumped
+struct NetQuerySessionStats {
+  std::atomic<int32> queries_count{0};
+  std::atomic<int64> queries_size{0};
+  std::atomic<double> rtt{0};
+};
+
 class NetQueryStats {
  public:
   NetQueryCounter register_query(TsListNode<NetQueryDebug> *query) {
@@ -40,10 +50,16 @@ class NetQueryStats {
 
   void dump_pending_network_queries();
 
+  // the statistics are dumped while the returned object is alive
+  std::shared_ptr<NetQuerySessionStats> register_session(string session_name);
+
  private:
   NetQueryCounter::Counter count_{0};
   std::atomic<bool> use_list_{true};
   TsList<NetQueryDebug> list_;
+
+  std::mutex session_stats_mutex_;
+  vector<std::pair<string, std::weak_ptr<NetQuerySessionStats>>> session_stats_;
 };
 
 }  // namespace td
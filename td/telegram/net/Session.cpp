@@ -8,6 +8,7 @@
 
 #include "td/telegram/telegram_api.h"
 
+#include "td/telegram/ConfigShared.h"
 #include "td/telegram/DhCache.h"
 #include "td/telegram/Global.h"
 #include "td/telegram/net/DcAuthManager.h"
@@ -16,6 +17,7 @@
 #include "td/telegram/net/NetQuery.h"
 #include "td/telegram/net/NetQueryDispatcher.h"
 #include "td/telegram/net/NetType.h"
+#include "td/telegram/net/SessionConnectionChooser.h"
 #include "td/telegram/StateManager.h"
 #include "td/telegram/UniqueId.h"
 
@@ -36,6 +38,7 @@
 #include "td/utils/Time.h"
 #include "td/utils/Timer.h"
 #include "td/utils/tl_parsers.h"
+#include "td/utils/TraceRecorder.h"
 
 #include <tuple>
 #include <utility>
@@ -173,6 +176,15 @@ Session::Session(unique_ptr<Callback> callback, std::shared_ptr<AuthDataShared>
   main_connection_.connection_id = 0;
   long_poll_connection_.connection_id = 1;
 
+  // the option is applied to newly created sessions
+  auto connection_count =
+      clamp(narrow_cast<int32>(G()->shared_config().get_option_integer("session_connection_count", 1)), 1,
+            MAX_CONNECTION_COUNT);
+  extra_connections_.resize(static_cast<size_t>(connection_count - 1));
+  for (size_t i = 0; i < extra_connections_.size(); i++) {
+    extra_connections_[i].connection_id = narrow_cast<int8>(i + SessionConnectionChooser::FIRST_EXTRA_CONNECTION_ID);
+  }
+
   if (is_cdn) {
     auth_data_.set_header(G()->mtproto_header().get_anonymous_header().str());
   } else {
@@ -212,8 +224,7 @@ void Session::on_network(bool network_flag, uint32 network_generation) {
   network_flag_ = network_flag;
   if (network_generation_ != network_generation) {
     network_generation_ = network_generation;
-    connection_close(&main_connection_);
-    connection_close(&long_poll_connection_);
+    connection_close_all();
   }
 
   for (auto &handshake_info : handshake_info_) {
@@ -246,6 +257,11 @@ void Session::connection_online_update(bool force) {
   if (long_poll_connection_.connection) {
     long_poll_connection_.connection->set_online(connection_online_flag_, is_main_);
   }
+  for (auto &info : extra_connections_) {
+    if (info.connection) {
+      info.connection->set_online(connection_online_flag_, is_main_);
+    }
+  }
 }
 
 void Session::send(NetQueryPtr &&query) {
@@ -307,8 +323,7 @@ void Session::on_bind_result(NetQueryPtr query) {
     LOG(INFO) << "Resend bind auth key " << auth_data_.get_tmp_auth_key().id() << " request after DispatchTtlError";
   } else {
     LOG(ERROR) << "BindKey failed: " << status;
-    connection_close(&main_connection_);
-    connection_close(&long_poll_connection_);
+    connection_close_all();
   }
 
   query->clear();
@@ -335,8 +350,7 @@ void Session::on_check_key_result(NetQueryPtr query) {
     auth_data_.set_use_pfs(true);
   } else {
     LOG(ERROR) << "Check main key failed: " << status;
-    connection_close(&main_connection_);
-    connection_close(&long_poll_connection_);
+    connection_close_all();
   }
 
   query->clear();
@@ -354,10 +368,19 @@ void Session::on_result(NetQueryPtr query) {
   query->clear();
 }
 
+void Session::trace_round_trip(const Query *query) {
+  auto trace_id = query->query->trace_id();
+  if (trace_id != 0 && TraceRecorder::is_enabled()) {
+    TraceRecorder::add_span(trace_id, PSLICE() << "Round trip " << format::as_hex(query->query->tl_constructor()),
+                            query->sent_at_, Time::now());
+  }
+}
+
 void Session::return_query(NetQueryPtr &&query) {
   last_activity_timestamp_ = Time::now();
 
   query->set_session_id(0);
+  TraceIdGuard trace_id_guard(query->trace_id());
   callback_->on_result(std::move(query));
 }
 
@@ -372,8 +395,7 @@ void Session::flush_pending_invoke_after_queries() {
 void Session::close() {
   LOG(INFO) << "Close session (external)";
   close_flag_ = true;
-  connection_close(&main_connection_);
-  connection_close(&long_poll_connection_);
+  connection_close_all();
 
   for (auto &it : sent_queries_) {
     auto &query = it.second.query;
@@ -435,16 +457,26 @@ void Session::on_connected() {
 Status Session::on_pong() {
   constexpr int MAX_QUERY_TIMEOUT = 60;
   constexpr int MIN_CONNECTION_ACTIVE = 60;
-  if (current_info_ == &main_connection_ &&
+  if (current_info_ != &long_poll_connection_) {
+    auto rtt = current_info_->connection->get_pong_rtt();
+    if (rtt > 0) {
+      callback_->on_rtt_updated(rtt);
+    }
+  }
+  // every connection checks only queries sent through it, so a hung additional connection is closed by itself
+  if (current_info_ != &long_poll_connection_ &&
       Timestamp::at(current_info_->created_at + MIN_CONNECTION_ACTIVE).is_in_past()) {
     Status status;
-    if (!unknown_queries_.empty()) {
+    if (current_info_ == &main_connection_ && !unknown_queries_.empty()) {
       status = Status::Error(PSLICE() << "No state info for " << unknown_queries_.size() << " queries for "
                                       << format::as_time(Time::now_cached() - current_info_->created_at));
     }
     if (!sent_queries_list_.empty()) {
       for (auto it = sent_queries_list_.prev; it != &sent_queries_list_; it = it->prev) {
         auto query = Query::from_list_node(it);
+        if (query->connection_id != current_info_->connection_id) {
+          continue;
+        }
         if (Timestamp::at(query->sent_at_ + MAX_QUERY_TIMEOUT).is_in_past()) {
           if (status.is_ok()) {
             status = Status::Error(PSLICE() << "No answer for " << query->query << " for "
@@ -524,6 +556,7 @@ void Session::on_closed(Status status) {
   }
 
   // resend all queries without ack
+  vector<uint64> new_unknown_queries;
   for (auto it = sent_queries_.begin(); it != sent_queries_.end();) {
     if (!it->second.ack && it->second.connection_id == current_info_->connection_id) {
       // container vector leak otherwise
@@ -543,6 +576,9 @@ void Session::on_closed(Status status) {
         return_query(std::move(query));
         it = sent_queries_.erase(it);
       } else {
+        if (!it->second.unknown) {
+          new_unknown_queries.push_back(it->first);
+        }
         mark_as_unknown(it->first, &it->second);
         ++it;
       }
@@ -551,6 +587,13 @@ void Session::on_closed(Status status) {
     }
   }
 
+  if (current_info_ != &main_connection_ && main_connection_.state == ConnectionInfo::State::Ready) {
+    // the main connection is still alive, so ask it about queries lost with an additional connection
+    for (auto id : new_unknown_queries) {
+      main_connection_.connection->get_state_info(id);
+    }
+  }
+
   current_info_->connection.reset();
   current_info_->state = ConnectionInfo::State::Empty;
 }
@@ -750,6 +793,7 @@ Status Session::on_message_result_ok(uint64 id, BufferSlice packet, size_t origi
 
   cleanup_container(id, query_ptr);
   mark_as_known(id, query_ptr);
+  trace_round_trip(query_ptr);
   query_ptr->query->on_net_read(original_size);
   query_ptr->query->set_ok(std::move(packet));
   query_ptr->query->set_message_id(0);
@@ -804,6 +848,7 @@ void Session::on_message_result_error(uint64 id, int error_code, BufferSlice mes
 
   cleanup_container(id, query_ptr);
   mark_as_known(id, query_ptr);
+  trace_round_trip(query_ptr);
   query_ptr->query->set_error(Status::Error(error_code, message.as_slice()),
                               current_info_->connection->get_name().str());
   query_ptr->query->set_message_id(0);
@@ -976,7 +1021,7 @@ void Session::connection_send_query(ConnectionInfo *info, NetQueryPtr &&net_quer
     net_query->cancel_slot_.set_event(EventCreator::raw(actor_id(), message_id));
   }
   auto status = sent_queries_.emplace(
-      message_id, Query{message_id, std::move(net_query), main_connection_.connection_id, Time::now_cached()});
+      message_id, Query{message_id, std::move(net_query), info->connection_id, Time::now_cached()});
   sent_queries_list_.put(status.first->second.get_list_node());
   if (!status.second) {
     LOG(FATAL) << "Duplicate message_id [message_id = " << message_id << "]";
@@ -1069,6 +1114,13 @@ void Session::connection_open_finish(ConnectionInfo *info,
       return;
     }
   }
+  if (info->connection_id >= 2 && mode_ != Mode::Tcp) {
+    VLOG(dc) << "Additional connections are used only in Tcp mode";
+    connection_add(std::move(raw_connection));
+    info->state = ConnectionInfo::State::Empty;
+    yield();
+    return;
+  }
 
   mtproto::SessionConnection::Mode mode;
   Slice mode_name;
@@ -1129,6 +1181,46 @@ void Session::connection_close(ConnectionInfo *info) {
   CHECK(info->state == ConnectionInfo::State::Empty);
 }
 
+void Session::connection_close_all() {
+  connection_close(&main_connection_);
+  connection_close(&long_poll_connection_);
+  for (auto &info : extra_connections_) {
+    connection_close(&info);
+  }
+}
+
+SessionConnectionChooser Session::create_connection_chooser() {
+  SessionConnectionChooser result(extra_connections_.size() + SessionConnectionChooser::FIRST_EXTRA_CONNECTION_ID);
+  for (auto &it : sent_queries_) {
+    auto &query = it.second;
+    if (!query.ack) {
+      result.add_in_flight_query(query.connection_id, query.query->query().size());
+    }
+  }
+  return result;
+}
+
+Session::ConnectionInfo *Session::choose_connection(NetQueryPtr &net_query, SessionConnectionChooser &chooser) {
+  auto size = net_query->query().size();
+  bool is_ordered = !net_query->invoke_after().empty();
+  if (SessionConnectionChooser::can_use_extra_connection(size, is_ordered)) {
+    need_extra_connections_ = true;
+  }
+  auto connection_id = chooser.choose(size, is_ordered, [&](int8 id) {
+    return get_extra_connection(id).state == ConnectionInfo::State::Ready;
+  });
+  if (connection_id == SessionConnectionChooser::MAIN_CONNECTION_ID) {
+    return &main_connection_;
+  }
+  return &get_extra_connection(connection_id);
+}
+
+Session::ConnectionInfo &Session::get_extra_connection(int8 connection_id) {
+  auto pos = static_cast<size_t>(connection_id - SessionConnectionChooser::FIRST_EXTRA_CONNECTION_ID);
+  CHECK(pos < extra_connections_.size());
+  return extra_connections_[pos];
+}
+
 bool Session::need_send_check_main_key() const {
   return need_check_main_key_ && auth_data_.get_main_auth_key().id() != being_checked_main_auth_key_id_;
 }
@@ -1219,8 +1311,7 @@ void Session::on_handshake_ready(Result<unique_ptr<mtproto::AuthKeyHandshake>> r
       }
       LOG(WARNING) << "Update auth key in session_id " << auth_data_.get_session_id() << " to "
                    << auth_data_.get_auth_key().id();
-      connection_close(&main_connection_);
-      connection_close(&long_poll_connection_);
+      connection_close_all();
 
       // Salt of temporary key is different salt. Do not rewrite it
       if (auth_data_.use_pfs() ^ is_main) {
@@ -1341,9 +1432,14 @@ void Session::loop() {
     while (main_connection_.state == ConnectionInfo::State::Ready) {
       if (auth_data_.is_ready(Time::now_cached())) {
         if (need_send_query()) {
+          SessionConnectionChooser chooser(0);
+          if (!extra_connections_.empty() && !pending_queries_.empty()) {
+            chooser = create_connection_chooser();
+          }
           while (!pending_queries_.empty() && sent_queries_.size() < MAX_INFLIGHT_QUERIES) {
             auto query = pending_queries_.pop();
-            connection_send_query(&main_connection_, std::move(query));
+            auto *info = extra_connections_.empty() ? &main_connection_ : choose_connection(query, chooser);
+            connection_send_query(info, std::move(query));
             need_flush = true;
           }
         }
@@ -1365,6 +1461,18 @@ void Session::loop() {
       }
     }
   }
+  for (auto &info : extra_connections_) {
+    info.wakeup_at = 0;
+    connection_check_mode(&info);
+    if (info.state == ConnectionInfo::State::Ready) {
+      connection_flush(&info);
+    }
+    if (!close_flag_ && need_extra_connections_ && mode_ == Mode::Tcp &&
+        main_connection_.state == ConnectionInfo::State::Ready && info.state == ConnectionInfo::State::Empty) {
+      connection_open(&info);
+    }
+    relax_timeout_at(&wakeup_at, info.wakeup_at);
+  }
   if (!close_flag_ && main_connection_.state == ConnectionInfo::State::Empty) {
     connection_open(&main_connection_, true /*send ask_info*/);
   }
@@ -8,6 +8,7 @@
 
 #include "td/telegram/net/AuthDataShared.h"
 #include "td/telegram/net/NetQuery.h"
+#include "td/telegram/net/SessionConnectionChooser.h"
 #include "td/telegram/net/TempAuthKeyWatchdog.h"
 #include "td/telegram/StateManager.h"
 
@@ -63,6 +64,8 @@ class Session final
     virtual void on_tmp_auth_key_updated(mtproto::AuthKey auth_key) = 0;
     virtual void on_server_salt_updated(std::vector<mtproto::ServerSalt> server_salts) {
     }
+    virtual void on_rtt_updated(double rtt) {
+    }
     // one still have to call close after on_closed
     virtual void on_result(NetQueryPtr net_query) = 0;
   };
@@ -153,6 +156,10 @@ class Session final
   ConnectionInfo *current_info_;
   ConnectionInfo main_connection_;
   ConnectionInfo long_poll_connection_;
+  // additional TCP connections sharing auth key, salt and message ordering with the main connection;
+  // big queries are spread between them. NB: the vector must not be resized after creation
+  std::vector<ConnectionInfo> extra_connections_;
+  bool need_extra_connections_ = false;
   StateManager::ConnectionToken connection_token_;
 
   double cached_connection_timestamp_ = 0;
@@ -168,6 +175,7 @@ class Session final
 
   static constexpr double ACTIVITY_TIMEOUT = 60 * 5;
   static constexpr size_t MAX_INFLIGHT_QUERIES = 1024;
+  static constexpr int32 MAX_CONNECTION_COUNT = 8;
 
   struct ContainerInfo {
     size_t ref_cnt;
@@ -220,6 +228,7 @@ class Session final
   void dec_container(uint64 message_id, Query *query);
   void cleanup_container(uint64 id, Query *query);
   void mark_as_known(uint64 id, Query *query);
+  static void trace_round_trip(const Query *query);
   void mark_as_unknown(uint64 id, Query *query);
 
   void on_message_ack_impl(uint64 id, int32 type);
@@ -238,6 +247,10 @@ class Session final
 
   void connection_online_update(bool force = false);
   void connection_close(ConnectionInfo *info);
+  void connection_close_all();
+  ConnectionInfo *choose_connection(NetQueryPtr &net_query, SessionConnectionChooser &chooser);
+  SessionConnectionChooser create_connection_chooser();
+  ConnectionInfo &get_extra_connection(int8 connection_id);
   void connection_flush(ConnectionInfo *info);
   void connection_send_query(ConnectionInfo *info, NetQueryPtr &&net_query, uint64 message_id = 0);
   bool need_send_bind_key() const;
@@ -0,0 +1,96 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/net/SessionBalancer.h"
+
+#include "td/utils/logging.h"
+
+namespace td {
+
+constexpr double SessionBalancer::DEFAULT_RTT;
+constexpr double SessionBalancer::RTT_EWMA_WEIGHT;
+constexpr int64 SessionBalancer::QUERY_SIZE_UNIT;
+constexpr int64 SessionBalancer::GROW_SESSION_LOAD;
+constexpr int64 SessionBalancer::SHRINK_SESSION_LOAD;
+constexpr double SessionBalancer::SHRINK_DELAY;
+
+SessionBalancer::SessionBalancer(int32 session_count, double now)
+    : sessions_(static_cast<size_t>(session_count)), active_session_count_changed_at_(now) {
+  CHECK(session_count > 0);
+}
+
+const SessionBalancer::SessionLoad &SessionBalancer::get_session_load(int32 session_id) const {
+  return sessions_.at(static_cast<size_t>(session_id));
+}
+
+int64 SessionBalancer::get_load(const SessionLoad &session) {
+  return session.queries_count + session.queries_size / QUERY_SIZE_UNIT;
+}
+
+int32 SessionBalancer::choose_session(size_t query_size) const {
+  int32 result = 0;
+  double best_cost = 0;
+  auto query_load = static_cast<double>(query_size) / static_cast<double>(QUERY_SIZE_UNIT);
+  for (int32 i = 0; i < active_session_count_; i++) {
+    auto &session = sessions_[i];
+    auto rtt = session.rtt > 0 ? session.rtt : DEFAULT_RTT;
+    auto cost = rtt * (1.0 + query_load + session.queries_count +
+                       static_cast<double>(session.queries_size) / static_cast<double>(QUERY_SIZE_UNIT));
+    if (i == 0 || cost < best_cost) {
+      result = i;
+      best_cost = cost;
+    }
+  }
+  return result;
+}
+
+void SessionBalancer::on_query_sent(int32 session_id, size_t query_size) {
+  auto &session = sessions_.at(static_cast<size_t>(session_id));
+  session.queries_count++;
+  session.queries_size += static_cast<int64>(query_size);
+}
+
+void SessionBalancer::on_query_finished(int32 session_id, size_t query_size) {
+  auto &session = sessions_.at(static_cast<size_t>(session_id));
+  session.queries_count--;
+  CHECK(session.queries_count >= 0);
+  session.queries_size -= static_cast<int64>(query_size);
+  CHECK(session.queries_size >= 0);
+}
+
+void SessionBalancer::on_rtt_updated(int32 session_id, double rtt) {
+  if (rtt <= 0) {
+    return;
+  }
+  auto &session = sessions_.at(static_cast<size_t>(session_id));
+  session.rtt = session.rtt > 0 ? session.rtt + (rtt - session.rtt) * RTT_EWMA_WEIGHT : rtt;
+}
+
+bool SessionBalancer::update_active_session_count(double now) {
+  int64 total_load = 0;
+  for (int32 i = 0; i < active_session_count_; i++) {
+    total_load += get_load(sessions_[i]);
+  }
+
+  if (active_session_count_ < get_session_count() && total_load >= active_session_count_ * GROW_SESSION_LOAD) {
+    active_session_count_++;
+    active_session_count_changed_at_ = now;
+    return true;
+  }
+  if (active_session_count_ > 1 && total_load <= (active_session_count_ - 1) * SHRINK_SESSION_LOAD &&
+      active_session_count_changed_at_ + SHRINK_DELAY < now) {
+    active_session_count_--;
+    active_session_count_changed_at_ = now;
+    return true;
+  }
+  return false;
+}
+
+bool SessionBalancer::can_close_inactive_sessions(double now) const {
+  return active_session_count_changed_at_ + SHRINK_DELAY < now;
+}
+
+}  // namespace td
@@ -0,0 +1,68 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+
+namespace td {
+
+// Chooses sessions of a SessionMultiProxy for unordered queries. A query goes to the session, in which it is expected
+// to be finished first: the session's network RTT times the number of queries in flight, where each QUERY_SIZE_UNIT
+// bytes of in-flight queries count as one more query. The number of used sessions grows with the load and shrinks
+// after SHRINK_DELAY seconds of low load.
+class SessionBalancer {
+ public:
+  static constexpr double DEFAULT_RTT = 0.1;
+  static constexpr double RTT_EWMA_WEIGHT = 0.2;
+  static constexpr int64 QUERY_SIZE_UNIT = 1 << 14;  // a query of this size costs as much as one more query
+  static constexpr int64 GROW_SESSION_LOAD = 8;
+  static constexpr int64 SHRINK_SESSION_LOAD = 2;
+  static constexpr double SHRINK_DELAY = 30;
+
+  struct SessionLoad {
+    int32 queries_count = 0;
+    int64 queries_size = 0;
+    double rtt = 0;  // exponentially weighted moving average of the network RTT; 0 if unknown
+  };
+
+  SessionBalancer() = default;
+  SessionBalancer(int32 session_count, double now);
+
+  int32 get_session_count() const {
+    return static_cast<int32>(sessions_.size());
+  }
+
+  // number of sessions, between which unordered queries are distributed; from 1 to get_session_count()
+  int32 get_active_session_count() const {
+    return active_session_count_;
+  }
+
+  const SessionLoad &get_session_load(int32 session_id) const;
+
+  int32 choose_session(size_t query_size) const;
+
+  void on_query_sent(int32 session_id, size_t query_size);
+
+  void on_query_finished(int32 session_id, size_t query_size);
+
+  void on_rtt_updated(int32 session_id, double rtt);
+
+  // returns true, if the number of active sessions has changed
+  bool update_active_session_count(double now);
+
+  // returns true, if idle sessions beyond the active session count can be closed
+  bool can_close_inactive_sessions(double now) const;
+
+ private:
+  vector<SessionLoad> sessions_;
+  int32 active_session_count_ = 1;
+  double active_session_count_changed_at_ = 0;
+
+  static int64 get_load(const SessionLoad &session);
+};
+
+}  // namespace td
@@ -0,0 +1,61 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+
+namespace td {
+
+// Chooses connections of a Session for sent queries. Connection 0 is the main connection, connection 1 is
+// the long poll connection, which is never chosen, and the following connections are additional TCP connections.
+// Big unordered queries go to the ready connection with the fewest unacknowledged bytes, other queries go to
+// the main connection.
+class SessionConnectionChooser {
+ public:
+  static constexpr size_t BIG_QUERY_SIZE = 1 << 14;
+  static constexpr int8 MAIN_CONNECTION_ID = 0;
+  static constexpr int8 FIRST_EXTRA_CONNECTION_ID = 2;
+
+  static bool can_use_extra_connection(size_t query_size, bool is_ordered) {
+    return query_size >= BIG_QUERY_SIZE && !is_ordered;
+  }
+
+  explicit SessionConnectionChooser(size_t connection_count) : in_flight_sizes_(connection_count) {
+  }
+
+  void add_in_flight_query(int8 connection_id, size_t query_size) {
+    auto id = static_cast<size_t>(connection_id);
+    if (id < in_flight_sizes_.size()) {
+      in_flight_sizes_[id] += query_size;
+    }
+  }
+
+  size_t get_in_flight_size(int8 connection_id) const {
+    auto id = static_cast<size_t>(connection_id);
+    return id < in_flight_sizes_.size() ? in_flight_sizes_[id] : 0;
+  }
+
+  // is_ready(connection_id) must return whether the additional connection can be used now
+  template <class F>
+  int8 choose(size_t query_size, bool is_ordered, F &&is_ready) {
+    size_t result = static_cast<size_t>(MAIN_CONNECTION_ID);
+    if (can_use_extra_connection(query_size, is_ordered)) {
+      for (auto id = static_cast<size_t>(FIRST_EXTRA_CONNECTION_ID); id < in_flight_sizes_.size(); id++) {
+        if (in_flight_sizes_[id] < in_flight_sizes_[result] && is_ready(static_cast<int8>(id))) {
+          result = id;
+        }
+      }
+    }
+    in_flight_sizes_[result] += query_size;
+    return static_cast<int8>(result);
+  }
+
+ private:
+  vector<size_t> in_flight_sizes_;
+};
+
+}  // namespace td
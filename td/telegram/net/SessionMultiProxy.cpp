@@ -6,12 +6,17 @@
 //
 #include "td/telegram/net/SessionMultiProxy.h"
 
+#include "td/telegram/Global.h"
+#include "td/telegram/net/NetQueryCreator.h"
+#include "td/telegram/net/NetQueryStats.h"
 #include "td/telegram/net/SessionProxy.h"
 
 #include "td/utils/common.h"
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
+#include "td/utils/misc.h"
 #include "td/utils/Slice.h"
+#include "td/utils/Time.h"
 
 #include <algorithm>
 
@@ -37,27 +42,48 @@ SessionMultiProxy::SessionMultiProxy(int32 session_count, std::shared_ptr<AuthDa
 }
 
 void SessionMultiProxy::send(NetQueryPtr query) {
-  size_t pos = 0;
+  int32 pos = 0;
+  auto query_size = query->query().size();
   // TODO temporary hack with total_timeout_limit
   if (query->auth_flag() == NetQuery::AuthFlag::On && query->total_timeout_limit_ > 7) {
     if (query->session_rand()) {
-      pos = query->session_rand() % sessions_.size();
+      pos = narrow_cast<int32>(query->session_rand() % sessions_.size());
     } else {
-      pos = std::min_element(sessions_.begin(), sessions_.end(),
-                             [](const auto &a, const auto &b) { return a.queries_count < b.queries_count; }) -
-            sessions_.begin();
+      update_active_session_count();
+      pos = balancer_.choose_session(query_size);
     }
   }
   // query->debug(PSTRING() << get_name() << ": send to proxy #" << pos);
-  sessions_[pos].queries_count++;
-  send_closure(sessions_[pos].proxy, &SessionProxy::send, std::move(query));
+  auto &session = get_session(pos);
+  balancer_.on_query_sent(pos, query_size);
+  update_session_stats(pos);
+  send_closure(session.proxy, &SessionProxy::send, std::move(query));
+}
+
+void SessionMultiProxy::update_active_session_count() {
+  auto now = Time::now();
+  if (balancer_.update_active_session_count(now)) {
+    LOG(INFO) << "Change number of active sessions in " << get_name() << " to "
+              << balancer_.get_active_session_count();
+  }
+
+  // idle sessions, which aren't used for unordered queries, are closed
+  if (balancer_.can_close_inactive_sessions(now)) {
+    for (int32 i = balancer_.get_active_session_count(); i < session_count_; i++) {
+      if (!sessions_[i].proxy.empty() && balancer_.get_session_load(i).queries_count == 0) {
+        destroy_session(i);
+      }
+    }
+  }
 }
 
 void SessionMultiProxy::update_main_flag(bool is_main) {
   LOG(INFO) << "Update " << get_name() << " is_main to " << is_main;
   is_main_ = is_main;
   for (auto &session : sessions_) {
-    send_closure(session.proxy, &SessionProxy::update_main_flag, is_main);
+    if (!session.proxy.empty()) {
+      send_closure(session.proxy, &SessionProxy::update_main_flag, is_main);
+    }
   }
 }
 
@@ -102,7 +128,9 @@ void SessionMultiProxy::update_options(int32 session_count, bool use_pfs) {
 
 void SessionMultiProxy::update_mtproto_header() {
   for (auto &session : sessions_) {
-    send_closure_later(session.proxy, &SessionProxy::update_mtproto_header);
+    if (!session.proxy.empty()) {
+      send_closure_later(session.proxy, &SessionProxy::update_mtproto_header);
+    }
   }
 }
 
@@ -120,38 +148,87 @@ void SessionMultiProxy::init() {
   if (is_main_ && session_count_ > 1) {
     LOG(WARNING) << tag("session_count", session_count_);
   }
-  for (int32 i = 0; i < session_count_; i++) {
-    string name = PSTRING() << "Session" << get_name().substr(Slice("SessionMulti").size())
-                            << format::cond(session_count_ > 1, format::concat("#", i));
-
-    SessionInfo info;
-    class Callback : public SessionProxy::Callback {
-     public:
-      Callback(ActorId<SessionMultiProxy> parent, uint32 generation, int32 session_id)
-          : parent_(parent), generation_(generation), session_id_(session_id) {
-      }
-      void on_query_finished() override {
-        send_closure(parent_, &SessionMultiProxy::on_query_finished, generation_, session_id_);
-      }
+  // sessions are created on demand, but the first session is always needed
+  sessions_.resize(session_count_);
+  balancer_ = SessionBalancer(session_count_, Time::now());
+  create_session(0);
+}
+
+SessionMultiProxy::SessionInfo &SessionMultiProxy::get_session(int32 session_id) {
+  auto &session = sessions_.at(session_id);
+  if (session.proxy.empty()) {
+    create_session(session_id);
+  }
+  return session;
+}
 
-     private:
-      ActorId<SessionMultiProxy> parent_;
-      uint32 generation_;
-      int32 session_id_;
-    };
-    info.proxy = create_actor<SessionProxy>(name, make_unique<Callback>(actor_id(this), sessions_generation_, i),
-                                            auth_data_, is_main_, allow_media_only_, is_media_, get_pfs_flag(), is_cdn_,
-                                            need_destroy_auth_key_ && i == 0);
-    sessions_.push_back(std::move(info));
+void SessionMultiProxy::create_session(int32 session_id) {
+  auto &info = sessions_.at(session_id);
+  CHECK(info.proxy.empty());
+  CHECK(balancer_.get_session_load(session_id).queries_count == 0);
+  info.name = PSTRING() << "Session" << get_name().substr(Slice("SessionMulti").size())
+                        << format::cond(session_count_ > 1, format::concat("#", session_id));
+
+  class Callback : public SessionProxy::Callback {
+   public:
+    Callback(ActorId<SessionMultiProxy> parent, uint32 generation, int32 session_id)
+        : parent_(parent), generation_(generation), session_id_(session_id) {
+    }
+    void on_query_finished(size_t query_size) override {
+      send_closure(parent_, &SessionMultiProxy::on_query_finished, generation_, session_id_, query_size);
+    }
+    void on_rtt_updated(double rtt) override {
+      send_closure(parent_, &SessionMultiProxy::on_rtt_updated, generation_, session_id_, rtt);
+    }
+
+   private:
+    ActorId<SessionMultiProxy> parent_;
+    uint32 generation_;
+    int32 session_id_;
+  };
+  info.proxy =
+      create_actor<SessionProxy>(info.name, make_unique<Callback>(actor_id(this), sessions_generation_, session_id),
+                                 auth_data_, is_main_, allow_media_only_, is_media_, get_pfs_flag(), is_cdn_,
+                                 need_destroy_auth_key_ && session_id == 0);
+  auto net_query_stats = G()->net_query_creator().get_net_query_stats();
+  if (net_query_stats != nullptr) {
+    info.stats = net_query_stats->register_session(info.name);
+  }
+  update_session_stats(session_id);
+}
+
+void SessionMultiProxy::destroy_session(int32 session_id) {
+  CHECK(session_id != 0);
+  auto &info = sessions_.at(session_id);
+  LOG(INFO) << "Close idle " << info.name;
+  info = SessionInfo();
+}
+
+void SessionMultiProxy::update_session_stats(int32 session_id) {
+  auto &stats = sessions_[session_id].stats;
+  if (stats != nullptr) {
+    auto &load = balancer_.get_session_load(session_id);
+    stats->queries_count.store(load.queries_count, std::memory_order_relaxed);
+    stats->queries_size.store(load.queries_size, std::memory_order_relaxed);
+    stats->rtt.store(load.rtt, std::memory_order_relaxed);
+  }
+}
+
+void SessionMultiProxy::on_query_finished(uint32 generation, int32 session_id, size_t query_size) {
+  if (generation != sessions_generation_) {
+    return;
   }
+  balancer_.on_query_finished(session_id, query_size);
+  update_session_stats(session_id);
+  update_active_session_count();
 }
 
-void SessionMultiProxy::on_query_finished(uint32 generation, int session_id) {
+void SessionMultiProxy::on_rtt_updated(uint32 generation, int32 session_id, double rtt) {
   if (generation != sessions_generation_) {
     return;
   }
-  sessions_.at(session_id).queries_count--;
-  CHECK(sessions_.at(session_id).queries_count >= 0);
+  balancer_.on_rtt_updated(session_id, rtt);
+  update_session_stats(session_id);
 }
 
 }  // namespace td
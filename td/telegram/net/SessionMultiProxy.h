@@ -8,6 +8,8 @@
 
 #include "td/telegram/net/AuthDataShared.h"
 #include "td/telegram/net/NetQuery.h"
+#include "td/telegram/net/NetQueryStats.h"
+#include "td/telegram/net/SessionBalancer.h"
 
 #include "td/actor/actor.h"
 
@@ -47,17 +49,28 @@ class SessionMultiProxy : public Actor {
   bool need_destroy_auth_key_ = false;
   struct SessionInfo {
     ActorOwn<SessionProxy> proxy;
-    int queries_count{0};
+    string name;
+    std::shared_ptr<NetQuerySessionStats> stats;
   };
   uint32 sessions_generation_{0};
   std::vector<SessionInfo> sessions_;
+  SessionBalancer balancer_;
 
   void start_up() override;
   void init();
 
   bool get_pfs_flag() const;
 
-  void on_query_finished(uint32 generation, int session_id);
+  SessionInfo &get_session(int32 session_id);
+  void create_session(int32 session_id);
+  void destroy_session(int32 session_id);
+
+  void update_active_session_count();
+
+  void update_session_stats(int32 session_id);
+
+  void on_query_finished(uint32 generation, int32 session_id, size_t query_size);
+  void on_rtt_updated(uint32 generation, int32 session_id, double rtt);
 };
 
 }  // namespace td
@@ -57,10 +57,14 @@ class SessionCallback : public Session::Callback {
     send_closure(parent_, &SessionProxy::on_server_salt_updated, std::move(server_salts));
   }
 
+  void on_rtt_updated(double rtt) override {
+    send_closure(parent_, &SessionProxy::on_rtt_updated, rtt);
+  }
+
   void on_result(NetQueryPtr query) override {
     if (UniqueId::extract_type(query->id()) != UniqueId::BindKey &&
         query->id() != 0) {  // not bind key query and not an update
-      send_closure(parent_, &SessionProxy::on_query_finished);
+      send_closure(parent_, &SessionProxy::on_query_finished, query->query().size());
     }
     G()->net_query_dispatcher().dispatch(std::move(query));
   }
@@ -110,7 +114,7 @@ void SessionProxy::start_up() {
 void SessionProxy::tear_down() {
   for (auto &query : pending_queries_) {
     query->resend();
-    callback_->on_query_finished();
+    callback_->on_query_finished(query->query().size());
     G()->net_query_dispatcher().dispatch(std::move(query));
   }
   pending_queries_.clear();
@@ -243,8 +247,12 @@ void SessionProxy::on_server_salt_updated(std::vector<mtproto::ServerSalt> serve
   server_salts_ = std::move(server_salts);
 }
 
-void SessionProxy::on_query_finished() {
-  callback_->on_query_finished();
+void SessionProxy::on_query_finished(size_t query_size) {
+  callback_->on_query_finished(query_size);
+}
+
+void SessionProxy::on_rtt_updated(double rtt) {
+  callback_->on_rtt_updated(rtt);
 }
 
 }  // namespace td
@@ -14,6 +14,7 @@
 #include "td/utils/invoke.h"  // for tuple_for_each
 #include "td/utils/ScopeGuard.h"
 #include "td/utils/Status.h"
+#include "td/utils/TraceRecorder.h"
 
 #include <tuple>
 #include <type_traits>
@@ -263,6 +264,7 @@ class LambdaPromise : public PromiseInterface<ValueT> {
 
  public:
   void set_value(ValueT &&value) override {
+    TraceIdGuard trace_id_guard(trace_id_);
     ok_(std::move(value));
     on_fail_ = OnFail::None;
   }
@@ -288,6 +290,7 @@ class LambdaPromise : public PromiseInterface<ValueT> {
   FunctionOkT ok_;
   FunctionFailT fail_;
   OnFail on_fail_ = OnFail::None;
+  uint64 trace_id_ = TraceRecorder::get_trace_id();
 
   template <class FuncT, class ArgT = detail::get_arg_t<FuncT>>
   std::enable_if_t<std::is_assignable<ArgT, Status>::value> do_error_impl(FuncT &func, Status &&status) {
@@ -303,12 +306,16 @@ class LambdaPromise : public PromiseInterface<ValueT> {
     switch (on_fail_) {
       case OnFail::None:
         break;
-      case OnFail::Ok:
+      case OnFail::Ok: {
+        TraceIdGuard trace_id_guard(trace_id_);
         do_error_impl(ok_, std::move(error));
         break;
-      case OnFail::Fail:
+      }
+      case OnFail::Fail: {
+        TraceIdGuard trace_id_guard(trace_id_);
         fail_(std::move(error));
         break;
+      }
     }
     on_fail_ = OnFail::None;
   }
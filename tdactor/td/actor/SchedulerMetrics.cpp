@@ -0,0 +1,189 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/actor/SchedulerMetrics.h"
+
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+#include "td/utils/StringBuilder.h"
+
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+namespace td {
+
+namespace {
+
+class Registry {
+ public:
+  std::mutex mutex;
+  vector<std::weak_ptr<SchedulerMetrics>> schedulers;
+  std::unordered_map<string, unique_ptr<ActorMetrics>> actors;
+};
+
+Registry &get_registry() {
+  static Registry registry;
+  return registry;
+}
+
+constexpr size_t MAX_ACTOR_METRICS_COUNT = 1000;
+
+class PrometheusWriter {
+ public:
+  explicit PrometheusWriter(StringBuilder &sb) : sb_(sb) {
+  }
+
+  void header(Slice name, Slice type, Slice help) {
+    sb_ << "# HELP " << name << ' ' << help << "\n# TYPE " << name << ' ' << type << '\n';
+  }
+
+  void value(Slice name, Slice labels, uint64 value) {
+    sb_ << name << '{' << labels << "} " << value << '\n';
+  }
+
+  // if is_duration, then values are in nanoseconds and are exported in seconds
+  void histogram(Slice name, Slice labels, const HdrHistogram &histogram, bool is_duration) {
+    uint64 count = 0;
+    histogram.for_each_bucket([&](uint64 max_value, uint64 bucket_count) {
+      count += bucket_count;
+      sb_ << name << "_bucket{" << labels << ",le=\"";
+      write_value(max_value, is_duration);
+      sb_ << "\"} " << count << '\n';
+    });
+    sb_ << name << "_bucket{" << labels << ",le=\"+Inf\"} " << count << '\n';
+    sb_ << name << "_sum{" << labels << "} ";
+    write_value(histogram.get_sum(), is_duration);
+    sb_ << '\n' << name << "_count{" << labels << "} " << count << '\n';
+  }
+
+ private:
+  StringBuilder &sb_;
+
+  void write_value(uint64 value, bool is_duration) {
+    if (is_duration) {
+      sb_ << StringBuilder::FixedDouble(static_cast<double>(value) * 1e-9, 9);
+    } else {
+      sb_ << value;
+    }
+  }
+};
+
+}  // namespace
+
+std::shared_ptr<SchedulerMetrics> SchedulerMetricsRegistry::create_scheduler_metrics(int32 sched_id) {
+  auto result = std::make_shared<SchedulerMetrics>();
+  result->sched_id = sched_id;
+
+  auto &registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  td::remove_if(registry.schedulers, [](auto &weak_metrics) { return weak_metrics.expired(); });
+  registry.schedulers.push_back(result);
+  return result;
+}
+
+Slice SchedulerMetricsRegistry::get_actor_kind(Slice actor_name) {
+  size_t size = 0;
+  while (size < actor_name.size() && (is_alpha(actor_name[size]) || actor_name[size] == '_')) {
+    size++;
+  }
+  if (size == 0) {
+    return Slice("Unnamed");
+  }
+  return actor_name.substr(0, size);
+}
+
+ActorMetrics *SchedulerMetricsRegistry::get_actor_metrics(Slice actor_name) {
+  auto name = get_actor_kind(actor_name).str();
+
+  auto &registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  if (registry.actors.size() >= MAX_ACTOR_METRICS_COUNT && registry.actors.count(name) == 0) {
+    name = "Other";
+  }
+  auto &metrics = registry.actors[name];
+  if (metrics == nullptr) {
+    metrics = make_unique<ActorMetrics>();
+    metrics->name = std::move(name);
+  }
+  return metrics.get();
+}
+
+string SchedulerMetricsRegistry::export_prometheus() {
+  std::map<int32, SchedulerMetrics> schedulers;
+  std::map<Slice, const ActorMetrics *> actors;
+  auto &registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (auto &weak_metrics : registry.schedulers) {
+    auto metrics = weak_metrics.lock();
+    if (metrics == nullptr) {
+      continue;
+    }
+    auto &total = schedulers[metrics->sched_id];
+    SchedulerMetrics::inc(total.event_count, metrics->event_count.load(std::memory_order_relaxed));
+    SchedulerMetrics::inc(total.inbound_event_count, metrics->inbound_event_count.load(std::memory_order_relaxed));
+    SchedulerMetrics::inc(total.actor_count, metrics->actor_count.load(std::memory_order_relaxed));
+    SchedulerMetrics::inc(total.timeout_queue_size, metrics->timeout_queue_size.load(std::memory_order_relaxed));
+    total.event_duration.merge_from(metrics->event_duration);
+    total.mailbox_size.merge_from(metrics->mailbox_size);
+    total.poll_duration.merge_from(metrics->poll_duration);
+  }
+  for (auto &it : registry.actors) {
+    actors.emplace(it.second->name, it.second.get());
+  }
+
+  auto get_labels = [](int32 sched_id) {
+    return PSTRING() << "scheduler=\"" << sched_id << '"';
+  };
+  auto for_each_scheduler = [&](auto &&f) {
+    for (auto &it : schedulers) {
+      f(get_labels(it.first), it.second);
+    }
+  };
+
+  StringBuilder sb(MutableSlice(), true);
+  PrometheusWriter writer(sb);
+  writer.header("td_scheduler_events_total", "counter", "Number of events processed by the scheduler.");
+  for_each_scheduler([&](Slice labels, const SchedulerMetrics &metrics) {
+    writer.value("td_scheduler_events_total", labels, metrics.event_count.load(std::memory_order_relaxed));
+  });
+  writer.header("td_scheduler_inbound_events_total", "counter", "Number of events received from other schedulers.");
+  for_each_scheduler([&](Slice labels, const SchedulerMetrics &metrics) {
+    writer.value("td_scheduler_inbound_events_total", labels,
+                 metrics.inbound_event_count.load(std::memory_order_relaxed));
+  });
+  writer.header("td_scheduler_actors", "gauge", "Number of actors on the scheduler.");
+  for_each_scheduler([&](Slice labels, const SchedulerMetrics &metrics) {
+    writer.value("td_scheduler_actors", labels, metrics.actor_count.load(std::memory_order_relaxed));
+  });
+  writer.header("td_scheduler_timeout_queue_size", "gauge", "Number of actors with a timeout set.");
+  for_each_scheduler([&](Slice labels, const SchedulerMetrics &metrics) {
+    writer.value("td_scheduler_timeout_queue_size", labels, metrics.timeout_queue_size.load(std::memory_order_relaxed));
+  });
+  uint32 sample_rate = SchedulerMetrics::EVENT_SAMPLE_RATE;
+  auto sampled = PSTRING() << "every " << sample_rate << "th event is measured.";
+  writer.header("td_scheduler_event_duration_seconds", "histogram", "Time spent processing an event; " + sampled);
+  for_each_scheduler([&](Slice labels, const SchedulerMetrics &metrics) {
+    writer.histogram("td_scheduler_event_duration_seconds", labels, metrics.event_duration, true);
+  });
+  writer.header("td_scheduler_mailbox_size", "histogram",
+                "Number of events in the mailbox of the actor processing an event; " + sampled);
+  for_each_scheduler([&](Slice labels, const SchedulerMetrics &metrics) {
+    writer.histogram("td_scheduler_mailbox_size", labels, metrics.mailbox_size, false);
+  });
+  writer.header("td_scheduler_poll_duration_seconds", "histogram", "Time spent waiting for network events.");
+  for_each_scheduler([&](Slice labels, const SchedulerMetrics &metrics) {
+    writer.histogram("td_scheduler_poll_duration_seconds", labels, metrics.poll_duration, true);
+  });
+  writer.header("td_actor_event_duration_seconds", "histogram", "Time spent processing an event by actors; " + sampled);
+  for (auto &it : actors) {
+    writer.histogram("td_actor_event_duration_seconds", PSLICE() << "actor=\"" << it.first << '"',
+                     it.second->event_duration, true);
+  }
+  return sb.as_cslice().str();
+}
+
+}  // namespace td
@@ -0,0 +1,66 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/HdrHistogram.h"
+#include "td/utils/Slice.h"
+
+#include <atomic>
+#include <memory>
+
+namespace td {
+
+// Metrics of one scheduler. They are updated only by the scheduler's thread, but can be read from any thread.
+// Durations are measured in nanoseconds. To keep the overhead negligible, only every EVENT_SAMPLE_RATE-th event
+// is measured, so event counters are updated in batches of EVENT_SAMPLE_RATE events.
+struct SchedulerMetrics {
+  static constexpr uint32 EVENT_SAMPLE_RATE = 64;
+
+  int32 sched_id = 0;
+  std::atomic<uint64> event_count{0};
+  std::atomic<uint64> inbound_event_count{0};  // events received from other schedulers
+  std::atomic<uint64> actor_count{0};
+  std::atomic<uint64> timeout_queue_size{0};
+  HdrHistogram event_duration;  // for sampled events
+  HdrHistogram mailbox_size;    // number of events in the actor's mailbox for sampled events
+  HdrHistogram poll_duration;
+
+  static void inc(std::atomic<uint64> &counter, uint64 diff) {
+    counter.store(counter.load(std::memory_order_relaxed) + diff, std::memory_order_relaxed);
+  }
+
+  static void set(std::atomic<uint64> &gauge, uint64 value) {
+    gauge.store(value, std::memory_order_relaxed);
+  }
+};
+
+// Metrics of all actors with the same name, which can be updated by different schedulers simultaneously.
+// Actors are grouped by the longest name prefix consisting of latin letters and underscores, so identifiers in actor
+// names don't create new metrics.
+struct ActorMetrics {
+  string name;
+  HdrHistogram event_duration;  // for sampled events
+};
+
+class SchedulerMetricsRegistry {
+ public:
+  // the metrics are exported while the returned object is alive
+  static std::shared_ptr<SchedulerMetrics> create_scheduler_metrics(int32 sched_id);
+
+  // returns the name of the group of actors with the given name
+  static Slice get_actor_kind(Slice actor_name);
+
+  // the returned object is never destroyed; the call takes a global lock, so schedulers cache the result
+  static ActorMetrics *get_actor_metrics(Slice actor_name);
+
+  // returns metrics of all alive schedulers and all actors in the Prometheus text exposition format;
+  // metrics of schedulers with the same identifier are summed up
+  static string export_prometheus();
+};
+
+}  // namespace td
@@ -23,6 +23,7 @@
 namespace td {
 
 class Actor;
+struct ActorMetrics;
 
 class ActorContext {
  public:
@@ -63,7 +64,7 @@ class ActorInfo
   ActorInfo &operator=(const ActorInfo &) = delete;
 
   void init(int32 sched_id, Slice name, ObjectPool<ActorInfo>::OwnerPtr &&this_ptr, Actor *actor_ptr, Deleter deleter,
-            bool is_lite);
+            bool is_lite, ActorMetrics *metrics);
   void on_actor_moved(Actor *actor_new_ptr);
 
   template <class ActorT>
@@ -88,7 +89,10 @@ class ActorInfo
   std::shared_ptr<ActorContext> set_context(std::shared_ptr<ActorContext> context);
   ActorContext *get_context();
   const ActorContext *get_context() const;
+  // returns the full name of the actor in debug builds; in release builds only the name of its metrics group is known,
+  // which is the name without trailing identifiers, and it is empty for lite actors
   CSlice get_name() const;
+  ActorMetrics *get_metrics() const;
 
   HeapNode *get_heap_node();
   const HeapNode *get_heap_node() const;
@@ -119,6 +123,7 @@ class ActorInfo
 
   std::atomic<int32> sched_id_{0};
   Actor *actor_ = nullptr;
+  ActorMetrics *metrics_ = nullptr;
 
 #ifdef TD_DEBUG
   string name_;
@@ -9,6 +9,7 @@
 #include "td/actor/impl/Actor-decl.h"
 #include "td/actor/impl/ActorInfo-decl.h"
 #include "td/actor/impl/Scheduler-decl.h"
+#include "td/actor/SchedulerMetrics.h"
 
 #include "td/utils/common.h"
 #include "td/utils/format.h"
@@ -32,11 +33,12 @@ inline StringBuilder &operator<<(StringBuilder &sb, const ActorInfo &info) {
 }
 
 inline void ActorInfo::init(int32 sched_id, Slice name, ObjectPool<ActorInfo>::OwnerPtr &&this_ptr, Actor *actor_ptr,
-                            Deleter deleter, bool is_lite) {
+                            Deleter deleter, bool is_lite, ActorMetrics *metrics) {
   CHECK(!is_running());
   CHECK(!is_migrating());
   sched_id_.store(sched_id, std::memory_order_relaxed);
   actor_ = actor_ptr;
+  metrics_ = metrics;
 
   if (!is_lite) {
     context_ = Scheduler::context()->this_ptr_.lock();
@@ -168,10 +170,14 @@ inline CSlice ActorInfo::get_name() const {
 #ifdef TD_DEBUG
   return name_;
 #else
-  return "";
+  return metrics_ == nullptr ? CSlice() : CSlice(metrics_->name);
 #endif
 }
 
+inline ActorMetrics *ActorInfo::get_metrics() const {
+  return metrics_;
+}
+
 inline void ActorInfo::start_run() {
   VLOG(actor) << "Start run actor: " << *this;
   LOG_CHECK(!is_running_) << "Recursive call of actor " << tag("name", get_name());
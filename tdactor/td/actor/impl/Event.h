@@ -10,6 +10,7 @@
 #include "td/utils/common.h"
 #include "td/utils/logging.h"
 #include "td/utils/StringBuilder.h"
+#include "td/utils/TraceRecorder.h"
 
 #include <type_traits>
 #include <utility>
@@ -110,6 +111,7 @@ class Event {
   enum class Type { NoType, Start, Stop, Yield, Timeout, Hangup, Raw, Custom };
   Type type;
   uint64 link_token = 0;
+  uint64 trace_id = TraceRecorder::get_trace_id();  // trace of the request, which caused the event, if still active
   union Raw {
     void *ptr;
     CustomEvent *custom_event;
@@ -166,13 +168,14 @@ class Event {
   }
   Event(const Event &other) = delete;
   Event &operator=(const Event &) = delete;
-  Event(Event &&other) : type(other.type), link_token(other.link_token), data(other.data) {
+  Event(Event &&other) : type(other.type), link_token(other.link_token), trace_id(other.trace_id), data(other.data) {
     other.type = Type::NoType;
   }
   Event &operator=(Event &&other) {
     destroy();
     type = other.type;
     link_token = other.link_token;
+    trace_id = other.trace_id;
     data = other.data;
     other.type = Type::NoType;
     return *this;
@@ -184,6 +187,7 @@ class Event {
   Event clone() const {
     Event res;
     res.type = type;
+    res.trace_id = trace_id;
     if (type == Type::Custom) {
       res.data.custom_event = data.custom_event->clone();
     } else {
@@ -9,6 +9,7 @@
 #include "td/actor/impl/Actor-decl.h"
 #include "td/actor/impl/ActorId-decl.h"
 #include "td/actor/impl/EventFull-decl.h"
+#include "td/actor/SchedulerMetrics.h"
 
 #include "td/utils/Closure.h"
 #include "td/utils/Heap.h"
@@ -29,6 +30,7 @@
 #include <map>
 #include <memory>
 #include <type_traits>
+#include <unordered_map>
 #include <utility>
 
 namespace td {
@@ -116,6 +118,10 @@ class Scheduler {
   static void unsubscribe(PollableFdRef fd);
   static void unsubscribe_before_close(PollableFdRef fd);
 
+  // max_events bounds the number of ready file descriptors handled per poll call,
+  // busy_poll_time is the time in seconds to poll without blocking before a blocking wait; epoll only
+  void set_poll_options(size_t max_events, double busy_poll_time);
+
   void yield_actor(Actor *actor);
   void stop_actor(Actor *actor);
   void do_stop_actor(Actor *actor);
@@ -163,6 +169,8 @@ class Scheduler {
   friend class ServiceActor;
 
   void do_event(ActorInfo *actor, Event &&event);
+  void do_sampled_event(ActorInfo *actor, Event &&event);
+  void do_event_impl(ActorInfo *actor, Event &&event);
 
   void enter_actor(ActorInfo *actor_info);
   void exit_actor(ActorInfo *actor_info);
@@ -201,6 +209,8 @@ class Scheduler {
   ActorOwn<ActorT> register_actor_impl(Slice name, ActorT *actor_ptr, Actor::Deleter deleter, int32 sched_id);
   void destroy_actor(ActorInfo *actor_info);
 
+  ActorMetrics *get_actor_metrics(Slice actor_name);
+
   static TD_THREAD_LOCAL Scheduler *scheduler_;
   static TD_THREAD_LOCAL ActorContext *context_;
 
@@ -229,6 +239,10 @@ class Scheduler {
 
   std::shared_ptr<ActorContext> save_context_;
 
+  std::shared_ptr<SchedulerMetrics> metrics_;
+  std::unordered_map<Slice, ActorMetrics *, SliceHash> actor_metrics_;  // actor kind -> metrics of the kind
+  uint32 sample_countdown_ = SchedulerMetrics::EVENT_SAMPLE_RATE;
+
   struct EventContext {
     int32 dest_sched_id{0};
     enum Flags { Stop = 1, Migrate = 2 };
@@ -11,15 +11,18 @@
 #include "td/actor/impl/ActorInfo.h"
 #include "td/actor/impl/Event.h"
 #include "td/actor/impl/EventFull.h"
+#include "td/actor/SchedulerMetrics.h"
 
 #include "td/utils/common.h"
 #include "td/utils/format.h"
 #include "td/utils/List.h"
 #include "td/utils/logging.h"
 #include "td/utils/ObjectPool.h"
+#include "td/utils/port/Clocks.h"
 #include "td/utils/port/thread_local.h"
 #include "td/utils/ScopeGuard.h"
 #include "td/utils/Time.h"
+#include "td/utils/TraceRecorder.h"
 
 #include <functional>
 #include <iterator>
@@ -74,6 +77,7 @@ void Scheduler::ServiceActor::loop() {
   if (ready_n == 0) {
     return;
   }
+  SchedulerMetrics::inc(Scheduler::instance()->metrics_->inbound_event_count, ready_n);
   while (ready_n-- > 0) {
     EventFull event = queue->reader_get_unsafe();
     if (event.actor_id().empty()) {
@@ -218,6 +222,7 @@ void Scheduler::init(int32 id, std::vector<std::shared_ptr<MpscPollableQueue<Eve
   outbound_queues_ = std::move(outbound);
   sched_id_ = id;
   sched_n_ = static_cast<int32>(outbound_queues_.size());
+  metrics_ = SchedulerMetricsRegistry::create_scheduler_metrics(sched_id_);
   service_actor_.set_queue(inbound_queue_);
   register_actor("ServiceActor", &service_actor_).release();
 }
@@ -254,7 +259,49 @@ void Scheduler::clear() {
   }
 }
 
+ActorMetrics *Scheduler::get_actor_metrics(Slice actor_name) {
+  auto actor_kind = SchedulerMetricsRegistry::get_actor_kind(actor_name);
+  auto it = actor_metrics_.find(actor_kind);
+  if (it != actor_metrics_.end()) {
+    return it->second;
+  }
+  auto metrics = SchedulerMetricsRegistry::get_actor_metrics(actor_kind);
+  if (metrics->name == actor_kind) {
+    // kinds beyond the limit share the metrics "Other" and aren't cached to keep the cache bounded
+    actor_metrics_.emplace(metrics->name, metrics);
+  }
+  return metrics;
+}
+
 void Scheduler::do_event(ActorInfo *actor_info, Event &&event) {
+  if (unlikely(--sample_countdown_ == 0)) {
+    return do_sampled_event(actor_info, std::move(event));
+  }
+  if (unlikely(event.trace_id != 0)) {
+    TraceIdGuard trace_id_guard(event.trace_id);
+    TraceSpan trace_span(actor_info->get_name());
+    return do_event_impl(actor_info, std::move(event));
+  }
+  do_event_impl(actor_info, std::move(event));
+}
+
+void Scheduler::do_sampled_event(ActorInfo *actor_info, Event &&event) {
+  sample_countdown_ = SchedulerMetrics::EVENT_SAMPLE_RATE + 1;  // the nested do_event will decrement it
+  SchedulerMetrics::inc(metrics_->event_count, SchedulerMetrics::EVENT_SAMPLE_RATE);
+  metrics_->mailbox_size.add(actor_info->mailbox_.size());
+  auto actor_metrics = actor_info->get_metrics();  // the actor can be destroyed during the event
+
+  auto start_time = Clocks::monotonic();
+  do_event(actor_info, std::move(event));
+  auto duration = static_cast<uint64>((Clocks::monotonic() - start_time) * 1e9);
+
+  metrics_->event_duration.add(duration);
+  if (actor_metrics != nullptr) {
+    actor_metrics->event_duration.add_concurrent(duration);
+  }
+}
+
+void Scheduler::do_event_impl(ActorInfo *actor_info, Event &&event) {
   event_context_ptr_->link_token = event.link_token;
   auto actor = actor_info->get_actor_unsafe();
   VLOG(actor) << *actor_info << ' ' << event;
@@ -427,9 +474,19 @@ void Scheduler::set_actor_timeout_at(ActorInfo *actor_info, double timeout_at) {
   }
 }
 
+void Scheduler::set_poll_options(size_t max_events, double busy_poll_time) {
+#if TD_POLL_EPOLL
+  poll_.set_max_events(max_events);
+  poll_.set_busy_poll_time(busy_poll_time);
+#endif
+}
+
 void Scheduler::run_poll(Timestamp timeout) {
   // we can't wait for less than 1ms
   int timeout_ms = static_cast<int32>(td::max(timeout.in(), 0.0) * 1000 + 1);
+  SchedulerMetrics::set(metrics_->actor_count, static_cast<uint64>(actor_count_));
+  SchedulerMetrics::set(metrics_->timeout_queue_size, timeout_queue_.size());
+  auto start_time = Clocks::monotonic();
 #if TD_PORT_WINDOWS
   CHECK(inbound_queue_);
   inbound_queue_->reader_get_event_fd().wait(timeout_ms);
@@ -437,6 +494,7 @@ void Scheduler::run_poll(Timestamp timeout) {
 #elif TD_PORT_POSIX
   poll_.run(timeout_ms);
 #endif
+  metrics_->poll_duration.add(static_cast<uint64>((Clocks::monotonic() - start_time) * 1e9));
 }
 
 void Scheduler::run_mailbox() {
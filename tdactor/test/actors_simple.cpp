@@ -9,6 +9,7 @@
 #include "td/actor/actor.h"
 #include "td/actor/MultiPromise.h"
 #include "td/actor/PromiseFuture.h"
+#include "td/actor/SchedulerMetrics.h"
 #include "td/actor/SleepActor.h"
 #include "td/actor/Timeout.h"
 
@@ -632,6 +633,41 @@ TEST(Actors, always_wait_for_mailbox) {
   scheduler.finish();
 }
 
+class MetricsActor : public Actor {
+ public:
+  void start_up() override {
+    send_closure(actor_id(this), &MetricsActor::ping);
+  }
+
+  void ping() {
+    if (--cnt_ == 0) {
+      Scheduler::instance()->finish();
+      return stop();
+    }
+    send_closure(actor_id(this), &MetricsActor::ping);
+  }
+
+ private:
+  int cnt_ = 1000;
+};
+
+TEST(Actors, metrics) {
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+  ConcurrentScheduler scheduler;
+  scheduler.init(0);
+  scheduler.create_actor_unsafe<MetricsActor>(0, "MetricsActor#1").release();
+  scheduler.start();
+  while (scheduler.run_main(10)) {
+  }
+
+  auto metrics = SchedulerMetricsRegistry::export_prometheus();
+  ASSERT_TRUE(metrics.find("td_scheduler_events_total{scheduler=\"0\"} ") != string::npos);
+  ASSERT_TRUE(metrics.find("td_scheduler_event_duration_seconds_count{scheduler=\"0\"} ") != string::npos);
+  ASSERT_TRUE(metrics.find("td_actor_event_duration_seconds_count{actor=\"MetricsActor\"} ") != string::npos);
+  ASSERT_TRUE(metrics.find("MetricsActor#1") == string::npos);
+  scheduler.finish();
+}
+
 #if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
 TEST(Actors, send_from_other_threads) {
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
@@ -11,7 +11,8 @@
 
 namespace td {
 
-TcpListener::TcpListener(int port, ActorShared<Callback> callback) : port_(port), callback_(std::move(callback)) {
+TcpListener::TcpListener(int port, ActorShared<Callback> callback, Slice server_address)
+    : port_(port), server_address_(server_address.str()), callback_(std::move(callback)) {
 }
 
 void TcpListener::hangup() {
@@ -19,7 +20,7 @@ void TcpListener::hangup() {
 }
 
 void TcpListener::start_up() {
-  auto r_socket = ServerSocketFd::open(port_);
+  auto r_socket = ServerSocketFd::open(port_, server_address_);
   if (r_socket.is_error()) {
     LOG(ERROR) << "Can't open server socket: " << r_socket.error();
     set_timeout_in(5);
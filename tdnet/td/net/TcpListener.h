@@ -10,6 +10,7 @@
 
 #include "td/utils/port/ServerSocketFd.h"
 #include "td/utils/port/SocketFd.h"
+#include "td/utils/Slice.h"
 
 namespace td {
 
@@ -20,11 +21,14 @@ class TcpListener final : public Actor {
     virtual void accept(SocketFd fd) = 0;
   };
 
-  TcpListener(int port, ActorShared<Callback> callback);
+  // server sockets are opened with SO_REUSEPORT, so a listener can be created on each scheduler for the same port
+  // and the kernel will balance incoming connections between them
+  TcpListener(int port, ActorShared<Callback> callback, Slice server_address = Slice("0.0.0.0"));
   void hangup() override;
 
  private:
   int port_;
+  string server_address_;
   ServerSocketFd server_fd_;
   ActorShared<Callback> callback_;
   void start_up() override;
@@ -0,0 +1,280 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/AsyncFileLog.h"
+
+#include "td/utils/common.h"
+#include "td/utils/FileLog.h"
+#include "td/utils/logging.h"
+#include "td/utils/port/thread.h"
+#include "td/utils/port/thread_local.h"
+#include "td/utils/Slice.h"
+#include "td/utils/SpinLock.h"
+#include "td/utils/StringBuilder.h"
+#include "td/utils/Time.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+namespace td {
+
+#if !TD_THREAD_UNSUPPORTED
+namespace detail {
+class AsyncFileLog : public LogInterface {
+ public:
+  AsyncFileLog() = default;
+  AsyncFileLog(const AsyncFileLog &other) = delete;
+  AsyncFileLog &operator=(const AsyncFileLog &other) = delete;
+  AsyncFileLog(AsyncFileLog &&other) = delete;
+  AsyncFileLog &operator=(AsyncFileLog &&other) = delete;
+  ~AsyncFileLog() override {
+    is_closing_.store(true, std::memory_order_release);
+    wake_up_writer();
+    writer_thread_.join();
+  }
+
+  Status init(string path, int64 rotate_threshold, bool redirect_stderr) {
+    TRY_STATUS(file_log_.init(std::move(path), rotate_threshold, redirect_stderr));
+    for (size_t i = 0; i < buffers_.size(); i++) {
+      buffers_[i].id = i;
+    }
+    writer_thread_ = td::thread([this] { run_writer(); });
+    return Status::OK();
+  }
+
+  vector<string> get_file_paths() override {
+    return file_log_.get_file_paths();
+  }
+
+  void append(CSlice cslice, int log_level) override {
+    bool is_fatal = log_level == VERBOSITY_NAME(FATAL);
+    auto *buffer = get_current_buffer();
+    auto write_pos = push_record(buffer, cslice, false, is_fatal);
+    if (write_pos != 0) {
+      wake_up_writer();
+    }
+
+    if (is_fatal) {
+      // wait until the message is written to the file
+      auto end_time = Time::now() + FATAL_ERROR_FLUSH_TIMEOUT;
+      while (buffer->read_pos.load(std::memory_order_acquire) < write_pos && Time::now() < end_time) {
+        td::this_thread::yield();
+      }
+      process_fatal_error(cslice);
+    }
+  }
+
+  // the message is formatted by the writer thread
+  void append_deferred(Slice record, int log_level) override {
+    if (log_level == VERBOSITY_NAME(FATAL)) {
+      return LogInterface::append_deferred(record, log_level);
+    }
+    if (push_record(get_current_buffer(), record, true, false) != 0) {
+      wake_up_writer();
+    }
+  }
+
+  void rotate() override {
+    file_log_.lazy_rotate();
+  }
+
+ private:
+  static constexpr size_t MAX_THREAD_ID = 128;
+  static constexpr uint64 BUFFER_SIZE = 1 << 18;
+  static constexpr size_t MAX_MESSAGE_SIZE = 1 << 16;
+  static constexpr size_t MAX_BATCH_SIZE = 1 << 20;
+  static constexpr double FATAL_ERROR_FLUSH_TIMEOUT = 1.0;
+  static constexpr uint32 DEFERRED_RECORD_FLAG = static_cast<uint32>(1) << 31;
+
+  struct Buffer {
+    // positions only grow; a record consists of 4-byte message size and the message itself;
+    // the highest bit of the size is set if the message must be formatted using format_deferred_log_record
+    std::atomic<uint64> write_pos{0};
+    std::atomic<uint64> read_pos{0};
+    std::atomic<uint64> dropped_count{0};
+    std::atomic<bool> is_inited{false};
+    std::unique_ptr<char[]> data;
+    SpinLock write_lock;
+    size_t id;
+  };
+
+  FileLog file_log_;  // used only by the writer thread, except for lazy_rotate
+  std::array<Buffer, MAX_THREAD_ID> buffers_;
+  std::mutex init_mutex_;
+  std::atomic<bool> is_closing_{false};
+  // the writer thread sleeps only if all buffers are empty; it is woken up by a new message or by the destructor
+  std::atomic<bool> is_writer_asleep_{false};
+  std::mutex wakeup_mutex_;
+  std::condition_variable wakeup_condition_variable_;
+  bool wakeup_flag_ = false;  // guarded by wakeup_mutex_
+  td::thread writer_thread_;
+  string deferred_record_;  // used only by the writer thread
+  StringBuilder deferred_message_;
+
+  Buffer *get_current_buffer() {
+    auto *buffer = &buffers_[get_thread_id()];
+    if (!buffer->is_inited.load(std::memory_order_acquire)) {
+      std::unique_lock<std::mutex> lock(init_mutex_);
+      if (!buffer->is_inited.load(std::memory_order_relaxed)) {
+        buffer->data = std::make_unique<char[]>(static_cast<size_t>(BUFFER_SIZE));
+        buffer->is_inited.store(true, std::memory_order_release);
+      }
+    }
+    return buffer;
+  }
+
+  // returns the position after the record, or 0 if the record was dropped
+  uint64 push_record(Buffer *buffer, Slice message, bool is_deferred, bool wait_for_space) {
+    message.truncate(MAX_MESSAGE_SIZE);
+    auto message_size = static_cast<uint32>(message.size());
+    auto record_size = sizeof(message_size) + message_size;
+    auto stored_size = is_deferred ? message_size | DEFERRED_RECORD_FLAG : message_size;
+
+    // the lock is never contended, unless threads share an identifier
+    auto lock = buffer->write_lock.lock();
+    auto write_pos = buffer->write_pos.load(std::memory_order_relaxed);
+    while (write_pos + record_size - buffer->read_pos.load(std::memory_order_acquire) > BUFFER_SIZE) {
+      if (!wait_for_space) {
+        buffer->dropped_count.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+      }
+      // the fatal error message must not be lost
+      td::this_thread::yield();
+    }
+    write(buffer, write_pos, &stored_size, sizeof(stored_size));
+    write(buffer, write_pos + sizeof(stored_size), message.data(), message_size);
+    write_pos += record_size;
+    buffer->write_pos.store(write_pos, std::memory_order_release);
+    return write_pos;
+  }
+
+  static void write(Buffer *buffer, uint64 pos, const void *data, size_t size) {
+    auto offset = static_cast<size_t>(pos & (BUFFER_SIZE - 1));
+    auto first_size = min(size, static_cast<size_t>(BUFFER_SIZE) - offset);
+    std::memcpy(buffer->data.get() + offset, data, first_size);
+    std::memcpy(buffer->data.get(), static_cast<const char *>(data) + first_size, size - first_size);
+  }
+
+  static void read(const Buffer *buffer, uint64 pos, void *data, size_t size) {
+    auto offset = static_cast<size_t>(pos & (BUFFER_SIZE - 1));
+    auto first_size = min(size, static_cast<size_t>(BUFFER_SIZE) - offset);
+    std::memcpy(data, buffer->data.get() + offset, first_size);
+    std::memcpy(static_cast<char *>(data) + first_size, buffer->data.get(), size - first_size);
+  }
+
+  void run_writer() {
+    string batch;
+    while (true) {
+      bool is_closing = is_closing_.load(std::memory_order_acquire);
+      bool have_messages = false;
+      for (auto &buffer : buffers_) {
+        if (buffer.is_inited.load(std::memory_order_acquire)) {
+          have_messages |= read_messages(&buffer, batch);
+        }
+      }
+      flush(batch);
+      if (!have_messages) {
+        if (is_closing) {
+          break;
+        }
+        wait_for_messages();
+      }
+    }
+  }
+
+  void wait_for_messages() {
+    std::unique_lock<std::mutex> lock(wakeup_mutex_);
+    is_writer_asleep_.store(true, std::memory_order_relaxed);
+    // pairs with the fence in wake_up_writer: either the writer sees the new message, or the message's author sees
+    // that the writer is asleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!has_unread_messages() && !is_closing_.load(std::memory_order_acquire)) {
+      wakeup_condition_variable_.wait(lock, [&] { return wakeup_flag_; });
+    }
+    wakeup_flag_ = false;
+    is_writer_asleep_.store(false, std::memory_order_relaxed);
+  }
+
+  void wake_up_writer() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!is_writer_asleep_.load(std::memory_order_relaxed)) {
+      return;
+    }
+    std::lock_guard<std::mutex> guard(wakeup_mutex_);
+    wakeup_flag_ = true;
+    wakeup_condition_variable_.notify_one();
+  }
+
+  bool has_unread_messages() const {
+    for (auto &buffer : buffers_) {
+      if (buffer.is_inited.load(std::memory_order_acquire) &&
+          buffer.write_pos.load(std::memory_order_acquire) != buffer.read_pos.load(std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool read_messages(Buffer *buffer, string &batch) {
+    auto read_pos = buffer->read_pos.load(std::memory_order_relaxed);
+    auto write_pos = buffer->write_pos.load(std::memory_order_acquire);
+    bool have_messages = read_pos != write_pos;
+    while (read_pos != write_pos) {
+      uint32 stored_size;
+      read(buffer, read_pos, &stored_size, sizeof(stored_size));
+      auto message_size = stored_size & ~DEFERRED_RECORD_FLAG;
+      if ((stored_size & DEFERRED_RECORD_FLAG) != 0) {
+        deferred_record_.resize(message_size);
+        read(buffer, read_pos + sizeof(stored_size), &deferred_record_[0], message_size);
+        deferred_message_.clear();
+        auto message = format_deferred_log_record(deferred_record_, deferred_message_);
+        batch.append(message.data(), message.size());
+      } else {
+        auto old_batch_size = batch.size();
+        batch.resize(old_batch_size + message_size);
+        read(buffer, read_pos + sizeof(stored_size), &batch[old_batch_size], message_size);
+      }
+      read_pos += sizeof(stored_size) + message_size;
+      if (batch.size() >= MAX_BATCH_SIZE) {
+        buffer->read_pos.store(read_pos, std::memory_order_release);
+        flush(batch);
+      }
+    }
+    buffer->read_pos.store(read_pos, std::memory_order_release);
+
+    auto dropped_count = buffer->dropped_count.exchange(0, std::memory_order_relaxed);
+    if (dropped_count != 0) {
+      batch += PSTRING() << "[AsyncFileLog] Dropped " << dropped_count << " log messages of thread " << buffer->id
+                         << ", because its buffer was full\n";
+    }
+    return have_messages;
+  }
+
+  void flush(string &batch) {
+    if (!batch.empty()) {
+      file_log_.append(batch, VERBOSITY_NAME(PLAIN));
+      batch.clear();
+    }
+  }
+};
+}  // namespace detail
+#endif
+
+Result<unique_ptr<LogInterface>> AsyncFileLog::create(string path, int64 rotate_threshold, bool redirect_stderr) {
+#if TD_THREAD_UNSUPPORTED
+  return Status::Error("Asynchronous log isn't supported without threads");
+#else
+  auto res = make_unique<detail::AsyncFileLog>();
+  TRY_STATUS(res->init(std::move(path), rotate_threshold, redirect_stderr));
+  return std::move(res);
+#endif
+}
+
+}  // namespace td
@@ -16,9 +16,33 @@
 #include "td/utils/Span.h"
 #include "td/utils/Status.h"
 
+#include <cstring>
 #include <limits>
+#include <type_traits>
+#include <utility>
 
 namespace td {
+
+namespace detail {
+// file descriptors supporting zero-copy sends provide Result<size_t> write_zero_copy(BufferSlice)
+template <class FdT, class = void>
+struct HasWriteZeroCopy : public std::false_type {};
+
+template <class FdT>
+struct HasWriteZeroCopy<FdT, decltype(void(std::declval<FdT &>().write_zero_copy(std::declval<BufferSlice>())))>
+    : public std::true_type {};
+
+template <class FdT>
+Result<size_t> buffered_fd_write_zero_copy(FdT &fd, BufferSlice slice, std::true_type) {
+  return fd.write_zero_copy(std::move(slice));
+}
+
+template <class FdT>
+Result<size_t> buffered_fd_write_zero_copy(FdT &fd, BufferSlice slice, std::false_type) {
+  return fd.write(slice.as_slice());
+}
+}  // namespace detail
+
 // just reads from given reader and writes to given writer
 template <class FdT>
 class BufferedFdBase : public FdT {
@@ -48,9 +72,31 @@ class BufferedFdBase : public FdT {
     write_ = write;
   }
 
+  static constexpr size_t MAX_WRITE_SLICES = 128;
+  static constexpr size_t MAX_COALESCED_SLICE_SIZE = 256;
+  static constexpr size_t COALESCE_BUFFER_SIZE = 4096;
+
+  // maximum number of IoSlices passed to a single writev call
+  void set_max_write_slices(size_t max_write_slices) {
+    CHECK(max_write_slices > 0);
+    max_write_slices_ = td::min(max_write_slices, MAX_WRITE_SLICES);
+  }
+
+  // buffer nodes of at least the given size are sent using FdT::write_zero_copy if the file descriptor supports it;
+  // 0 disables zero-copy sends
+  void set_zero_copy_threshold(size_t zero_copy_threshold) {
+    zero_copy_threshold_ = zero_copy_threshold;
+  }
+
  private:
   ChainBufferWriter *read_ = nullptr;
   ChainBufferReader *write_ = nullptr;
+  size_t max_write_slices_ = 20;
+  size_t zero_copy_threshold_ = 0;
+
+  bool is_zero_copy_slice(Slice slice) const {
+    return detail::HasWriteZeroCopy<FdT>::value && zero_copy_threshold_ != 0 && slice.size() >= zero_copy_threshold_;
+  }
 };
 
 template <class FdT>
@@ -92,6 +138,13 @@ class BufferedFd : public BufferedFdBase<FdT> {
 // IMPLEMENTATION
 
 /*** BufferedFd ***/
+template <class FdT>
+constexpr size_t BufferedFdBase<FdT>::MAX_WRITE_SLICES;
+template <class FdT>
+constexpr size_t BufferedFdBase<FdT>::MAX_COALESCED_SLICE_SIZE;
+template <class FdT>
+constexpr size_t BufferedFdBase<FdT>::COALESCE_BUFFER_SIZE;
+
 template <class FdT>
 BufferedFdBase<FdT>::BufferedFdBase(FdT &&fd_) : FdT(std::move(fd_)) {
 }
@@ -117,20 +170,56 @@ Result<size_t> BufferedFdBase<FdT>::flush_write() {
   write_->sync_with_writer();
   size_t result = 0;
   while (!write_->empty() && ::td::can_write_local(*this)) {
-    constexpr size_t BUF_SIZE = 20;
-    IoSlice buf[BUF_SIZE];
+    if (is_zero_copy_slice(write_->prepare_read())) {
+      auto it = write_->clone();
+      TRY_RESULT(x, detail::buffered_fd_write_zero_copy(static_cast<FdT &>(*this),
+                                                        it.read_as_buffer_slice(write_->prepare_read().size()),
+                                                        detail::HasWriteZeroCopy<FdT>()));
+      write_->advance(x);
+      result += x;
+      continue;
+    }
+
+    Slice buf[MAX_WRITE_SLICES];
+    // adjacent tiny buffer nodes are copied together to occupy only one slice
+    char coalesce_buf[COALESCE_BUFFER_SIZE];
+    size_t coalesce_buf_size = 0;
+    bool is_last_coalesced = false;
 
     auto it = write_->clone();
-    size_t buf_i;
-    for (buf_i = 0; buf_i < BUF_SIZE; buf_i++) {
+    size_t buf_i = 0;
+    while (buf_i < max_write_slices_) {
       Slice slice = it.prepare_read();
-      if (slice.empty()) {
+      if (slice.empty() || is_zero_copy_slice(slice)) {
         break;
       }
-      buf[buf_i] = as_io_slice(slice);
       it.confirm_read(slice.size());
+
+      if (slice.size() <= MAX_COALESCED_SLICE_SIZE && buf_i != 0 &&
+          (is_last_coalesced || buf[buf_i - 1].size() <= MAX_COALESCED_SLICE_SIZE)) {
+        auto &last = buf[buf_i - 1];
+        if (!is_last_coalesced && coalesce_buf_size + last.size() + slice.size() <= COALESCE_BUFFER_SIZE) {
+          std::memcpy(coalesce_buf + coalesce_buf_size, last.data(), last.size());
+          last = Slice(coalesce_buf + coalesce_buf_size, last.size());
+          coalesce_buf_size += last.size();
+          is_last_coalesced = true;
+        }
+        if (is_last_coalesced && coalesce_buf_size + slice.size() <= COALESCE_BUFFER_SIZE) {
+          std::memcpy(coalesce_buf + coalesce_buf_size, slice.data(), slice.size());
+          coalesce_buf_size += slice.size();
+          last = Slice(last.data(), last.size() + slice.size());
+          continue;
+        }
+      }
+      buf[buf_i++] = slice;
+      is_last_coalesced = false;
+    }
+
+    IoSlice io_buf[MAX_WRITE_SLICES];
+    for (size_t i = 0; i < buf_i; i++) {
+      io_buf[i] = as_io_slice(buf[i]);
     }
-    TRY_RESULT(x, FdT::writev(Span<IoSlice>(buf, buf_i)));
+    TRY_RESULT(x, FdT::writev(Span<IoSlice>(io_buf, buf_i)));
     write_->advance(x);
     result += x;
   }
@@ -0,0 +1,115 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/bits.h"
+#include "td/utils/common.h"
+
+#include <array>
+#include <atomic>
+
+namespace td {
+
+// Histogram of non-negative integer values like in HdrHistogram: every power of two is split into SUB_BUCKET_COUNT
+// linear sub-buckets, so a value is known with relative error below 1 / SUB_BUCKET_COUNT.
+// The histogram is updated and read without locks, so it can be exported while it is being updated.
+class HdrHistogram {
+ public:
+  static constexpr int32 SUB_BUCKET_BITS = 3;
+  static constexpr uint64 SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+  static constexpr int32 MAX_VALUE_BITS = 40;  // greater values are counted as the maximum value
+  static constexpr size_t BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+  // must not be called concurrently with other add calls
+  void add(uint64 value) {
+    auto &bucket = buckets_[get_bucket(value)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    sum_.store(sum_.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+  }
+
+  // can be called from different threads simultaneously
+  void add_concurrent(uint64 value) {
+    buckets_[get_bucket(value)].fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  uint64 get_count() const {
+    uint64 result = 0;
+    for (auto &bucket : buckets_) {
+      result += bucket.load(std::memory_order_relaxed);
+    }
+    return result;
+  }
+
+  uint64 get_sum() const {
+    return sum_.load(std::memory_order_relaxed);
+  }
+
+  // calls f(max_value, count) for every non-empty bucket in increasing order
+  template <class F>
+  void for_each_bucket(F &&f) const {
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+      auto count = buckets_[i].load(std::memory_order_relaxed);
+      if (count != 0) {
+        f(get_bucket_max_value(i), count);
+      }
+    }
+  }
+
+  // returns an upper bound for the value at the given quantile, 0 for an empty histogram
+  uint64 get_quantile(double quantile) const {
+    auto total_count = get_count();
+    if (total_count == 0) {
+      return 0;
+    }
+    auto rank = static_cast<uint64>(quantile * static_cast<double>(total_count - 1)) + 1;
+    uint64 result = 0;
+    uint64 count = 0;
+    for_each_bucket([&](uint64 max_value, uint64 bucket_count) {
+      if (count < rank) {
+        count += bucket_count;
+        result = max_value;
+      }
+    });
+    return result;
+  }
+
+  // merges values from another histogram, which can be updated simultaneously
+  void merge_from(const HdrHistogram &other) {
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+      buckets_[i].fetch_add(other.buckets_[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    sum_.fetch_add(other.get_sum(), std::memory_order_relaxed);
+  }
+
+  static size_t get_bucket(uint64 value) {
+    if (value < SUB_BUCKET_COUNT) {
+      return static_cast<size_t>(value);
+    }
+    auto bits = 64 - count_leading_zeroes64(value);
+    if (bits > MAX_VALUE_BITS) {
+      return BUCKET_COUNT - 1;
+    }
+    auto shift = bits - 1 - SUB_BUCKET_BITS;
+    return static_cast<size_t>((shift + 1) * SUB_BUCKET_COUNT + ((value >> shift) - SUB_BUCKET_COUNT));
+  }
+
+  static uint64 get_bucket_max_value(size_t bucket) {
+    if (bucket < SUB_BUCKET_COUNT) {
+      return bucket;
+    }
+    auto shift = static_cast<int32>(bucket / SUB_BUCKET_COUNT) - 1;
+    auto min_value = (SUB_BUCKET_COUNT + bucket % SUB_BUCKET_COUNT) << shift;
+    return min_value + ((static_cast<uint64>(1) << shift) - 1);
+  }
+
+ private:
+  std::array<std::atomic<uint64>, BUCKET_COUNT> buckets_{};
+  std::atomic<uint64> sum_{0};
+};
+
+}  // namespace td
@@ -66,22 +66,137 @@ vector<string> Hints::get_words(Slice name, bool is_search) {
   return fix_words(std::move(words));
 }
 
-void Hints::add_word(const string &word, KeyT key, std::map<string, vector<KeyT>> &word_to_keys) {
-  vector<KeyT> &keys = word_to_keys[word];
-  CHECK(!td::contains(keys, key));
-  keys.push_back(key);
+namespace {
+
+void append_varint(string &data, uint64 value) {
+  while (value >= 0x80) {
+    data += static_cast<char>((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  data += static_cast<char>(value);
 }
 
-void Hints::delete_word(const string &word, KeyT key, std::map<string, vector<KeyT>> &word_to_keys) {
-  vector<KeyT> &keys = word_to_keys[word];
-  auto key_it = std::find(keys.begin(), keys.end(), key);
-  CHECK(key_it != keys.end());
-  if (keys.size() == 1) {
-    word_to_keys.erase(word);
+uint64 read_varint(const unsigned char *&ptr) {
+  if (*ptr < 0x80) {
+    return *ptr++;
+  }
+  uint64 result = 0;
+  int shift = 0;
+  while (*ptr & 0x80) {
+    result |= static_cast<uint64>(*ptr++ & 0x7f) << shift;
+    shift += 7;
+  }
+  return result | (static_cast<uint64>(*ptr++) << shift);
+}
+
+template <class F>
+void for_each_varint_delta(Slice data, F &&f) {
+  auto ptr = data.ubegin();
+  auto end = data.uend();
+  // keys are stored as differences between consecutive keys modulo 2^64
+  uint64 key = 0;
+  while (ptr != end) {
+    key += read_varint(ptr);
+    f(static_cast<int64>(key));
+  }
+}
+
+}  // namespace
+
+template <class F>
+void Hints::KeyList::for_each(F &&f) const {
+  if (changes_ == nullptr) {
+    for_each_varint_delta(data_, f);
+    return;
+  }
+
+  auto &added_keys = changes_->added_keys_;
+  auto &removed_keys = changes_->removed_keys_;
+  auto added_it = added_keys.begin();
+  auto removed_it = removed_keys.begin();
+  for_each_varint_delta(data_, [&](KeyT key) {
+    while (added_it != added_keys.end() && *added_it < key) {
+      f(*added_it++);
+    }
+    if (removed_it != removed_keys.end() && *removed_it == key) {
+      ++removed_it;
+      return;
+    }
+    f(key);
+  });
+  CHECK(removed_it == removed_keys.end());
+  while (added_it != added_keys.end()) {
+    f(*added_it++);
+  }
+}
+
+void Hints::KeyList::flush() {
+  string new_data;
+  uint64 last_key = 0;
+  for_each([&](KeyT key) {
+    append_varint(new_data, static_cast<uint64>(key) - last_key);
+    last_key = static_cast<uint64>(key);
+  });
+  new_data.shrink_to_fit();
+  data_ = std::move(new_data);
+  changes_ = nullptr;
+}
+
+void Hints::KeyList::add(KeyT key) {
+  if (changes_ == nullptr) {
+    changes_ = make_unique<Changes>();
+  }
+  auto &added_keys = changes_->added_keys_;
+  auto &removed_keys = changes_->removed_keys_;
+  auto removed_it = std::lower_bound(removed_keys.begin(), removed_keys.end(), key);
+  if (removed_it != removed_keys.end() && *removed_it == key) {
+    removed_keys.erase(removed_it);
+  } else {
+    auto added_it = std::lower_bound(added_keys.begin(), added_keys.end(), key);
+    CHECK(added_it == added_keys.end() || *added_it != key);
+    added_keys.insert(added_it, key);
+  }
+  size_++;
+  if (added_keys.size() + removed_keys.size() > size_ / 8) {
+    flush();
+  }
+}
+
+void Hints::KeyList::remove(KeyT key) {
+  CHECK(size_ > 0);
+  if (changes_ == nullptr) {
+    changes_ = make_unique<Changes>();
+  }
+  auto &added_keys = changes_->added_keys_;
+  auto &removed_keys = changes_->removed_keys_;
+  auto added_it = std::lower_bound(added_keys.begin(), added_keys.end(), key);
+  if (added_it != added_keys.end() && *added_it == key) {
+    added_keys.erase(added_it);
   } else {
-    CHECK(keys.size() > 1);
-    *key_it = keys.back();
-    keys.pop_back();
+    auto removed_it = std::lower_bound(removed_keys.begin(), removed_keys.end(), key);
+    CHECK(removed_it == removed_keys.end() || *removed_it != key);
+    removed_keys.insert(removed_it, key);
+  }
+  size_--;
+  if (added_keys.size() + removed_keys.size() > size_ / 8) {
+    flush();
+  }
+}
+
+void Hints::KeyList::append_to(vector<KeyT> &keys) const {
+  for_each([&keys](KeyT key) { keys.push_back(key); });
+}
+
+void Hints::add_word(const string &word, KeyT key, RadixTree<KeyList> &word_to_keys) {
+  word_to_keys.get(word).add(key);
+}
+
+void Hints::delete_word(const string &word, KeyT key, RadixTree<KeyList> &word_to_keys) {
+  auto *keys = word_to_keys.find(word);
+  CHECK(keys != nullptr);
+  keys->remove(key);
+  if (keys->empty()) {
+    word_to_keys.erase(word);
   }
 }
 
@@ -109,6 +224,7 @@ void Hints::add(KeyT key, Slice name) {
   if (name.empty()) {
     if (it != key_to_name_.end()) {
       key_to_name_.erase(it);
+      rating_order_.erase({get_rating(key), key});
     }
     key_to_rating_.erase(key);
     return;
@@ -128,22 +244,39 @@ void Hints::add(KeyT key, Slice name) {
     add_word(word, key, translit_word_to_keys_);
   }
 
-  key_to_name_[key] = name.str();
+  if (it == key_to_name_.end()) {
+    key_to_name_.emplace(key, name.str());
+    rating_order_.emplace(get_rating(key), key);
+  } else {
+    it->second = name.str();
+  }
 }
 
 void Hints::set_rating(KeyT key, RatingT rating) {
   // LOG(ERROR) << "Set rating " << key << ": " << rating;
-  key_to_rating_[key] = rating;
+  auto &old_rating = key_to_rating_[key];
+  if (old_rating == rating) {
+    return;
+  }
+  if (has_key(key)) {
+    rating_order_.erase({old_rating, key});
+    rating_order_.emplace(rating, key);
+  }
+  old_rating = rating;
+}
+
+Hints::RatingT Hints::get_rating(KeyT key) const {
+  auto it = key_to_rating_.find(key);
+  if (it == key_to_rating_.end()) {
+    return RatingT();
+  }
+  return it->second;
 }
 
 void Hints::add_search_results(vector<KeyT> &results, const string &word,
-                               const std::map<string, vector<KeyT>> &word_to_keys) {
+                               const RadixTree<KeyList> &word_to_keys) {
   LOG(DEBUG) << "Search for word " << word;
-  auto it = word_to_keys.lower_bound(word);
-  while (it != word_to_keys.end() && begins_with(it->first, word)) {
-    results.insert(results.end(), it->second.begin(), it->second.end());
-    ++it;
-  }
+  word_to_keys.for_each_with_prefix(word, [&results](const KeyList &keys) { keys.append_to(results); });
 }
 
 vector<Hints::KeyT> Hints::search_word(const string &word) const {
@@ -158,6 +291,40 @@ vector<Hints::KeyT> Hints::search_word(const string &word) const {
   return results;
 }
 
+void Hints::intersect(vector<KeyT> &results, const vector<KeyT> &keys) {
+  // for every key of the shorter list search for it in the longer list with exponentially increasing steps
+  bool is_results_shorter = results.size() <= keys.size();
+  const vector<KeyT> &short_keys = is_results_shorter ? results : keys;
+  const vector<KeyT> &long_keys = is_results_shorter ? keys : results;
+
+  vector<KeyT> new_results;
+  auto long_begin = long_keys.begin();
+  auto long_end = long_keys.end();
+  for (auto key : short_keys) {
+    // all keys before long_begin are less than key
+    auto long_it = long_begin;
+    size_t step = 1;
+    while (long_it != long_end && *long_it < key) {
+      long_begin = long_it + 1;
+      if (static_cast<size_t>(long_end - long_it) <= step) {
+        long_it = long_end;
+        break;
+      }
+      long_it += step;
+      step *= 2;
+    }
+    long_begin = std::lower_bound(long_begin, long_it, key);
+    if (long_begin == long_end) {
+      break;
+    }
+    if (*long_begin == key) {
+      new_results.push_back(key);
+      ++long_begin;
+    }
+  }
+  results = std::move(new_results);
+}
+
 std::pair<size_t, vector<Hints::KeyT>> Hints::search(Slice query, int32 limit, bool return_all_for_empty_query) const {
   // LOG(ERROR) << "Search " << query;
   vector<KeyT> results;
@@ -168,10 +335,13 @@ std::pair<size_t, vector<Hints::KeyT>> Hints::search(Slice query, int32 limit, b
 
   auto words = get_words(query, true);
   if (return_all_for_empty_query && words.empty()) {
-    results.reserve(key_to_name_.size());
-    for (auto &it : key_to_name_) {
-      results.push_back(it.first);
+    for (auto &it : rating_order_) {
+      if (results.size() == static_cast<size_t>(limit)) {
+        break;
+      }
+      results.push_back(it.second);
     }
+    return {key_to_name_.size(), std::move(results)};
   }
 
   for (size_t i = 0; i < words.size(); i++) {
@@ -180,34 +350,53 @@ std::pair<size_t, vector<Hints::KeyT>> Hints::search(Slice query, int32 limit, b
       results = std::move(keys);
       continue;
     }
+    intersect(results, keys);
+    if (results.empty()) {
+      break;
+    }
+  }
 
-    // now need to intersect two lists
-    size_t results_pos = 0;
-    size_t keys_pos = 0;
-    size_t new_results_size = 0;
-    while (results_pos != results.size() && keys_pos != keys.size()) {
-      if (results[results_pos] < keys[keys_pos]) {
-        results_pos++;
-      } else if (results[results_pos] > keys[keys_pos]) {
-        keys_pos++;
-      } else {
-        results[new_results_size++] = results[results_pos];
-        results_pos++;
-        keys_pos++;
+  auto total_size = results.size();
+  return {total_size, get_top_keys_by_rating(results, limit)};
+}
+
+vector<Hints::KeyT> Hints::get_top_keys_by_rating(const vector<KeyT> &keys, int32 limit) const {
+  vector<KeyT> result;
+  auto max_size = static_cast<size_t>(limit);
+  if (max_size == 0 || keys.empty()) {
+    return result;
+  }
+
+  // if a random key matches with probability p, then the walk in the rating order stops after about limit / p keys
+  auto key_count = static_cast<uint64>(key_to_name_.size());
+  if (static_cast<uint64>(keys.size()) * keys.size() > max_size * key_count) {
+    for (auto &it : rating_order_) {
+      if (std::binary_search(keys.begin(), keys.end(), it.second)) {
+        result.push_back(it.second);
+        if (result.size() == max_size) {
+          break;
+        }
       }
     }
-    results.resize(new_results_size);
+    return result;
   }
 
-  auto total_size = results.size();
-  if (total_size < static_cast<size_t>(limit)) {
-    std::sort(results.begin(), results.end(), CompareByRating(key_to_rating_));
-  } else {
-    std::partial_sort(results.begin(), results.begin() + limit, results.end(), CompareByRating(key_to_rating_));
-    results.resize(limit);
+  vector<std::pair<RatingT, KeyT>> rated_keys;
+  rated_keys.reserve(keys.size());
+  for (auto key : keys) {
+    rated_keys.emplace_back(get_rating(key), key);
   }
+  if (rated_keys.size() > max_size) {
+    std::nth_element(rated_keys.begin(), rated_keys.begin() + max_size, rated_keys.end());
+    rated_keys.resize(max_size);
+  }
+  std::sort(rated_keys.begin(), rated_keys.end());
 
-  return {total_size, std::move(results)};
+  result.reserve(rated_keys.size());
+  for (auto &rated_key : rated_keys) {
+    result.push_back(rated_key.second);
+  }
+  return result;
 }
 
 bool Hints::has_key(KeyT key) const {
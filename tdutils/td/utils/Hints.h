@@ -7,9 +7,10 @@
 #pragma once
 
 #include "td/utils/common.h"
+#include "td/utils/RadixTree.h"
 #include "td/utils/Slice.h"
 
-#include <map>
+#include <set>
 #include <unordered_map>
 #include <utility>
 
@@ -42,44 +43,57 @@ class Hints {
   size_t size() const;
 
  private:
-  std::map<string, vector<KeyT>> word_to_keys_;
-  std::map<string, vector<KeyT>> translit_word_to_keys_;
+  // sorted list of keys, stored as delta-encoded varints; recent changes are kept uncompressed
+  class KeyList {
+   public:
+    void add(KeyT key);
+
+    void remove(KeyT key);
+
+    bool empty() const {
+      return size_ == 0;
+    }
+
+    void append_to(vector<KeyT> &keys) const;  // appends the keys in increasing order
+
+   private:
+    struct Changes {
+      vector<KeyT> added_keys_;    // sorted keys, which aren't in data_
+      vector<KeyT> removed_keys_;  // sorted keys, which are in data_, but were removed
+    };
+
+    string data_;
+    size_t size_ = 0;
+    unique_ptr<Changes> changes_;  // changes, which aren't applied to data_ yet; applied, when there are many of them
+
+    template <class F>
+    void for_each(F &&f) const;
+
+    void flush();
+  };
+
+  RadixTree<KeyList> word_to_keys_;
+  RadixTree<KeyList> translit_word_to_keys_;
   std::unordered_map<KeyT, string> key_to_name_;
   std::unordered_map<KeyT, RatingT> key_to_rating_;
+  std::set<std::pair<RatingT, KeyT>> rating_order_;  // all keys with a name in the order of increasing rating
 
-  static void add_word(const string &word, KeyT key, std::map<string, vector<KeyT>> &word_to_keys);
-  static void delete_word(const string &word, KeyT key, std::map<string, vector<KeyT>> &word_to_keys);
+  static void add_word(const string &word, KeyT key, RadixTree<KeyList> &word_to_keys);
+  static void delete_word(const string &word, KeyT key, RadixTree<KeyList> &word_to_keys);
 
   static vector<string> fix_words(vector<string> words);
 
   static vector<string> get_words(Slice name, bool is_search);
 
-  static void add_search_results(vector<KeyT> &results, const string &word,
-                                 const std::map<string, vector<KeyT>> &word_to_keys);
+  static void add_search_results(vector<KeyT> &results, const string &word, const RadixTree<KeyList> &word_to_keys);
 
   vector<KeyT> search_word(const string &word) const;
 
-  class CompareByRating {
-    const std::unordered_map<KeyT, RatingT> &key_to_rating_;
-
-    RatingT get_rating(const KeyT &key) const {
-      auto it = key_to_rating_.find(key);
-      if (it == key_to_rating_.end()) {
-        return RatingT();
-      }
-      return it->second;
-    }
+  static void intersect(vector<KeyT> &results, const vector<KeyT> &keys);
 
-   public:
-    explicit CompareByRating(const std::unordered_map<KeyT, RatingT> &key_to_rating) : key_to_rating_(key_to_rating) {
-    }
+  RatingT get_rating(KeyT key) const;
 
-    bool operator()(const KeyT &lhs, const KeyT &rhs) const {
-      auto lhs_rating = get_rating(lhs);
-      auto rhs_rating = get_rating(rhs);
-      return lhs_rating < rhs_rating || (lhs_rating == rhs_rating && lhs < rhs);
-    }
-  };
+  vector<KeyT> get_top_keys_by_rating(const vector<KeyT> &keys, int32 limit) const;
 };
 
 }  // namespace td
@@ -0,0 +1,82 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/ObjectArena.h"
+
+#include "td/utils/port/thread_local.h"
+
+#include <algorithm>
+#include <new>
+
+namespace td {
+
+// every allocation is preceded by a header with a pointer to the arena owning it or nullptr for heap allocations
+static_assert(sizeof(ObjectArena *) <= alignof(std::max_align_t), "Unsupported pointer size");
+
+ObjectArena::Guard::Guard() : arena_(new ObjectArena()), old_arena_(current_arena()) {
+  current_arena() = arena_;
+}
+
+ObjectArena::Guard::~Guard() {
+  CHECK(current_arena() == arena_);
+  current_arena() = old_arena_;
+  arena_->dec_ref_cnt();
+}
+
+void *ObjectArena::allocate(size_t size) {
+  auto arena = current_arena();
+  char *ptr;
+  if (arena == nullptr) {
+    ptr = static_cast<char *>(::operator new(size + HEADER_SIZE));
+  } else {
+    ptr = arena->allocate_impl(size + HEADER_SIZE);
+  }
+  *reinterpret_cast<ObjectArena **>(ptr) = arena;
+  return ptr + HEADER_SIZE;
+}
+
+void ObjectArena::deallocate(void *ptr) noexcept {
+  if (ptr == nullptr) {
+    return;
+  }
+  auto header = static_cast<char *>(ptr) - HEADER_SIZE;
+  auto arena = *reinterpret_cast<ObjectArena **>(header);
+  if (arena == nullptr) {
+    ::operator delete(header);
+  } else {
+    arena->dec_ref_cnt();
+  }
+}
+
+char *ObjectArena::allocate_impl(size_t size) {
+  size = (size + HEADER_SIZE - 1) & ~(HEADER_SIZE - 1);
+  if (static_cast<size_t>(end_ - begin_) < size) {
+    auto chunk_size = std::max(next_chunk_size_, size);
+    if (next_chunk_size_ < MAX_CHUNK_SIZE) {
+      next_chunk_size_ *= 2;
+    }
+    chunks_.push_back(std::unique_ptr<char[]>(new char[chunk_size]));
+    begin_ = chunks_.back().get();
+    end_ = begin_ + chunk_size;
+  }
+  auto result = begin_;
+  begin_ += size;
+  ref_cnt_.fetch_add(1, std::memory_order_relaxed);
+  return result;
+}
+
+void ObjectArena::dec_ref_cnt() noexcept {
+  if (ref_cnt_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete this;
+  }
+}
+
+ObjectArena *&ObjectArena::current_arena() {
+  static TD_THREAD_LOCAL ObjectArena *arena;  // static zero-initialized
+  return arena;
+}
+
+}  // namespace td
@@ -0,0 +1,63 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace td {
+
+// Memory allocator for classes, which create many small objects at once, for example, while parsing a big message.
+// While an ObjectArena::Guard exists, ObjectArena::allocate in the same thread returns memory from big chunks,
+// otherwise memory is allocated from the heap. The chunks are freed only after all objects allocated from them
+// are deallocated, which can happen in any thread. The first chunk is small and every next chunk is twice bigger,
+// so an arena for a short message doesn't waste memory and an arena for a big message needs few chunks.
+// Objects allocated with ObjectArena::allocate must be deallocated with ObjectArena::deallocate.
+class ObjectArena {
+ public:
+  class Guard {
+   public:
+    Guard();
+    Guard(const Guard &other) = delete;
+    Guard &operator=(const Guard &other) = delete;
+    Guard(Guard &&other) = delete;
+    Guard &operator=(Guard &&other) = delete;
+    ~Guard();
+
+   private:
+    ObjectArena *arena_;
+    ObjectArena *old_arena_;
+  };
+
+  static void *allocate(size_t size);
+
+  static void deallocate(void *ptr) noexcept;
+
+ private:
+  static constexpr size_t DEFAULT_CHUNK_SIZE = 1 << 12;
+  static constexpr size_t MAX_CHUNK_SIZE = 1 << 20;
+  static constexpr size_t HEADER_SIZE = alignof(std::max_align_t);
+
+  vector<std::unique_ptr<char[]>> chunks_;
+  char *begin_ = nullptr;
+  char *end_ = nullptr;
+  size_t next_chunk_size_ = DEFAULT_CHUNK_SIZE;
+  std::atomic<size_t> ref_cnt_{1};
+
+  ObjectArena() = default;
+
+  char *allocate_impl(size_t size);
+
+  void dec_ref_cnt() noexcept;
+
+  static ObjectArena *&current_arena();
+};
+
+}  // namespace td
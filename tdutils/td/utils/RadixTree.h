@@ -0,0 +1,174 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+#include "td/utils/Slice.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace td {
+
+// map from strings to values with common prefixes of the keys stored once
+template <class ValueT>
+class RadixTree {
+ public:
+  // returns the value for the key, inserting the default value if there was no value
+  ValueT &get(Slice key) {
+    Node *node = &root_;
+    while (!key.empty()) {
+      auto it = find_child(node, key[0]);
+      if (it == node->children_.end() || (*it)->label_[0] != key[0]) {
+        auto child = make_unique<Node>();
+        child->label_ = key.str();
+        child->has_value_ = true;
+        size_++;
+        auto &value = child->value_;
+        node->children_.insert(it, std::move(child));
+        return value;
+      }
+
+      auto &label = (*it)->label_;
+      size_t common_size = 1;
+      while (common_size < label.size() && common_size < key.size() && label[common_size] == key[common_size]) {
+        common_size++;
+      }
+      if (common_size < label.size()) {
+        // split the edge
+        auto middle = make_unique<Node>();
+        middle->label_ = label.substr(0, common_size);
+        label.erase(0, common_size);
+        middle->children_.push_back(std::move(*it));
+        *it = std::move(middle);
+      }
+      node = it->get();
+      key.remove_prefix(common_size);
+    }
+    if (!node->has_value_) {
+      node->has_value_ = true;
+      size_++;
+    }
+    return node->value_;
+  }
+
+  ValueT *find(Slice key) {
+    Node *node = &root_;
+    while (!key.empty()) {
+      auto it = find_child(node, key[0]);
+      if (it == node->children_.end() || !begins_with(key, (*it)->label_)) {
+        return nullptr;
+      }
+      node = it->get();
+      key.remove_prefix((*it)->label_.size());
+    }
+    return node->has_value_ ? &node->value_ : nullptr;
+  }
+
+  bool erase(Slice key) {
+    Node *parent = nullptr;
+    size_t child_pos = 0;
+    Node *node = &root_;
+    while (!key.empty()) {
+      auto it = find_child(node, key[0]);
+      if (it == node->children_.end() || !begins_with(key, (*it)->label_)) {
+        return false;
+      }
+      parent = node;
+      child_pos = static_cast<size_t>(it - node->children_.begin());
+      node = it->get();
+      key.remove_prefix((*it)->label_.size());
+    }
+    if (!node->has_value_) {
+      return false;
+    }
+    node->has_value_ = false;
+    node->value_ = ValueT();
+    CHECK(size_ > 0);
+    size_--;
+
+    if (parent == nullptr) {
+      return true;
+    }
+    if (node->children_.empty()) {
+      parent->children_.erase(parent->children_.begin() + child_pos);
+      node = parent;
+    }
+    if (node != &root_ && !node->has_value_ && node->children_.size() == 1) {
+      // merge the node with its only child
+      auto child = std::move(node->children_[0]);
+      node->label_ += child->label_;
+      node->value_ = std::move(child->value_);
+      node->has_value_ = child->has_value_;
+      node->children_ = std::move(child->children_);
+    }
+    return true;
+  }
+
+  // calls f for values of all keys, beginning with the prefix, in lexicographical order of the keys
+  template <class F>
+  void for_each_with_prefix(Slice prefix, F &&f) const {
+    const Node *node = &root_;
+    while (!prefix.empty()) {
+      auto it = find_child(node, prefix[0]);
+      if (it == node->children_.end()) {
+        return;
+      }
+      auto &label = (*it)->label_;
+      if (begins_with(label, prefix)) {
+        node = it->get();
+        break;
+      }
+      if (!begins_with(prefix, label)) {
+        return;
+      }
+      node = it->get();
+      prefix.remove_prefix(label.size());
+    }
+    for_each(node, f);
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+ private:
+  struct Node {
+    string label_;  // the label of the edge from the parent node; empty only for the root
+    ValueT value_{};
+    bool has_value_ = false;
+    vector<unique_ptr<Node>> children_;  // sorted by the first byte of the label
+  };
+  Node root_;
+  size_t size_ = 0;
+
+  template <class NodeT>
+  static auto find_child(NodeT *node, char c) -> decltype(node->children_.begin()) {
+    return std::lower_bound(node->children_.begin(), node->children_.end(), static_cast<unsigned char>(c),
+                            [](const unique_ptr<Node> &child, unsigned char c) {
+                              return static_cast<unsigned char>(child->label_[0]) < c;
+                            });
+  }
+
+  template <class F>
+  static void for_each(const Node *node, F &f) {
+    if (node->has_value_) {
+      f(node->value_);
+    }
+    for (auto &child : node->children_) {
+      for_each(child.get(), f);
+    }
+  }
+};
+
+}  // namespace td
@@ -0,0 +1,159 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/TraceRecorder.h"
+
+#include "td/utils/JsonBuilder.h"
+#include "td/utils/logging.h"
+
+#include <mutex>
+#include <unordered_set>
+
+namespace td {
+
+std::atomic<size_t> TraceRecorder::max_span_count_{0};
+TD_THREAD_LOCAL uint64 TraceRecorder::trace_id_ = 0;
+
+namespace {
+
+struct TraceSpanInfo {
+  uint64 trace_id = 0;
+  string name;
+  double begin_time = 0;
+  double end_time = 0;
+  int32 thread_id = 0;
+};
+
+struct TraceSpans {
+  std::mutex mutex;
+  vector<TraceSpanInfo> spans;
+  size_t next_pos = 0;  // position of the oldest span, if the buffer is full
+  std::unordered_set<uint64> active_trace_ids;
+};
+
+int64 to_microseconds(double time) {
+  return static_cast<int64>(time * 1e6);
+}
+
+class ChromeTraceEvent final : public Jsonable {
+ public:
+  explicit ChromeTraceEvent(const TraceSpanInfo &span) : span_(span) {
+  }
+
+  void store(JsonValueScope *scope) const {
+    auto object = scope->enter_object();
+    object("name", span_.name);
+    object("cat", "td");
+    object("ph", "X");
+    object("ts", to_microseconds(span_.begin_time));
+    object("dur", to_microseconds(span_.end_time) - to_microseconds(span_.begin_time));
+    object("pid", static_cast<int64>(span_.trace_id));
+    object("tid", span_.thread_id);
+  }
+
+ private:
+  const TraceSpanInfo &span_;
+};
+
+class ChromeTraceEvents final : public Jsonable {
+ public:
+  explicit ChromeTraceEvents(const TraceSpans &trace_spans) : trace_spans_(trace_spans) {
+  }
+
+  void store(JsonValueScope *scope) const {
+    auto array = scope->enter_array();
+    auto size = trace_spans_.spans.size();
+    for (size_t i = 0; i < size; i++) {
+      array << ChromeTraceEvent(trace_spans_.spans[(trace_spans_.next_pos + i) % size]);
+    }
+  }
+
+ private:
+  const TraceSpans &trace_spans_;
+};
+
+class ChromeTrace final : public Jsonable {
+ public:
+  explicit ChromeTrace(const TraceSpans &trace_spans) : trace_spans_(trace_spans) {
+  }
+
+  void store(JsonValueScope *scope) const {
+    auto object = scope->enter_object();
+    object("traceEvents", ChromeTraceEvents(trace_spans_));
+  }
+
+ private:
+  const TraceSpans &trace_spans_;
+};
+
+TraceSpans &get_trace_spans() {
+  static TraceSpans spans;
+  return spans;
+}
+
+}  // namespace
+
+void TraceRecorder::set_max_span_count(size_t max_span_count) {
+  auto &trace_spans = get_trace_spans();
+  std::lock_guard<std::mutex> lock(trace_spans.mutex);
+  max_span_count_ = max_span_count;
+  trace_spans.spans.clear();
+  trace_spans.spans.shrink_to_fit();
+  trace_spans.next_pos = 0;
+  trace_spans.active_trace_ids.clear();
+}
+
+void TraceRecorder::start_trace(uint64 trace_id) {
+  CHECK(trace_id != 0);
+  auto &trace_spans = get_trace_spans();
+  std::lock_guard<std::mutex> lock(trace_spans.mutex);
+  trace_spans.active_trace_ids.insert(trace_id);
+}
+
+void TraceRecorder::finish_trace(uint64 trace_id) {
+  auto &trace_spans = get_trace_spans();
+  std::lock_guard<std::mutex> lock(trace_spans.mutex);
+  trace_spans.active_trace_ids.erase(trace_id);
+}
+
+uint64 TraceRecorder::get_active_trace_id_impl(uint64 trace_id) {
+  auto &trace_spans = get_trace_spans();
+  std::lock_guard<std::mutex> lock(trace_spans.mutex);
+  return trace_spans.active_trace_ids.count(trace_id) != 0 ? trace_id : 0;
+}
+
+void TraceRecorder::add_span(uint64 trace_id, Slice name, double begin_time, double end_time) {
+  auto &trace_spans = get_trace_spans();
+  std::lock_guard<std::mutex> lock(trace_spans.mutex);
+  auto max_span_count = max_span_count_.load(std::memory_order_relaxed);
+  if (max_span_count == 0) {
+    return;
+  }
+
+  TraceSpanInfo *span;
+  if (trace_spans.spans.size() < max_span_count) {
+    trace_spans.spans.emplace_back();
+    span = &trace_spans.spans.back();
+  } else {
+    span = &trace_spans.spans[trace_spans.next_pos];
+    if (++trace_spans.next_pos == trace_spans.spans.size()) {
+      trace_spans.next_pos = 0;
+    }
+  }
+  span->trace_id = trace_id;
+  span->name.assign(name.begin(), name.size());  // reuses the allocated memory
+  span->begin_time = begin_time;
+  span->end_time = end_time;
+  span->thread_id = get_thread_id();
+}
+
+string TraceRecorder::export_chrome_trace() {
+  auto &trace_spans = get_trace_spans();
+  std::lock_guard<std::mutex> lock(trace_spans.mutex);
+  return json_encode<string>(ChromeTrace(trace_spans));
+}
+
+}  // namespace td
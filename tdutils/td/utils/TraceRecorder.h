@@ -0,0 +1,111 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/port/thread_local.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Time.h"
+
+#include <atomic>
+
+namespace td {
+
+// Records spans of request processing into a bounded ring buffer, which can be exported in the Chrome trace format.
+// Every span belongs to a trace, identified by a non-zero trace identifier. The trace identifier of the current thread
+// is captured by actor events, promises and network queries, so spans of the same request are grouped together
+// even if they are recorded in different threads. A trace must be started before its identifier is used and finished
+// after the request is completed; identifiers of finished traces are ignored, so events and promises, which outlive
+// the request, don't extend its trace. While recording is disabled, spans cost one atomic load.
+class TraceRecorder {
+ public:
+  static bool is_enabled() {
+    return max_span_count_.load(std::memory_order_relaxed) != 0;
+  }
+
+  // 0 disables recording and drops all recorded spans and started traces
+  static void set_max_span_count(size_t max_span_count);
+
+  static void start_trace(uint64 trace_id);
+
+  static void finish_trace(uint64 trace_id);
+
+  // returns trace_id if the trace is started and not finished yet, and 0 otherwise
+  static uint64 get_active_trace_id(uint64 trace_id) {
+    if (trace_id == 0) {
+      return 0;
+    }
+    return get_active_trace_id_impl(trace_id);
+  }
+
+  static uint64 get_trace_id() {
+    return trace_id_;
+  }
+
+  static void set_trace_id(uint64 trace_id) {
+    trace_id_ = trace_id;
+  }
+
+  static void add_span(uint64 trace_id, Slice name, double begin_time, double end_time);
+
+  // returns all recorded spans in the Chrome trace event JSON format
+  static string export_chrome_trace();
+
+ private:
+  static std::atomic<size_t> max_span_count_;
+  static TD_THREAD_LOCAL uint64 trace_id_;
+
+  static uint64 get_active_trace_id_impl(uint64 trace_id);
+};
+
+// sets the trace identifier of the current thread, if the trace isn't finished yet
+class TraceIdGuard {
+ public:
+  explicit TraceIdGuard(uint64 trace_id) : old_trace_id_(TraceRecorder::get_trace_id()) {
+    TraceRecorder::set_trace_id(TraceRecorder::get_active_trace_id(trace_id));
+  }
+  TraceIdGuard(const TraceIdGuard &other) = delete;
+  TraceIdGuard &operator=(const TraceIdGuard &other) = delete;
+  TraceIdGuard(TraceIdGuard &&other) = delete;
+  TraceIdGuard &operator=(TraceIdGuard &&other) = delete;
+  ~TraceIdGuard() {
+    TraceRecorder::set_trace_id(old_trace_id_);
+  }
+
+ private:
+  uint64 old_trace_id_;
+};
+
+// records a span from construction to destruction, if there is a current trace
+class TraceSpan {
+ public:
+  explicit TraceSpan(Slice name) {
+    if (TraceRecorder::is_enabled()) {
+      trace_id_ = TraceRecorder::get_trace_id();
+      if (trace_id_ != 0) {
+        name_ = name.str();
+        begin_time_ = Time::now();
+      }
+    }
+  }
+  TraceSpan(const TraceSpan &other) = delete;
+  TraceSpan &operator=(const TraceSpan &other) = delete;
+  TraceSpan(TraceSpan &&other) = delete;
+  TraceSpan &operator=(TraceSpan &&other) = delete;
+  ~TraceSpan() {
+    if (trace_id_ != 0) {
+      TraceRecorder::add_span(trace_id_, name_, begin_time_, Time::now());
+    }
+  }
+
+ private:
+  uint64 trace_id_ = 0;
+  string name_;
+  double begin_time_ = 0;
+};
+
+}  // namespace td
@@ -11,10 +11,13 @@
 #include "td/utils/port/StdStreams.h"
 #include "td/utils/port/thread_local.h"
 #include "td/utils/Slice.h"
+#include "td/utils/StackAllocator.h"
+#include "td/utils/StringBuilder.h"
 #include "td/utils/Time.h"
 
 #include <atomic>
 #include <cstdlib>
+#include <cstring>
 #include <limits>
 #include <mutex>
 
@@ -35,49 +38,49 @@ LogOptions log_options;
 TD_THREAD_LOCAL const char *Logger::tag_ = nullptr;
 TD_THREAD_LOCAL const char *Logger::tag2_ = nullptr;
 
-Logger::Logger(LogInterface &log, const LogOptions &options, int log_level, Slice file_name, int line_num,
-               Slice comment)
-    : Logger(log, options, log_level) {
-  if (log_level == VERBOSITY_NAME(PLAIN) && &options == &log_options) {
-    return;
-  }
-  if (!options_.add_info) {
-    return;
-  }
-  if (ExitGuard::is_exited()) {
-    return;
-  }
+namespace {
+// the beginning of a log message in the binary form; followed by comment, tag_ and tag2_, and then by arguments,
+// each beginning with its type: 'i', 'u', 'd', 'c' or 's'
+struct DeferredLogHeader {
+  double time;
+  const char *file_name;  // __FILE__ of the logging place, which is valid during the whole process lifetime
+  uint32 file_name_size;
+  int32 line_num;
+  int32 log_level;
+  int32 thread_id;
+  bool fix_newlines;
+};
 
+void append_log_info(StringBuilder &sb, int log_level, int32 thread_id, double time, Slice file_name, int line_num,
+                     Slice tag, Slice tag2, Slice comment) {
   // log level
-  sb_ << '[';
+  sb << '[';
   if (static_cast<unsigned int>(log_level) < 10) {
-    sb_ << ' ' << static_cast<char>('0' + log_level);
+    sb << ' ' << static_cast<char>('0' + log_level);
   } else {
-    sb_ << log_level;
+    sb << log_level;
   }
-  sb_ << ']';
+  sb << ']';
 
   // thread id
-  auto thread_id = get_thread_id();
-  sb_ << "[t";
+  sb << "[t";
   if (static_cast<unsigned int>(thread_id) < 10) {
-    sb_ << ' ' << static_cast<char>('0' + thread_id);
+    sb << ' ' << static_cast<char>('0' + thread_id);
   } else {
-    sb_ << thread_id;
+    sb << thread_id;
   }
-  sb_ << ']';
+  sb << ']';
 
   // timestamp
-  auto time = Clocks::system();
   auto unix_time = static_cast<uint32>(time);
   auto nanoseconds = static_cast<uint32>((time - unix_time) * 1e9);
-  sb_ << '[' << unix_time << '.';
+  sb << '[' << unix_time << '.';
   uint32 limit = 100000000;
   while (nanoseconds < limit && limit > 1) {
-    sb_ << '0';
+    sb << '0';
     limit /= 10;
   }
-  sb_ << nanoseconds << ']';
+  sb << nanoseconds << ']';
 
   // file : line
   if (!file_name.empty()) {
@@ -86,47 +89,210 @@ Logger::Logger(LogInterface &log, const LogOptions &options, int log_level, Slic
       last_slash_--;
     }
     file_name = file_name.substr(last_slash_ + 1);
-    sb_ << '[' << file_name << ':' << static_cast<unsigned int>(line_num) << ']';
+    sb << '[' << file_name << ':' << static_cast<unsigned int>(line_num) << ']';
   }
 
   // context from tag_
-  if (tag_ != nullptr && *tag_) {
-    sb_ << "[#" << Slice(tag_) << ']';
+  if (!tag.empty()) {
+    sb << "[#" << tag << ']';
   }
 
   // context from tag2_
-  if (tag2_ != nullptr && *tag2_) {
-    sb_ << "[!" << Slice(tag2_) << ']';
+  if (!tag2.empty()) {
+    sb << "[!" << tag2 << ']';
   }
 
   // comment (e.g. condition in LOG_IF)
   if (!comment.empty()) {
-    sb_ << "[&" << comment << ']';
+    sb << "[&" << comment << ']';
+  }
+
+  sb << '\t';
+}
+
+MutableCSlice finish_log_message(StringBuilder &sb, bool fix_newlines) {
+  if (!fix_newlines) {
+    return sb.as_cslice();
+  }
+  sb << '\n';
+  auto slice = sb.as_cslice();
+  if (slice.back() != '\n') {
+    slice.back() = '\n';
+  }
+  while (slice.size() > 1 && slice[slice.size() - 2] == '\n') {
+    slice.back() = '\0';
+    slice = MutableCSlice(slice.begin(), slice.begin() + slice.size() - 1);
+  }
+  return slice;
+}
+
+Slice get_tag(const char *tag) {
+  return tag == nullptr ? Slice() : Slice(tag);
+}
+
+template <class T>
+bool read_deferred_value(Slice &record, T &value) {
+  if (record.size() < sizeof(value)) {
+    return false;
+  }
+  std::memcpy(&value, record.data(), sizeof(value));
+  record.remove_prefix(sizeof(value));
+  return true;
+}
+
+// returns false if the record is truncated; the returned string can be truncated too
+bool read_deferred_string(Slice &record, Slice &str) {
+  uint32 size;
+  if (!read_deferred_value(record, size)) {
+    return false;
+  }
+  str = record.substr(0, size);
+  record.remove_prefix(str.size());
+  return str.size() == size;
+}
+
+bool format_deferred_arg(Slice &record, StringBuilder &sb) {
+  char type;
+  if (!read_deferred_value(record, type)) {
+    return false;
+  }
+  switch (type) {
+    case 'i': {
+      int64 value;
+      if (!read_deferred_value(record, value)) {
+        return false;
+      }
+      sb << value;
+      return true;
+    }
+    case 'u': {
+      uint64 value;
+      if (!read_deferred_value(record, value)) {
+        return false;
+      }
+      sb << value;
+      return true;
+    }
+    case 'd': {
+      double value;
+      if (!read_deferred_value(record, value)) {
+        return false;
+      }
+      sb << value;
+      return true;
+    }
+    case 'c': {
+      char value;
+      if (!read_deferred_value(record, value)) {
+        return false;
+      }
+      sb << value;
+      return true;
+    }
+    case 's': {
+      Slice value;
+      bool is_complete = read_deferred_string(record, value);
+      sb << value;
+      return is_complete;
+    }
+    default:
+      return false;
   }
+}
 
-  sb_ << '\t';
+bool read_deferred_string_arg(Slice &record, Slice &str) {
+  char type;
+  return read_deferred_value(record, type) && type == 's' && read_deferred_string(record, str);
+}
+}  // namespace
+
+Logger::Logger(LogInterface &log, const LogOptions &options, int log_level, Slice file_name, int line_num,
+               Slice comment)
+    : Logger(log, options, log_level) {
+  if (ExitGuard::is_exited()) {
+    return;
+  }
+  bool add_info = options_.add_info && !(log_level == VERBOSITY_NAME(PLAIN) && &options == &log_options);
+
+  if (!add_info) {
+    return;
+  }
+
+  // fatal errors are formatted immediately, because the process is going to be terminated
+  if (options_.defer_formatting && log_level != VERBOSITY_NAME(FATAL)) {
+    is_deferred_ = true;
+    DeferredLogHeader header;
+    std::memset(&header, 0, sizeof(header));  // padding bytes are stored too
+    header.time = Clocks::system();
+    header.file_name = file_name.data();
+    header.file_name_size = static_cast<uint32>(file_name.size());
+    header.line_num = line_num;
+    header.log_level = log_level;
+    header.thread_id = get_thread_id();
+    header.fix_newlines = options_.fix_newlines;
+    store_raw(&header, sizeof(header));
+    store_string_arg(comment);
+    store_string_arg(get_tag(tag_));
+    store_string_arg(get_tag(tag2_));
+    return;
+  }
+
+  append_log_info(sb_, log_level, get_thread_id(), Clocks::system(), file_name, line_num, get_tag(tag_),
+                  get_tag(tag2_), comment);
 }
 
 Logger::~Logger() {
   if (ExitGuard::is_exited()) {
     return;
   }
-  if (options_.fix_newlines) {
-    sb_ << '\n';
-    auto slice = as_cslice();
-    if (slice.back() != '\n') {
-      slice.back() = '\n';
-    }
-    while (slice.size() > 1 && slice[slice.size() - 2] == '\n') {
-      slice.back() = '\0';
-      slice = MutableCSlice(slice.begin(), slice.begin() + slice.size() - 1);
-    }
-    log_.append(slice, log_level_);
+  if (is_deferred_) {
+    log_.append_deferred(as_cslice(), log_level_);
   } else {
-    log_.append(as_cslice(), log_level_);
+    log_.append(finish_log_message(sb_, options_.fix_newlines), log_level_);
   }
 }
 
+size_t Logger::begin_text_arg() {
+  uint32 size = 0;
+  sb_ << 's';
+  auto size_pos = sb_.as_cslice().size();
+  store_raw(&size, sizeof(size));
+  return size_pos;
+}
+
+void Logger::end_text_arg(size_t size_pos) {
+  auto slice = sb_.as_cslice();
+  if (slice.size() >= size_pos + sizeof(uint32)) {
+    auto size = static_cast<uint32>(slice.size() - size_pos - sizeof(uint32));
+    std::memcpy(slice.begin() + size_pos, &size, sizeof(size));
+  }
+}
+
+MutableCSlice format_deferred_log_record(Slice record, StringBuilder &sb) {
+  DeferredLogHeader header;
+  if (!read_deferred_value(record, header)) {
+    return sb.as_cslice();
+  }
+  Slice comment;
+  Slice tag;
+  Slice tag2;
+  if (!read_deferred_string_arg(record, comment) || !read_deferred_string_arg(record, tag) ||
+      !read_deferred_string_arg(record, tag2)) {
+    return finish_log_message(sb, header.fix_newlines);
+  }
+  append_log_info(sb, header.log_level, header.thread_id, header.time, Slice(header.file_name, header.file_name_size),
+                  header.line_num, tag, tag2, comment);
+  while (!record.empty() && format_deferred_arg(record, sb)) {
+  }
+  return finish_log_message(sb, header.fix_newlines);
+}
+
+void LogInterface::append_deferred(Slice record, int log_level) {
+  auto buffer = StackAllocator::alloc(Logger::BUFFER_SIZE);
+  StringBuilder sb(buffer.as_slice());
+  append(format_deferred_log_record(record, sb), log_level);
+}
+
 TsCerr::TsCerr() {
   enterCritical();
 }
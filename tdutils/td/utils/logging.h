@@ -21,6 +21,9 @@
  *
  * LOG(FATAL) << "Power is off";
  * CHECK(condition) <===> LOG_IF(FATAL, !(condition))
+ *
+ * If log_options.defer_formatting is set, then message headers, strings and numbers are stored in a binary form
+ * and are formatted by the log interface, for example, by AsyncFileLog in its writer thread.
  */
 
 #include "td/utils/common.h"
@@ -114,6 +117,7 @@ struct LogOptions {
   std::atomic<int> level{VERBOSITY_NAME(DEBUG) + 1};
   bool fix_newlines{true};
   bool add_info{true};
+  bool defer_formatting{false};  // message headers and arguments are formatted by the log interface
 
   int get_level() const {
     return level.load(std::memory_order_relaxed);
@@ -128,17 +132,19 @@ struct LogOptions {
   }
 
   constexpr LogOptions() = default;
-  constexpr LogOptions(int level, bool fix_newlines, bool add_info)
-      : level(level), fix_newlines(fix_newlines), add_info(add_info) {
+  constexpr LogOptions(int level, bool fix_newlines, bool add_info, bool defer_formatting = false)
+      : level(level), fix_newlines(fix_newlines), add_info(add_info), defer_formatting(defer_formatting) {
   }
 
-  LogOptions(const LogOptions &other) : LogOptions(other.level.load(), other.fix_newlines, other.add_info) {
+  LogOptions(const LogOptions &other)
+      : LogOptions(other.level.load(), other.fix_newlines, other.add_info, other.defer_formatting) {
   }
 
   LogOptions &operator=(const LogOptions &other) {
     level = other.level.load();
     fix_newlines = other.fix_newlines;
     add_info = other.add_info;
+    defer_formatting = other.defer_formatting;
     return *this;
   }
   LogOptions(LogOptions &&) = delete;
@@ -175,6 +181,10 @@ class LogInterface {
 
   virtual void append(CSlice slice, int log_level) = 0;
 
+  // receives a log message in the binary form, used if LogOptions::defer_formatting is set;
+  // the message can be formatted later using format_deferred_log_record in any thread of the process
+  virtual void append_deferred(Slice record, int log_level);
+
   virtual void rotate() {
   }
 
@@ -202,6 +212,9 @@ void set_log_fatal_error_callback(OnFatalErrorCallback callback);
 
 [[noreturn]] void process_fatal_error(CSlice message);
 
+// formats a log message, stored by Logger in the binary form; truncated records are formatted partially
+MutableCSlice format_deferred_log_record(Slice record, StringBuilder &sb);
+
 #define TC_RED "\x1b[1;31m"
 #define TC_BLUE "\x1b[1;34m"
 #define TC_CYAN "\x1b[1;36m"
@@ -227,6 +240,27 @@ class TsCerr {
   void exitCritical();
 };
 
+namespace detail {
+template <class T>
+struct DeferredArgKind {
+  enum : int { String, Char, Double, Signed, Unsigned, Text };
+
+  using ValueT = std::remove_cv_t<T>;
+  static constexpr bool is_string = std::is_convertible<const T &, Slice>::value ||
+                                    std::is_same<std::decay_t<T>, char *>::value ||
+                                    std::is_same<std::decay_t<T>, const char *>::value;
+  // signed and unsigned chars are printed by StringBuilder as numbers
+  static constexpr bool is_char = std::is_same<ValueT, char>::value;
+
+  static constexpr int value = is_string ? String
+                               : is_char ? Char
+                               : std::is_floating_point<ValueT>::value ? Double
+                               : std::is_same<ValueT, bool>::value || !std::is_integral<ValueT>::value ? Text
+                               : std::is_signed<ValueT>::value ? Signed
+                                                                : Unsigned;
+};
+}  // namespace detail
+
 class Logger {
  public:
   static const int BUFFER_SIZE = 128 * 1024;
@@ -242,7 +276,11 @@ class Logger {
 
   template <class T>
   Logger &operator<<(T &&other) {
-    sb_ << other;
+    if (is_deferred_) {
+      store_arg(other, std::integral_constant<int, detail::DeferredArgKind<std::remove_reference_t<T>>::value>());
+    } else {
+      sb_ << other;
+    }
     return *this;
   }
 
@@ -267,6 +305,60 @@ class Logger {
   StringBuilder sb_;
   const LogOptions &options_;
   int log_level_;
+  bool is_deferred_ = false;
+
+  void store_raw(const void *data, size_t size) {
+    sb_ << Slice(static_cast<const char *>(data), size);
+  }
+
+  void store_string_arg(Slice slice) {
+    auto size = static_cast<uint32>(slice.size());
+    sb_ << 's';
+    store_raw(&size, sizeof(size));
+    sb_ << slice;
+  }
+
+  size_t begin_text_arg();
+  void end_text_arg(size_t size_pos);
+
+  template <class T>
+  void store_arg(const T &value, std::integral_constant<int, detail::DeferredArgKind<T>::String>) {
+    store_string_arg(Slice(value));
+  }
+
+  template <class T>
+  void store_arg(const T &value, std::integral_constant<int, detail::DeferredArgKind<T>::Char>) {
+    sb_ << 'c' << static_cast<char>(value);
+  }
+
+  template <class T>
+  void store_arg(const T &value, std::integral_constant<int, detail::DeferredArgKind<T>::Double>) {
+    auto stored_value = static_cast<double>(value);
+    sb_ << 'd';
+    store_raw(&stored_value, sizeof(stored_value));
+  }
+
+  template <class T>
+  void store_arg(const T &value, std::integral_constant<int, detail::DeferredArgKind<T>::Signed>) {
+    auto stored_value = static_cast<int64>(value);
+    sb_ << 'i';
+    store_raw(&stored_value, sizeof(stored_value));
+  }
+
+  template <class T>
+  void store_arg(const T &value, std::integral_constant<int, detail::DeferredArgKind<T>::Unsigned>) {
+    auto stored_value = static_cast<uint64>(value);
+    sb_ << 'u';
+    store_raw(&stored_value, sizeof(stored_value));
+  }
+
+  // objects are still formatted by the logging thread, because they can be changed or destroyed later
+  template <class T>
+  void store_arg(T &value, std::integral_constant<int, detail::DeferredArgKind<T>::Text>) {
+    auto size_pos = begin_text_arg();
+    sb_ << value;
+    end_text_arg(size_pos);
+  }
 };
 
 namespace detail {
@@ -306,6 +398,11 @@ class TsLog : public LogInterface {
     log_->append(slice, level);
     exit_critical();
   }
+  void append_deferred(Slice record, int level) override {
+    enter_critical();
+    log_->append_deferred(record, level);
+    exit_critical();
+  }
   void rotate() override {
     enter_critical();
     log_->rotate();
@@ -30,6 +30,13 @@
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
+
+#if TD_LINUX && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#define TD_SOCKET_ZERO_COPY 1
+#include "td/utils/VectorQueue.h"
+
+#include <linux/errqueue.h>
+#endif
 #endif
 
 #include <atomic>
@@ -402,6 +409,58 @@ class SocketFdImpl {
     return write_finish(write_res);
   }
 
+  Status set_zero_copy(bool is_enabled) {
+#if TD_SOCKET_ZERO_COPY
+    int flags = is_enabled ? 1 : 0;
+    if (setsockopt(get_native_fd().socket(), SOL_SOCKET, SO_ZEROCOPY, &flags, sizeof(flags)) != 0) {
+      return OS_SOCKET_ERROR(PSLICE() << "Failed to set SO_ZEROCOPY on " << get_native_fd());
+    }
+    is_zero_copy_enabled_ = is_enabled;
+    return Status::OK();
+#else
+    if (!is_enabled) {
+      return Status::OK();
+    }
+    return Status::Error("MSG_ZEROCOPY is unsupported");
+#endif
+  }
+
+  bool is_zero_copy_enabled() const {
+    return is_zero_copy_enabled_;
+  }
+
+  size_t get_zero_copy_pending_count() const {
+#if TD_SOCKET_ZERO_COPY
+    return zero_copy_queue_.size();
+#else
+    return 0;
+#endif
+  }
+
+  Result<size_t> write_zero_copy(BufferSlice slice) {
+#if TD_SOCKET_ZERO_COPY
+    if (!is_zero_copy_enabled_) {
+      return write(slice.as_slice());
+    }
+    process_zero_copy_completions();
+    int native_fd = get_native_fd().socket();
+    auto write_res = detail::skip_eintr(
+        [&] { return send(native_fd, slice.as_slice().begin(), slice.size(), MSG_NOSIGNAL | MSG_ZEROCOPY); });
+    if (write_res < 0 && errno == ENOBUFS) {
+      // the socket's optmem limit is exhausted by pinned pages; fall back to a copying send
+      return write(slice.as_slice());
+    }
+    if (write_res >= 0) {
+      // every successful MSG_ZEROCOPY send consumes exactly one completion identifier
+      slice.truncate(narrow_cast<size_t>(write_res));
+      zero_copy_queue_.push(ZeroCopyRequest{next_zero_copy_id_++, false, std::move(slice)});
+    }
+    return write_finish(write_res);
+#else
+    return write(slice.as_slice());
+#endif
+  }
+
   Result<size_t> write(Slice slice) {
     int native_fd = get_native_fd().socket();
     auto write_res = detail::skip_eintr([&] {
@@ -505,10 +564,85 @@ class SocketFdImpl {
     if (!get_poll_info().get_flags_local().has_pending_error()) {
       return Status::OK();
     }
+#if TD_SOCKET_ZERO_COPY
+    // zero-copy completions are reported through the error queue
+    process_zero_copy_completions();
+#endif
     TRY_STATUS(detail::get_socket_pending_error(get_native_fd()));
     get_poll_info().clear_flags(PollFlags::Error());
     return Status::OK();
   }
+
+ private:
+  bool is_zero_copy_enabled_ = false;
+#if TD_SOCKET_ZERO_COPY
+  struct ZeroCopyRequest {
+    uint32 id;
+    bool is_completed;
+    BufferSlice data;
+  };
+  VectorQueue<ZeroCopyRequest> zero_copy_queue_;
+  uint32 next_zero_copy_id_ = 0;
+
+  void on_zero_copy_completed(uint32 first_id, uint32 last_id) {
+    if (zero_copy_queue_.empty()) {
+      return;
+    }
+    auto front_id = zero_copy_queue_.front().id;
+    auto requests = zero_copy_queue_.as_mutable_span();
+    for (uint32 id = first_id;; id++) {
+      auto pos = static_cast<uint32>(id - front_id);
+      if (pos < requests.size()) {
+        requests[pos].is_completed = true;
+        requests[pos].data = BufferSlice();
+      }
+      if (id == last_id) {
+        break;
+      }
+    }
+    while (!zero_copy_queue_.empty() && zero_copy_queue_.front().is_completed) {
+      zero_copy_queue_.pop();
+    }
+  }
+
+  void process_zero_copy_completions() {
+    if (zero_copy_queue_.empty()) {
+      return;
+    }
+    int native_fd = get_native_fd().socket();
+    while (true) {
+      char control[128];
+      msghdr msg;
+      std::memset(&msg, 0, sizeof(msg));
+      msg.msg_control = control;
+      msg.msg_controllen = sizeof(control);
+      auto res = detail::skip_eintr([&] { return recvmsg(native_fd, &msg, MSG_ERRQUEUE); });
+      if (res < 0) {
+        auto recv_errno = errno;
+        if (recv_errno != EAGAIN
+#if EAGAIN != EWOULDBLOCK
+            && recv_errno != EWOULDBLOCK
+#endif
+        ) {
+          LOG(INFO) << Status::PosixError(recv_errno, PSLICE() << "Failed to read error queue of " << get_native_fd());
+        }
+        return;
+      }
+      for (auto *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (!((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+              (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR))) {
+          continue;
+        }
+        sock_extended_err err;
+        std::memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+        if (err.ee_origin != SO_EE_ORIGIN_ZEROCOPY || err.ee_errno != 0) {
+          continue;
+        }
+        on_zero_copy_completed(err.ee_info, err.ee_data);
+      }
+    }
+  }
+#endif
 };
 
 void SocketFdImplDeleter::operator()(SocketFdImpl *impl) {
@@ -651,4 +785,41 @@ Result<size_t> SocketFd::read(MutableSlice slice) {
   return impl_->read(slice);
 }
 
+#if TD_PORT_POSIX
+Status SocketFd::set_zero_copy(bool is_enabled) {
+  return impl_->set_zero_copy(is_enabled);
+}
+
+bool SocketFd::is_zero_copy_enabled() const {
+  return impl_->is_zero_copy_enabled();
+}
+
+Result<size_t> SocketFd::write_zero_copy(BufferSlice slice) {
+  return impl_->write_zero_copy(std::move(slice));
+}
+
+size_t SocketFd::get_zero_copy_pending_count() const {
+  return impl_->get_zero_copy_pending_count();
+}
+#elif TD_PORT_WINDOWS
+Status SocketFd::set_zero_copy(bool is_enabled) {
+  if (!is_enabled) {
+    return Status::OK();
+  }
+  return Status::Error("MSG_ZEROCOPY is unsupported");
+}
+
+bool SocketFd::is_zero_copy_enabled() const {
+  return false;
+}
+
+Result<size_t> SocketFd::write_zero_copy(BufferSlice slice) {
+  return impl_->write(slice.as_slice());
+}
+
+size_t SocketFd::get_zero_copy_pending_count() const {
+  return 0;
+}
+#endif
+
 }  // namespace td
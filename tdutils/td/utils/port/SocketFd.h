@@ -8,6 +8,7 @@
 
 #include "td/utils/port/config.h"
 
+#include "td/utils/buffer.h"
 #include "td/utils/port/detail/NativeFd.h"
 #include "td/utils/port/detail/PollableFd.h"
 #include "td/utils/port/IoSlice.h"
@@ -48,6 +49,12 @@ class SocketFd {
   Result<size_t> writev(Span<IoSlice> slices) TD_WARN_UNUSED_RESULT;
   Result<size_t> read(MutableSlice slice) TD_WARN_UNUSED_RESULT;
 
+  // MSG_ZEROCOPY support; the socket keeps the sent BufferSlice alive until the kernel reports its completion
+  Status set_zero_copy(bool is_enabled) TD_WARN_UNUSED_RESULT;
+  bool is_zero_copy_enabled() const;
+  Result<size_t> write_zero_copy(BufferSlice slice) TD_WARN_UNUSED_RESULT;
+  size_t get_zero_copy_pending_count() const;
+
   const NativeFd &get_native_fd() const;
   static Result<SocketFd> from_native_fd(NativeFd fd);
 
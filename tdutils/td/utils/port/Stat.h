@@ -21,6 +21,8 @@ struct Stat {
   int64 real_size_;
   uint64 atime_nsec_;
   uint64 mtime_nsec_;
+  uint32 link_count_;
+  uint64 inode_;
 };
 
 Result<Stat> stat(CSlice path) TD_WARN_UNUSED_RESULT;
@@ -13,6 +13,7 @@ char disable_linker_warning_about_empty_file_epoll_cpp TD_UNUSED;
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
 #include "td/utils/Status.h"
+#include "td/utils/Time.h"
 
 #include <cerrno>
 
@@ -20,13 +21,27 @@ char disable_linker_warning_about_empty_file_epoll_cpp TD_UNUSED;
 
 namespace td {
 namespace detail {
+constexpr size_t Epoll::DEFAULT_MAX_EVENTS;
+
 void Epoll::init() {
   CHECK(!epoll_fd_);
   epoll_fd_ = NativeFd(epoll_create(1));
   auto epoll_create_errno = errno;
   LOG_IF(FATAL, !epoll_fd_) << Status::PosixError(epoll_create_errno, "epoll_create failed");
 
-  events_.resize(1000);
+  events_.resize(td::min(max_events_, DEFAULT_MAX_EVENTS));
+}
+
+void Epoll::set_max_events(size_t max_events) {
+  CHECK(max_events > 0);
+  max_events_ = max_events;
+  if (events_.size() > max_events_) {
+    events_.resize(max_events_);
+  }
+}
+
+void Epoll::set_busy_poll_time(double busy_poll_time) {
+  busy_poll_time_ = td::max(busy_poll_time, 0.0);
 }
 
 void Epoll::clear() {
@@ -80,11 +95,33 @@ void Epoll::unsubscribe_before_close(PollableFdRef fd) {
   unsubscribe(fd);
 }
 
-void Epoll::run(int timeout_ms) {
+int Epoll::wait(int timeout_ms) {
   int ready_n = epoll_wait(epoll_fd_.fd(), &events_[0], static_cast<int>(events_.size()), timeout_ms);
   auto epoll_wait_errno = errno;
   LOG_IF(FATAL, ready_n == -1 && epoll_wait_errno != EINTR)
       << Status::PosixError(epoll_wait_errno, "epoll_wait failed");
+  return ready_n;
+}
+
+void Epoll::run(int timeout_ms) {
+  int ready_n = 0;
+  if (busy_poll_time_ > 0 && timeout_ms != 0) {
+    // busy polling must not delay the timeout, so only the remaining time is waited for after it
+    auto start_time = Time::now();
+    auto busy_poll_time = timeout_ms < 0 ? busy_poll_time_ : min(busy_poll_time_, timeout_ms * 1e-3);
+    auto busy_poll_end = start_time + busy_poll_time;
+    double now;
+    do {
+      ready_n = wait(0);
+      now = Time::now();
+    } while (ready_n == 0 && now < busy_poll_end);
+    if (ready_n == 0 && timeout_ms > 0) {
+      timeout_ms = max(timeout_ms - static_cast<int>((now - start_time) * 1000), 0);
+    }
+  }
+  if (ready_n == 0) {
+    ready_n = wait(timeout_ms);
+  }
 
   for (int i = 0; i < ready_n; i++) {
     PollFlags flags;
@@ -119,6 +156,10 @@ void Epoll::run(int timeout_ms) {
     pollable_fd.add_flags(flags);
     pollable_fd.release_as_list_node();
   }
+
+  if (static_cast<size_t>(ready_n) == events_.size() && events_.size() < max_events_) {
+    events_.resize(td::min(events_.size() * 2, max_events_));
+  }
 }
 }  // namespace detail
 }  // namespace td
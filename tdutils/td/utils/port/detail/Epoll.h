@@ -47,10 +47,22 @@ class Epoll final : public PollBase {
     return true;
   }
 
+  // the event array grows up to max_events while epoll_wait keeps filling it completely
+  void set_max_events(size_t max_events);
+
+  // epoll_wait is polled without blocking for up to busy_poll_time seconds before a blocking wait
+  void set_busy_poll_time(double busy_poll_time);
+
  private:
   NativeFd epoll_fd_;
   vector<struct epoll_event> events_;
+  size_t max_events_ = DEFAULT_MAX_EVENTS;
+  double busy_poll_time_ = 0.0;
   ListNode list_root_;
+
+  static constexpr size_t DEFAULT_MAX_EVENTS = 1000;
+
+  int wait(int timeout_ms);
 };
 
 }  // namespace detail
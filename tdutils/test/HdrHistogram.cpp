@@ -0,0 +1,75 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/common.h"
+#include "td/utils/HdrHistogram.h"
+#include "td/utils/port/thread.h"
+#include "td/utils/Random.h"
+#include "td/utils/tests.h"
+
+TEST(HdrHistogram, buckets) {
+  size_t last_bucket = 0;
+  for (td::uint64 value = 0; value < 100000; value++) {
+    auto bucket = td::HdrHistogram::get_bucket(value);
+    ASSERT_TRUE(bucket == last_bucket || bucket == last_bucket + 1);
+    ASSERT_TRUE(value <= td::HdrHistogram::get_bucket_max_value(bucket));
+    if (bucket > 0) {
+      ASSERT_TRUE(value > td::HdrHistogram::get_bucket_max_value(bucket - 1));
+    }
+    last_bucket = bucket;
+  }
+  for (int i = 0; i < 100000; i++) {
+    auto value = td::Random::fast_uint64() >> td::Random::fast(0, 63);
+    auto bucket = td::HdrHistogram::get_bucket(value);
+    ASSERT_TRUE(bucket < td::HdrHistogram::BUCKET_COUNT);
+    if (bucket + 1 < td::HdrHistogram::BUCKET_COUNT) {
+      auto max_value = td::HdrHistogram::get_bucket_max_value(bucket);
+      ASSERT_TRUE(value <= max_value);
+      ASSERT_TRUE(static_cast<double>(max_value - value) <= static_cast<double>(value) / 8);
+    }
+  }
+  ASSERT_EQ(td::HdrHistogram::BUCKET_COUNT - 1, td::HdrHistogram::get_bucket(static_cast<td::uint64>(-1)));
+}
+
+TEST(HdrHistogram, quantiles) {
+  td::HdrHistogram histogram;
+  ASSERT_EQ(0u, histogram.get_quantile(0.5));
+  for (td::uint64 value = 1; value <= 1000; value++) {
+    histogram.add(value);
+  }
+  ASSERT_EQ(1000u, histogram.get_count());
+  ASSERT_EQ(500500u, histogram.get_sum());
+  ASSERT_EQ(1u, histogram.get_quantile(0));
+  auto median = histogram.get_quantile(0.5);
+  ASSERT_TRUE(500 <= median && median <= 500 * 9 / 8);
+  auto max = histogram.get_quantile(1);
+  ASSERT_TRUE(1000 <= max && max <= 1000 * 9 / 8);
+
+  td::HdrHistogram other;
+  other.add(1000000);
+  histogram.merge_from(other);
+  ASSERT_EQ(1001u, histogram.get_count());
+  ASSERT_TRUE(histogram.get_quantile(1) >= 1000000);
+}
+
+#if !TD_THREAD_UNSUPPORTED
+TEST(HdrHistogram, concurrent) {
+  td::HdrHistogram histogram;
+  td::vector<td::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&histogram] {
+      for (td::uint64 value = 0; value < 10000; value++) {
+        histogram.add_concurrent(value);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(40000u, histogram.get_count());
+  ASSERT_EQ(4u * 9999 * 10000 / 2, histogram.get_sum());
+}
+#endif
@@ -0,0 +1,140 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/tests.h"
+
+#include "td/utils/common.h"
+#include "td/utils/Hints.h"
+#include "td/utils/misc.h"
+#include "td/utils/RadixTree.h"
+#include "td/utils/Random.h"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+TEST(Hints, RadixTree) {
+  td::RadixTree<int> tree;
+  std::map<td::string, int> map;
+  td::Random::Xorshift128plus rnd(123);
+  auto random_string = [&] {
+    td::string result;
+    auto length = rnd.fast(0, 5);
+    for (int i = 0; i < length; i++) {
+      result += static_cast<char>('a' + rnd.fast(0, 2));
+    }
+    return result;
+  };
+  for (int i = 0; i < 100000; i++) {
+    auto key = random_string();
+    if (rnd.fast(0, 2) == 0) {
+      ASSERT_EQ(map.erase(key) != 0, tree.erase(key));
+    } else {
+      map[key] = i;
+      tree.get(key) = i;
+    }
+    ASSERT_EQ(map.size(), tree.size());
+
+    auto *value = tree.find(key);
+    auto it = map.find(key);
+    ASSERT_EQ(it != map.end(), value != nullptr);
+    if (value != nullptr) {
+      ASSERT_EQ(it->second, *value);
+    }
+
+    auto prefix = random_string();
+    td::vector<int> expected;
+    for (it = map.lower_bound(prefix); it != map.end() && td::begins_with(it->first, prefix); ++it) {
+      expected.push_back(it->second);
+    }
+    td::vector<int> found;
+    tree.for_each_with_prefix(prefix, [&](int value) { found.push_back(value); });
+    ASSERT_EQ(expected, found);
+  }
+}
+
+TEST(Hints, search) {
+  td::Hints hints;
+  std::map<td::int64, td::vector<td::string>> key_to_words;
+  std::map<td::int64, td::int64> key_to_rating;
+  td::Random::Xorshift128plus rnd(123);
+  auto random_word = [&] {
+    td::string result;
+    auto length = rnd.fast(1, 3);
+    for (int i = 0; i < length; i++) {
+      result += static_cast<char>('q' + rnd.fast(0, 3));
+    }
+    return result;
+  };
+  auto random_key = [&] {
+    return static_cast<td::int64>(rnd.fast(-200, 200)) * (static_cast<td::int64>(1) << rnd.fast(0, 40));
+  };
+
+  for (int i = 0; i < 10000; i++) {
+    auto key = random_key();
+    if (rnd.fast(0, 3) == 0) {
+      hints.remove(key);
+      key_to_words.erase(key);
+    } else {
+      td::vector<td::string> words;
+      td::string name;
+      for (int j = rnd.fast(1, 3); j > 0; j--) {
+        words.push_back(random_word());
+        name += words.back();
+        name += ' ';
+      }
+      hints.add(key, name);
+      key_to_words[key] = std::move(words);
+    }
+    auto rating = static_cast<td::int64>(rnd.fast(0, 1000));
+    hints.set_rating(key, rating);
+    key_to_rating[key] = rating;
+    ASSERT_EQ(key_to_words.size(), hints.size());
+
+    if (i % 10 != 0) {
+      continue;
+    }
+    td::vector<td::string> query_words;
+    td::string query;
+    for (int j = rnd.fast(1, 2); j > 0; j--) {
+      query_words.push_back(random_word().substr(0, rnd.fast(1, 2)));
+      query += query_words.back();
+      query += ' ';
+    }
+    td::vector<std::pair<td::int64, td::int64>> expected;
+    for (auto &it : key_to_words) {
+      bool is_found = true;
+      for (auto &query_word : query_words) {
+        is_found &= std::any_of(it.second.begin(), it.second.end(),
+                                [&](const td::string &word) { return td::begins_with(word, query_word); });
+      }
+      if (is_found) {
+        expected.emplace_back(key_to_rating[it.first], it.first);
+      }
+    }
+    std::sort(expected.begin(), expected.end());
+
+    auto limit = rnd.fast(0, 20);
+    auto result = hints.search(query, limit);
+    ASSERT_EQ(expected.size(), result.first);
+    ASSERT_EQ(td::min(expected.size(), static_cast<size_t>(limit)), result.second.size());
+    for (size_t j = 0; j < result.second.size(); j++) {
+      ASSERT_EQ(expected[j].second, result.second[j]);
+    }
+
+    expected.clear();
+    for (auto &it : key_to_words) {
+      expected.emplace_back(key_to_rating[it.first], it.first);
+    }
+    std::sort(expected.begin(), expected.end());
+    result = hints.search_empty(limit);
+    ASSERT_EQ(expected.size(), result.first);
+    ASSERT_EQ(td::min(expected.size(), static_cast<size_t>(limit)), result.second.size());
+    for (size_t j = 0; j < result.second.size(); j++) {
+      ASSERT_EQ(expected[j].second, result.second[j]);
+    }
+  }
+}
@@ -0,0 +1,128 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/common.h"
+#include "td/utils/ObjectArena.h"
+#include "td/utils/port/thread.h"
+#include "td/utils/Random.h"
+#include "td/utils/Span.h"
+#include "td/utils/tests.h"
+
+#include <atomic>
+
+namespace {
+
+std::atomic<int> alive_object_count{0};
+
+class ArenaObject {
+ public:
+  explicit ArenaObject(td::int64 value) : value_(value), data_(value, 'a') {
+    alive_object_count++;
+  }
+  ArenaObject(const ArenaObject &other) = delete;
+  ArenaObject &operator=(const ArenaObject &other) = delete;
+  ArenaObject(ArenaObject &&other) = delete;
+  ArenaObject &operator=(ArenaObject &&other) = delete;
+  virtual ~ArenaObject() {
+    alive_object_count--;
+  }
+
+  static void *operator new(std::size_t size) {
+    return td::ObjectArena::allocate(size);
+  }
+
+  static void operator delete(void *ptr) {
+    td::ObjectArena::deallocate(ptr);
+  }
+
+  void check() const {
+    ASSERT_EQ(static_cast<size_t>(value_), data_.size());
+  }
+
+ private:
+  td::int64 value_;
+  td::string data_;
+};
+
+class BigArenaObject final : public ArenaObject {
+ public:
+  using ArenaObject::ArenaObject;
+
+ private:
+  char buf_[3000];
+};
+
+td::unique_ptr<ArenaObject> create_object(int value) {
+  if (td::Random::fast(0, 9) == 0) {
+    return td::make_unique<BigArenaObject>(value);
+  }
+  return td::make_unique<ArenaObject>(value);
+}
+
+}  // namespace
+
+TEST(ObjectArena, simple) {
+  td::vector<td::unique_ptr<ArenaObject>> objects;
+  objects.push_back(create_object(1));
+  {
+    td::ObjectArena::Guard guard;
+    for (int i = 0; i < 10000; i++) {
+      objects.push_back(create_object(i % 100));
+    }
+    {
+      td::ObjectArena::Guard nested_guard;
+      for (int i = 0; i < 100; i++) {
+        objects.push_back(create_object(i));
+      }
+    }
+    objects.push_back(create_object(2));
+  }
+  objects.push_back(create_object(3));
+  ASSERT_EQ(static_cast<int>(objects.size()), alive_object_count.load());
+
+  for (auto &object : objects) {
+    object->check();
+  }
+  td::Random::Xorshift128plus rnd(123);
+  td::random_shuffle(td::as_mutable_span(objects), rnd);
+  while (!objects.empty()) {
+    objects.pop_back();
+    if (!objects.empty()) {
+      objects.back()->check();
+    }
+  }
+  ASSERT_EQ(0, alive_object_count.load());
+}
+
+#if !TD_THREAD_UNSUPPORTED
+TEST(ObjectArena, threads) {
+  td::vector<td::vector<td::unique_ptr<ArenaObject>>> objects(4);
+  {
+    td::ObjectArena::Guard guard;
+    for (int i = 0; i < 10000; i++) {
+      objects[i % objects.size()].push_back(create_object(i % 100));
+    }
+  }
+
+  td::vector<td::thread> threads;
+  for (auto &thread_objects : objects) {
+    threads.emplace_back([&thread_objects] {
+      td::ObjectArena::Guard guard;
+      for (auto &object : thread_objects) {
+        object->check();
+        object = create_object(5);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  ASSERT_EQ(10000, alive_object_count.load());
+  objects.clear();
+  ASSERT_EQ(0, alive_object_count.load());
+}
+#endif
@@ -0,0 +1,79 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/common.h"
+#include "td/utils/JsonBuilder.h"
+#include "td/utils/tests.h"
+#include "td/utils/TraceRecorder.h"
+
+static td::vector<td::string> get_span_names() {
+  auto trace = td::TraceRecorder::export_chrome_trace();
+  auto r_value = td::json_decode(trace);
+  ASSERT_TRUE(r_value.is_ok());
+  auto value = r_value.move_as_ok();
+  ASSERT_TRUE(value.type() == td::JsonValue::Type::Object);
+  td::vector<td::string> result;
+  for (auto &field : value.get_object()) {
+    ASSERT_EQ("traceEvents", field.first);
+    ASSERT_TRUE(field.second.type() == td::JsonValue::Type::Array);
+    for (auto &event : field.second.get_array()) {
+      ASSERT_TRUE(event.type() == td::JsonValue::Type::Object);
+      for (auto &event_field : event.get_object()) {
+        if (event_field.first == "name") {
+          result.push_back(event_field.second.get_string().str());
+        }
+      }
+    }
+  }
+  return result;
+}
+
+TEST(TraceRecorder, simple) {
+  ASSERT_TRUE(!td::TraceRecorder::is_enabled());
+  {
+    td::TraceIdGuard guard(1);
+    td::TraceSpan span("disabled");
+  }
+  ASSERT_TRUE(get_span_names().empty());
+
+  td::TraceRecorder::set_max_span_count(3);
+  ASSERT_TRUE(td::TraceRecorder::is_enabled());
+  td::TraceRecorder::start_trace(1);
+  td::TraceRecorder::start_trace(2);
+  { td::TraceSpan span("without trace"); }
+  ASSERT_TRUE(get_span_names().empty());
+  {
+    td::TraceIdGuard guard(1);
+    ASSERT_EQ(1u, td::TraceRecorder::get_trace_id());
+    td::TraceSpan span("outer");
+    {
+      td::TraceIdGuard nested_guard(2);
+      td::TraceSpan nested_span("inner");
+    }
+    ASSERT_EQ(1u, td::TraceRecorder::get_trace_id());
+  }
+  ASSERT_EQ(0u, td::TraceRecorder::get_trace_id());
+  ASSERT_EQ((td::vector<td::string>{"inner", "outer"}), get_span_names());
+
+  td::TraceRecorder::add_span(3, "a", 1.0, 2.0);
+  td::TraceRecorder::add_span(3, "b\"", 2.0, 3.0);
+  ASSERT_EQ((td::vector<td::string>{"outer", "a", "b\""}), get_span_names());
+
+  td::TraceRecorder::finish_trace(2);
+  ASSERT_EQ(1u, td::TraceRecorder::get_active_trace_id(1));
+  ASSERT_EQ(0u, td::TraceRecorder::get_active_trace_id(2));
+  {
+    td::TraceIdGuard guard(2);
+    ASSERT_EQ(0u, td::TraceRecorder::get_trace_id());
+    td::TraceSpan span("finished");
+  }
+  ASSERT_EQ((td::vector<td::string>{"outer", "a", "b\""}), get_span_names());
+
+  td::TraceRecorder::set_max_span_count(0);
+  ASSERT_TRUE(!td::TraceRecorder::is_enabled());
+  ASSERT_TRUE(get_span_names().empty());
+  ASSERT_EQ(0u, td::TraceRecorder::get_active_trace_id(1));
+}
@@ -7,7 +7,10 @@
 #include "td/utils/tests.h"
 
 #include "td/utils/buffer.h"
+#include "td/utils/common.h"
 #include "td/utils/Random.h"
+#include "td/utils/tl_parsers.h"
+#include "td/utils/tl_storers.h"
 
 using namespace td;
 
@@ -56,3 +59,30 @@ TEST(Buffer, buffer_builder) {
     ASSERT_EQ(builder.extract().as_slice(), str);
   }
 }
+
+TEST(Buffer, tl_fetch_bytes) {
+  string long_bytes(100000, 'a');
+  string short_bytes("short");
+  auto store = [&](auto &storer) {
+    storer.store_int(123);
+    storer.store_string(long_bytes);
+    storer.store_string(short_bytes);
+  };
+  TlStorerCalcLength calc_length;
+  store(calc_length);
+  BufferSlice buffer(calc_length.get_length());
+  TlStorerUnsafe storer(buffer.as_slice().ubegin());
+  store(storer);
+
+  TlBufferParser parser(&buffer);
+  ASSERT_EQ(123, parser.fetch_int());
+  auto long_result = parser.fetch_string<BufferSlice>();
+  auto short_result = parser.fetch_string<BufferSlice>();
+  parser.fetch_end();
+  ASSERT_TRUE(parser.get_error() == nullptr);
+  ASSERT_EQ(long_bytes, long_result.as_slice());
+  ASSERT_EQ(short_bytes, short_result.as_slice());
+
+  // big bytes fields must share the parsed buffer instead of being copied
+  ASSERT_TRUE(long_result.as_slice().begin() == buffer.as_slice().begin() + 8);
+}
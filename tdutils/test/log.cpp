@@ -4,19 +4,26 @@
 // Distributed under the Boost Software License, Version 1.0. (See accompanying
 // file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 //
+#include "td/utils/AsyncFileLog.h"
 #include "td/utils/benchmark.h"
 #include "td/utils/FileLog.h"
+#include "td/utils/filesystem.h"
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
 #include "td/utils/MemoryLog.h"
+#include "td/utils/misc.h"
 #include "td/utils/port/path.h"
+#include "td/utils/port/sleep.h"
 #include "td/utils/port/thread.h"
 #include "td/utils/Slice.h"
+#include "td/utils/StringBuilder.h"
 #include "td/utils/tests.h"
+#include "td/utils/Time.h"
 #include "td/utils/TsFileLog.h"
 
 #include <functional>
 #include <limits>
+#include <set>
 
 char disable_linker_warning_about_empty_file_tdutils_test_log_cpp TD_UNUSED;
 
@@ -24,29 +31,34 @@ char disable_linker_warning_about_empty_file_tdutils_test_log_cpp TD_UNUSED;
 template <class Log>
 class LogBenchmark : public td::Benchmark {
  public:
-  LogBenchmark(std::string name, int threads_n, bool test_full_logging, std::function<td::unique_ptr<Log>()> creator)
+  LogBenchmark(std::string name, int threads_n, bool test_full_logging, bool defer_formatting,
+               std::function<td::unique_ptr<Log>()> creator)
       : name_(std::move(name))
       , threads_n_(threads_n)
       , test_full_logging_(test_full_logging)
+      , defer_formatting_(defer_formatting)
       , creator_(std::move(creator)) {
   }
   std::string get_description() const override {
-    return PSTRING() << name_ << " " << (test_full_logging_ ? "ERROR" : "PLAIN") << " "
-                     << td::tag("threads_n", threads_n_);
+    return PSTRING() << name_ << (defer_formatting_ ? " deferred " : " ") << (test_full_logging_ ? "ERROR" : "PLAIN")
+                     << " " << td::tag("threads_n", threads_n_);
   }
   void start_up() override {
     log_ = creator_();
     threads_.resize(threads_n_);
   }
   void tear_down() override {
-    for (auto path : log_->get_file_paths()) {
+    // the log must be destroyed first to write all pending messages
+    auto paths = log_->get_file_paths();
+    log_.reset();
+    for (auto &path : paths) {
       td::unlink(path).ignore();
     }
-    log_.reset();
   }
   void run(int n) override {
     auto old_log_interface = td::log_interface;
     td::log_interface = log_.get();
+    td::log_options.defer_formatting = defer_formatting_;
 
     for (auto &thread : threads_) {
       thread = td::thread([this, n] { this->run_thread(n); });
@@ -55,6 +67,7 @@ class LogBenchmark : public td::Benchmark {
       thread.join();
     }
 
+    td::log_options.defer_formatting = false;
     td::log_interface = old_log_interface;
   }
 
@@ -77,15 +90,17 @@ class LogBenchmark : public td::Benchmark {
   td::unique_ptr<td::LogInterface> log_;
   int threads_n_{0};
   bool test_full_logging_{false};
+  bool defer_formatting_{false};
   std::function<td::unique_ptr<Log>()> creator_;
   std::vector<td::thread> threads_;
 };
 
 template <class F>
-static void bench_log(std::string name, F &&f) {
+static void bench_log(std::string name, F &&f, bool defer_formatting = false) {
   for (auto test_full_logging : {false, true}) {
     for (auto threads_n : {1, 4, 8}) {
-      bench(LogBenchmark<typename decltype(f())::element_type>(name, threads_n, test_full_logging, f));
+      bench(LogBenchmark<typename decltype(f())::element_type>(name, threads_n, test_full_logging, defer_formatting,
+                                                               f));
     }
   }
 };
@@ -98,6 +113,15 @@ TEST(Log, Bench) {
   bench_log("TsFileLog",
             [] { return td::TsFileLog::create("tmplog", std::numeric_limits<td::int64>::max(), false).move_as_ok(); });
 
+  bench_log("AsyncFileLog", [] {
+    return td::AsyncFileLog::create("tmplog", std::numeric_limits<td::int64>::max(), false).move_as_ok();
+  });
+
+  bench_log(
+      "AsyncFileLog",
+      [] { return td::AsyncFileLog::create("tmplog", std::numeric_limits<td::int64>::max(), false).move_as_ok(); },
+      true);
+
   bench_log("FileLog + TsLog", [] {
     class FileLog : public td::LogInterface {
      public:
@@ -142,4 +166,126 @@ TEST(Log, Bench) {
     return td::make_unique<FileLog>();
   });
 }
+
+TEST(Log, AsyncFileLog) {
+  td::string path = "tmplog";
+  constexpr int THREAD_COUNT = 8;
+  constexpr int MESSAGE_COUNT = 10000;
+  {
+    auto log = td::AsyncFileLog::create(path, std::numeric_limits<td::int64>::max(), false).move_as_ok();
+    td::vector<td::thread> threads(THREAD_COUNT);
+    for (int i = 0; i < THREAD_COUNT; i++) {
+      threads[i] = td::thread([&log, i] {
+        for (int j = 0; j < MESSAGE_COUNT; j++) {
+          log->append(PSLICE() << i << ' ' << j << '\n', VERBOSITY_NAME(PLAIN));
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
+
+  auto lines = td::full_split(td::read_file_str(path).move_as_ok(), '\n');
+  td::unlink(path).ignore();
+  ASSERT_TRUE(!lines.empty() && lines.back().empty());
+  lines.pop_back();
+
+  // every message must be written exactly once or reported as dropped
+  std::set<td::string> messages;
+  size_t dropped_count = 0;
+  for (auto &line : lines) {
+    if (td::begins_with(line, "[AsyncFileLog] Dropped ")) {
+      dropped_count += td::to_integer<size_t>(td::split(td::Slice(line).substr(23)).first);
+    } else {
+      ASSERT_TRUE(messages.insert(line).second);
+    }
+  }
+  ASSERT_EQ(static_cast<size_t>(THREAD_COUNT * MESSAGE_COUNT), messages.size() + dropped_count);
+}
+
+TEST(Log, AsyncFileLogWakeUp) {
+  td::string path = "tmplog";
+  auto log = td::AsyncFileLog::create(path, std::numeric_limits<td::int64>::max(), false).move_as_ok();
+  for (int i = 0; i < 3; i++) {
+    // the writer thread is asleep, so it must be woken up by the message
+    td::usleep_for(20000);
+    td::string message = PSTRING() << "message " << i << '\n';
+    log->append(message, VERBOSITY_NAME(PLAIN));
+
+    auto end_time = td::Time::now() + 10;
+    while (!td::ends_with(td::read_file_str(path).move_as_ok(), message) && td::Time::now() < end_time) {
+      td::usleep_for(1000);
+    }
+    ASSERT_TRUE(td::ends_with(td::read_file_str(path).move_as_ok(), message));
+  }
+  log.reset();
+  td::unlink(path).ignore();
+}
 #endif
+
+TEST(Log, deferred_formatting) {
+  class StringLog : public td::LogInterface {
+   public:
+    void append(td::CSlice slice, int log_level) override {
+      messages.push_back(slice.str());
+    }
+    void append_deferred(td::Slice record, int log_level) override {
+      records.push_back(record.str());
+      LogInterface::append_deferred(record, log_level);
+    }
+
+    td::vector<td::string> messages;
+    td::vector<td::string> records;
+  };
+
+  enum Color { Red };
+  auto log_message = [](StringLog &log, bool add_info, bool defer_formatting) {
+    td::LogOptions options(VERBOSITY_NAME(DEBUG), true, add_info, defer_formatting);
+    td::string str = "string";
+    const char *c_str = "c_str";
+    char *mutable_c_str = &str[0];
+    td::Slice comment = "comment";
+    td::Logger::tag_ = "tag";
+    LOG_IMPL_FULL(log, options, ERROR, VERBOSITY_NAME(ERROR), true, comment)
+        << "literal " << str << ' ' << td::Slice(str) << ' ' << td::CSlice(str) << ' ' << c_str << ' ' << mutable_c_str
+        << ' ' << static_cast<signed char>('a') << static_cast<unsigned char>('b') << ' ' << true << ' '
+        << static_cast<td::int16>(-12) << ' ' << static_cast<td::uint16>(65535) << ' '
+        << std::numeric_limits<td::int64>::min() << ' ' << std::numeric_limits<td::uint64>::max() << ' ' << 1.5
+        << ' ' << 2.5f << ' ' << Red << ' ' << td::tag("key", 5) << ' '
+        << td::format::as_hex(255) << " end\n\n";
+    td::Logger::tag_ = nullptr;
+  };
+
+  for (auto add_info : {false, true}) {
+    StringLog log;
+    log_message(log, add_info, false);
+    log_message(log, add_info, true);
+    ASSERT_EQ(2u, log.messages.size());
+    ASSERT_EQ(add_info ? 1u : 0u, log.records.size());
+    ASSERT_TRUE(td::ends_with(log.messages[0], " end\n"));
+    if (add_info) {
+      // the messages differ only by the time
+      auto skip_time = [](td::Slice message) {
+        for (int i = 0; i < 3; i++) {
+          message = message.substr(message.find(']') + 1);
+        }
+        return message.str();
+      };
+      ASSERT_TRUE(td::begins_with(skip_time(log.messages[0]), "[log.cpp:"));
+      ASSERT_EQ(skip_time(log.messages[0]), skip_time(log.messages[1]));
+
+      // truncated records must be formatted partially
+      auto &record = log.records[0];
+      for (size_t i = 0; i <= record.size(); i++) {
+        td::StringBuilder sb;
+        auto message = td::format_deferred_log_record(td::Slice(record).substr(0, i), sb).str();
+        if (i == record.size()) {
+          ASSERT_EQ(log.messages[1], message);
+        }
+      }
+    } else {
+      ASSERT_EQ(log.messages[0], log.messages[1]);
+    }
+  }
+}
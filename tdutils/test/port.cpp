@@ -4,15 +4,22 @@
 // Distributed under the Boost Software License, Version 1.0. (See accompanying
 // file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 //
+#include "td/utils/BufferedFd.h"
 #include "td/utils/common.h"
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
 #include "td/utils/port/EventFd.h"
 #include "td/utils/port/FileFd.h"
 #include "td/utils/port/IoSlice.h"
+#include "td/utils/port/IPAddress.h"
 #include "td/utils/port/path.h"
+#include "td/utils/port/Poll.h"
+#include "td/utils/port/PollFlags.h"
+#include "td/utils/port/ServerSocketFd.h"
 #include "td/utils/port/signals.h"
+#include "td/utils/port/Stat.h"
 #include "td/utils/port/sleep.h"
+#include "td/utils/port/SocketFd.h"
 #include "td/utils/port/thread.h"
 #include "td/utils/port/thread_local.h"
 #include "td/utils/Random.h"
@@ -120,6 +127,26 @@ TEST(Port, SparseFiles) {
   td::unlink(path).ensure();
 }
 
+TEST(Port, HardLinks) {
+  td::CSlice path = "link_source.txt";
+  td::CSlice link_path = "link_target.txt";
+  td::unlink(path).ignore();
+  td::unlink(link_path).ignore();
+  auto fd = td::FileFd::open(path, td::FileFd::Write | td::FileFd::CreateNew).move_as_ok();
+  ASSERT_EQ(5u, fd.write("Hello").move_as_ok());
+  fd.close();
+  ASSERT_EQ(1u, td::stat(path).move_as_ok().link_count_);
+
+  td::link(path, link_path).ensure();
+  ASSERT_TRUE(td::link(path, link_path).is_error());
+  ASSERT_EQ(2u, td::stat(path).move_as_ok().link_count_);
+  ASSERT_EQ(5, td::stat(link_path).move_as_ok().size_);
+
+  td::unlink(path).ensure();
+  ASSERT_EQ(1u, td::stat(link_path).move_as_ok().link_count_);
+  td::unlink(link_path).ensure();
+}
+
 TEST(Port, Writev) {
   td::vector<td::IoSlice> vec;
   td::CSlice test_file_path = "test.txt";
@@ -143,6 +170,119 @@ TEST(Port, Writev) {
   ASSERT_EQ(expected_content, content);
 }
 
+TEST(Port, BufferedFdWrite) {
+  td::CSlice test_file_path = "test.txt";
+  td::unlink(test_file_path).ignore();
+  td::string expected_content;
+  {
+    td::BufferedFd<td::FileFd> fd(
+        td::FileFd::open(test_file_path, td::FileFd::Write | td::FileFd::CreateNew).move_as_ok());
+    fd.set_max_write_slices(3);
+    fd.set_zero_copy_threshold(10000);
+    for (int i = 0; i < 1000; i++) {
+      auto size = td::Random::fast(0, 3) == 0 ? td::Random::fast(0, 20000) : td::Random::fast(0, 300);
+      auto part = td::rand_string('a', 'z', size);
+      fd.output_buffer().append(part);
+      expected_content += part;
+      if (td::Random::fast(0, 10) == 0) {
+        fd.flush_write().ensure();
+      }
+    }
+    fd.flush_write().ensure();
+    ASSERT_EQ(0u, fd.left_unwritten());
+  }
+  auto fd = td::FileFd::open(test_file_path, td::FileFd::Read).move_as_ok();
+  ASSERT_EQ(static_cast<td::int64>(expected_content.size()), fd.get_size().ok());
+  td::string content(expected_content.size(), '\0');
+  ASSERT_EQ(content.size(), fd.read(content).move_as_ok());
+  ASSERT_TRUE(expected_content == content);
+  fd.close();
+  td::unlink(test_file_path).ensure();
+}
+
+TEST(Port, BufferedFdSocketWrite) {
+  td::ServerSocketFd server;
+  td::int32 port = 0;
+  for (int i = 0; i < 10 && port == 0; i++) {
+    auto server_port = td::Random::fast(20000, 60000);
+    auto r_server = td::ServerSocketFd::open(server_port, "127.0.0.1");
+    if (r_server.is_ok()) {
+      server = r_server.move_as_ok();
+      port = server_port;
+    }
+  }
+  if (port == 0) {
+    LOG(ERROR) << "Failed to open a server socket";
+    return;
+  }
+  td::IPAddress address;
+  address.init_ipv4_port("127.0.0.1", port).ensure();
+  td::BufferedFd<td::SocketFd> fd(td::SocketFd::open(address).move_as_ok());
+  fd.set_max_write_slices(3);
+  fd.set_zero_copy_threshold(10000);
+  auto status = fd.set_zero_copy(true);
+  LOG_IF(INFO, status.is_error()) << "Zero-copy sends are unsupported: " << status;
+  bool is_zero_copy_enabled = status.is_ok();
+  ASSERT_EQ(is_zero_copy_enabled, fd.is_zero_copy_enabled());
+
+  td::SocketFd accepted;
+  for (int i = 0; i < 1000 && accepted.empty(); i++) {
+    server.get_poll_info().add_flags(td::PollFlags::Read());
+    auto r_socket = server.accept();
+    if (r_socket.is_ok()) {
+      accepted = r_socket.move_as_ok();
+    } else {
+      td::usleep_for(1000);
+    }
+  }
+  ASSERT_TRUE(!accepted.empty());
+
+  td::string expected_content;
+  for (int i = 0; i < 300; i++) {
+    auto size = td::Random::fast(0, 3) == 0 ? td::Random::fast(0, 100000) : td::Random::fast(0, 300);
+    auto part = td::rand_string('a', 'z', size);
+    fd.output_buffer().append(part);
+    expected_content += part;
+  }
+
+  td::string content;
+  td::string buf(1 << 16, '\0');
+  auto end_time = td::Time::now() + 10;
+  while (content.size() < expected_content.size() || fd.get_zero_copy_pending_count() != 0) {
+    ASSERT_TRUE(td::Time::now() < end_time);
+    fd.get_poll_info().add_flags(td::PollFlags::Write() | td::PollFlags::Error());
+    fd.get_pending_error().ensure();  // processes zero-copy completions
+    fd.flush_write().ensure();
+    accepted.get_poll_info().add_flags(td::PollFlags::Read());
+    auto read_size = accepted.read(buf).move_as_ok();
+    content.append(buf, 0, read_size);
+    if (read_size == 0) {
+      td::usleep_for(100);
+    }
+  }
+  ASSERT_EQ(0u, fd.left_unwritten());
+  ASSERT_TRUE(expected_content == content);
+}
+
+#if TD_POLL_EPOLL
+TEST(Port, BusyPollTimeout) {
+  td::Poll poll;
+  poll.init();
+  poll.set_busy_poll_time(10.0);
+
+  auto start_time = td::Time::now();
+  poll.run(0);
+  ASSERT_TRUE(td::Time::now() - start_time < 1.0);
+
+  start_time = td::Time::now();
+  poll.run(20);
+  auto passed_time = td::Time::now() - start_time;
+  ASSERT_TRUE(passed_time >= 0.019);
+  ASSERT_TRUE(passed_time < 1.0);
+  poll.clear();
+}
+#endif
+
 #if TD_PORT_POSIX && !TD_THREAD_UNSUPPORTED
 
 static std::mutex m;
@@ -0,0 +1,486 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/DialogId.h"
+#include "td/telegram/files/FileContentStore.h"
+#include "td/telegram/files/FileGcQueue.h"
+#include "td/telegram/files/FileIoService.h"
+#include "td/telegram/files/FileStats.h"
+#include "td/telegram/files/FileTable.h"
+#include "td/telegram/files/FileType.h"
+#include "td/telegram/UserId.h"
+
+#include "td/actor/actor.h"
+#include "td/actor/PromiseFuture.h"
+
+#include "td/utils/buffer.h"
+#include "td/utils/CancellationToken.h"
+#include "td/utils/common.h"
+#include "td/utils/crypto.h"
+#include "td/utils/filesystem.h"
+#include "td/utils/logging.h"
+#include "td/utils/port/FileFd.h"
+#include "td/utils/port/path.h"
+#include "td/utils/port/Stat.h"
+#include "td/utils/Random.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Status.h"
+#include "td/utils/tests.h"
+#include "td/utils/tl_helpers.h"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+REGISTER_TESTS(files);
+
+using namespace td;
+
+static void test_file_io_service(int32 thread_count) {
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+  string path = "file_io_service_test";
+  string moved_path = "file_io_service_test_moved";
+  unlink(path).ignore();
+  unlink(moved_path).ignore();
+
+  constexpr size_t PART_SIZE = 1 << 12;
+  constexpr int32 PART_COUNT = 16;
+  string content = rand_string('a', 'z', PART_SIZE * PART_COUNT);
+  string expected_hash(32, ' ');
+  sha256(Slice(content).substr(PART_SIZE, 2 * PART_SIZE), expected_hash);
+
+  ConcurrentScheduler sched;
+  sched.init(0);
+  ActorOwn<FileIoService> service;
+  std::shared_ptr<FileFd> fd;
+  int32 pending_count = 0;
+  auto on_finished = [&pending_count] {
+    pending_count--;
+  };
+  auto wait_pending = [&] {
+    while (pending_count > 0) {
+      sched.run_main(0.1);
+    }
+  };
+
+  // all parts are written concurrently through the same file descriptor
+  {
+    auto guard = sched.get_main_guard();
+    service = create_actor<FileIoService>("FileIoService", thread_count);
+    fd = std::make_shared<FileFd>(FileFd::open(path, FileFd::Create | FileFd::Read | FileFd::Write).move_as_ok());
+    pending_count = PART_COUNT;
+    for (int32 i = PART_COUNT - 1; i >= 0; i--) {
+      auto offset = static_cast<size_t>(i) * PART_SIZE;
+      send_closure(service, &FileIoService::write, fd, static_cast<int64>(offset),
+                   BufferSlice(Slice(content).substr(offset, PART_SIZE)),
+                   PromiseCreator::lambda([&](Result<size_t> r_written) {
+                     ASSERT_EQ(PART_SIZE, r_written.ok());
+                     on_finished();
+                   }));
+    }
+  }
+  sched.start();
+  wait_pending();
+
+  // the file descriptor stays valid after the caller releases it and the file is renamed
+  {
+    auto guard = sched.get_main_guard();
+    auto r_content = read_file_str(path);
+    ASSERT_TRUE(r_content.ok() == content);
+    rename(path, moved_path).ensure();
+
+    pending_count = 4;
+    send_closure(service, &FileIoService::read, fd, static_cast<int64>(PART_SIZE), 2 * PART_SIZE,
+                 PromiseCreator::lambda([&](Result<BufferSlice> r_bytes) {
+                   ASSERT_TRUE(r_bytes.ok().as_slice() == Slice(content).substr(PART_SIZE, 2 * PART_SIZE));
+                   on_finished();
+                 }));
+    send_closure(service, &FileIoService::read, fd, static_cast<int64>(content.size() - 10), PART_SIZE,
+                 PromiseCreator::lambda([&](Result<BufferSlice> r_bytes) {
+                   ASSERT_TRUE(r_bytes.ok().as_slice() == Slice(content).substr(content.size() - 10));
+                   on_finished();
+                 }));
+    send_closure(service, &FileIoService::compute_sha256, fd, static_cast<int64>(PART_SIZE), 2 * PART_SIZE,
+                 PromiseCreator::lambda([&](Result<string> r_hash) {
+                   ASSERT_TRUE(r_hash.ok() == expected_hash);
+                   on_finished();
+                 }));
+    send_closure(service, &FileIoService::compute_sha256, fd, static_cast<int64>(content.size() - 10), PART_SIZE,
+                 PromiseCreator::lambda([&](Result<string> r_hash) {
+                   ASSERT_TRUE(r_hash.is_error());
+                   on_finished();
+                 }));
+    fd.reset();
+  }
+  wait_pending();
+
+  {
+    auto guard = sched.get_main_guard();
+    service.reset();
+  }
+  sched.finish();
+  unlink(moved_path).ignore();
+}
+
+static void test_file_io_service_file_sha256(int32 thread_count) {
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+  string path = "file_io_service_sha256_test";
+  unlink(path).ignore();
+
+  // the file is bigger than a slice, so it is hashed in several runs of the job
+  string content = rand_string('a', 'z', (1 << 24) + 12345);
+  write_file(path, content).ensure();
+  string expected_hash(32, ' ');
+  sha256(content, expected_hash);
+  auto size = static_cast<int64>(content.size());
+
+  ConcurrentScheduler sched;
+  sched.init(0);
+  ActorOwn<FileIoService> service;
+  int32 pending_count = 3;
+  CancellationTokenSource cancellation_token_source;
+  auto cancellation_token = cancellation_token_source.get_cancellation_token();
+  cancellation_token_source.cancel();
+  {
+    auto guard = sched.get_main_guard();
+    service = create_actor<FileIoService>("FileIoService", thread_count);
+    send_closure(service, &FileIoService::compute_file_sha256, path, size, CancellationToken(),
+                 PromiseCreator::lambda([&](Result<string> r_hash) {
+                   ASSERT_TRUE(r_hash.ok() == expected_hash);
+                   pending_count--;
+                 }));
+    send_closure(service, &FileIoService::compute_file_sha256, path, size + 1, CancellationToken(),
+                 PromiseCreator::lambda([&](Result<string> r_hash) {
+                   ASSERT_TRUE(r_hash.is_error());
+                   pending_count--;
+                 }));
+    send_closure(service, &FileIoService::compute_file_sha256, path, size, std::move(cancellation_token),
+                 PromiseCreator::lambda([&](Result<string> r_hash) {
+                   ASSERT_TRUE(r_hash.is_error());
+                   pending_count--;
+                 }));
+  }
+  sched.start();
+  while (pending_count > 0) {
+    sched.run_main(0.1);
+  }
+
+  {
+    auto guard = sched.get_main_guard();
+    service.reset();
+  }
+  sched.finish();
+  unlink(path).ignore();
+}
+
+TEST(Files, FileContentStore) {
+  string dir = PSTRING() << "file_content_store_test" << TD_DIR_SLASH;
+  string content_dir = PSTRING() << dir << "content" << TD_DIR_SLASH;
+  rmrf(dir).ignore();
+  mkdir(dir).ensure();
+
+  string content = rand_string('a', 'z', static_cast<size_t>(MIN_DEDUPLICATED_FILE_SIZE));
+  string hash(32, ' ');
+  sha256(content, hash);
+
+  // the same content is downloaded twice
+  string first_path = dir + "first";
+  write_file(first_path, content).ensure();
+  auto first_mtime = deduplicate_file(content_dir, first_path, stat(first_path).ok(), hash).move_as_ok();
+  ASSERT_EQ(stat(first_path).ok().mtime_nsec_, first_mtime);
+
+  string second_path = dir + "second";
+  write_file(second_path, content).ensure();
+  auto second_mtime = deduplicate_file(content_dir, second_path, stat(second_path).ok(), hash).move_as_ok();
+  // the second file is replaced with a link to the stored content and the returned modification time is valid for it
+  ASSERT_EQ(first_mtime, second_mtime);
+  ASSERT_EQ(stat(second_path).ok().mtime_nsec_, second_mtime);
+  ASSERT_EQ(3u, stat(second_path).ok().link_count_);
+
+  // repeated deduplication changes nothing
+  ASSERT_EQ(second_mtime, deduplicate_file(content_dir, second_path, stat(second_path).ok(), hash).move_as_ok());
+  ASSERT_EQ(3u, stat(first_path).ok().link_count_);
+  auto wrong_stat = stat(second_path).ok();
+  wrong_stat.size_++;
+  ASSERT_TRUE(deduplicate_file(content_dir, second_path, wrong_stat, hash).is_error());
+
+  // the file is rewritten with the same size after it was hashed
+  string third_path = dir + "third";
+  write_file(third_path, content).ensure();
+  auto third_stat = stat(third_path).ok();
+  string new_path = dir + "new";
+  write_file(new_path, rand_string('a', 'z', content.size())).ensure();
+  rename(new_path, third_path).ensure();
+  ASSERT_TRUE(deduplicate_file(content_dir, third_path, third_stat, hash).is_error());
+  ASSERT_EQ(1u, stat(third_path).ok().link_count_);
+  unlink(third_path).ensure();
+
+  ASSERT_TRUE(read_file_str(first_path).ok() == content);
+  ASSERT_TRUE(read_file_str(second_path).ok() == content);
+
+  // removal of one of the files doesn't affect the other
+  unlink(first_path).ensure();
+  ASSERT_TRUE(read_file_str(second_path).ok() == content);
+  ASSERT_EQ(second_mtime, stat(second_path).ok().mtime_nsec_);
+
+  // the content is removed only after all files referencing it are removed
+  auto content_paths = get_file_content_paths(content_dir);
+  ASSERT_EQ(1u, content_paths.size());
+  ASSERT_TRUE(!remove_file_content_if_unused(content_paths[0]));
+  unlink(second_path).ensure();
+  ASSERT_TRUE(remove_file_content_if_unused(content_paths[0]));
+  ASSERT_TRUE(get_file_content_paths(content_dir).empty());
+  rmrf(dir).ignore();
+}
+
+TEST(Files, FileIoService) {
+  test_file_io_service(2);
+}
+
+TEST(Files, FileIoServiceWithoutThreads) {
+  test_file_io_service(0);
+}
+
+TEST(Files, FileIoServiceFileSha256) {
+  test_file_io_service_file_sha256(2);
+  test_file_io_service_file_sha256(0);
+}
+
+TEST(Files, FileIoServiceDeduplicateFile) {
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+  string dir = PSTRING() << "file_io_service_deduplicate_test" << TD_DIR_SLASH;
+  string content_dir = PSTRING() << dir << "content" << TD_DIR_SLASH;
+  rmrf(dir).ignore();
+  mkdir(dir).ensure();
+
+  string content = rand_string('a', 'z', static_cast<size_t>(MIN_DEDUPLICATED_FILE_SIZE));
+  string first_path = dir + "first";
+  string second_path = dir + "second";
+  write_file(first_path, content).ensure();
+  write_file(second_path, content).ensure();
+  auto size = static_cast<int64>(content.size());
+
+  ConcurrentScheduler sched;
+  sched.init(0);
+  ActorOwn<FileIoService> service;
+  int32 pending_count = 1;
+  uint64 first_mtime = 0;
+  {
+    auto guard = sched.get_main_guard();
+    service = create_actor<FileIoService>("FileIoService", 2);
+    send_closure(service, &FileIoService::deduplicate_file, content_dir, first_path, size, CancellationToken(),
+                 PromiseCreator::lambda([&](Result<uint64> r_mtime_nsec) {
+                   first_mtime = r_mtime_nsec.move_as_ok();
+                   pending_count--;
+                 }));
+  }
+  sched.start();
+  while (pending_count > 0) {
+    sched.run_main(0.1);
+  }
+  ASSERT_EQ(stat(first_path).ok().mtime_nsec_, first_mtime);
+
+  // the second file is replaced with a link to the content of the first file
+  pending_count = 1;
+  {
+    auto guard = sched.get_main_guard();
+    send_closure(service, &FileIoService::deduplicate_file, content_dir, second_path, size, CancellationToken(),
+                 PromiseCreator::lambda([&](Result<uint64> r_mtime_nsec) {
+                   ASSERT_EQ(first_mtime, r_mtime_nsec.ok());
+                   pending_count--;
+                 }));
+  }
+  while (pending_count > 0) {
+    sched.run_main(0.1);
+  }
+  ASSERT_EQ(3u, stat(second_path).ok().link_count_);
+  ASSERT_TRUE(read_file_str(second_path).ok() == content);
+
+  {
+    auto guard = sched.get_main_guard();
+    service.reset();
+  }
+  sched.finish();
+  rmrf(dir).ignore();
+}
+
+TEST(Files, FileIoServiceSharedPool) {
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+  string path = "file_io_service_shared_pool_test";
+  string content = rand_string('a', 'z', (1 << 24) + 12345);
+  write_file(path, content).ensure();
+  string expected_hash(32, ' ');
+  sha256(content, expected_hash);
+  auto size = static_cast<int64>(content.size());
+
+  ConcurrentScheduler sched;
+  sched.init(0);
+  ActorOwn<FileIoService> closed_service;
+  ActorOwn<FileIoService> service;
+  int32 pending_count = 1;
+  int32 closed_count = 0;
+  {
+    auto guard = sched.get_main_guard();
+    closed_service = create_actor<FileIoService>("FileIoService", 1);
+    service = create_actor<FileIoService>("FileIoService", 1);
+    for (int i = 0; i < 10; i++) {
+      send_closure(closed_service, &FileIoService::compute_file_sha256, path, size, CancellationToken(),
+                   PromiseCreator::lambda([&](Result<string> r_hash) {
+                     ASSERT_TRUE(r_hash.is_error());
+                     closed_count++;
+                   }));
+    }
+    send_closure(service, &FileIoService::compute_file_sha256, path, size, CancellationToken(),
+                 PromiseCreator::lambda([&](Result<string> r_hash) {
+                   ASSERT_TRUE(r_hash.ok() == expected_hash);
+                   pending_count--;
+                 }));
+  }
+  sched.start();
+  sched.run_main(0.01);
+
+  // jobs of a closed service don't delay jobs of other services, which use the same worker thread
+  {
+    auto guard = sched.get_main_guard();
+    closed_service.reset();
+  }
+  while (pending_count > 0) {
+    sched.run_main(0.1);
+  }
+  ASSERT_EQ(10, closed_count);
+
+  {
+    auto guard = sched.get_main_guard();
+    service.reset();
+  }
+  sched.finish();
+  unlink(path).ignore();
+}
+
+static void check_file_type_stat(const FileStats::StatByType &stat_by_type, FileType file_type, int64 size,
+                                 int32 cnt) {
+  auto &stat = stat_by_type[static_cast<size_t>(file_type)];
+  ASSERT_EQ(size, stat.size);
+  ASSERT_EQ(cnt, stat.cnt);
+}
+
+TEST(Files, FileStatsIndex) {
+  DialogId first_dialog_id(UserId(1));
+  DialogId second_dialog_id(UserId(2));
+
+  FileStats stats;
+  stats.split_by_owner_dialog_id = true;
+  stats.add(FullFileInfo{FileType::Photo, "a", first_dialog_id, 100, 0, 0});
+  stats.add(FullFileInfo{FileType::Photo, "b", first_dialog_id, 200, 0, 0});
+  stats.add(FullFileInfo{FileType::Video, "c", second_dialog_id, 1000, 0, 0});
+
+  FileStatsIndex index;
+  ASSERT_EQ(0u, index.get_date());
+  index.reset(stats, 123);
+  ASSERT_EQ(123u, index.get_date());
+
+  index.add(first_dialog_id, FileType::Photo, 50, 1);
+  index.add(second_dialog_id, FileType::Video, -1000, -1);
+  // file types are attributed to the main file type of their directory
+  index.add(second_dialog_id, FileType::DocumentAsFile, 10, 1);
+  // removal of unknown files doesn't make sizes negative
+  index.add(second_dialog_id, FileType::Audio, -10, -1);
+
+  auto check_index = [&](const FileStatsIndex &index) {
+    auto split_stats = index.get_file_stats(true);
+    ASSERT_TRUE(split_stats.split_by_owner_dialog_id);
+    ASSERT_EQ(2u, split_stats.stat_by_owner_dialog_id.size());
+    check_file_type_stat(split_stats.stat_by_owner_dialog_id[first_dialog_id], FileType::Photo, 350, 3);
+    check_file_type_stat(split_stats.stat_by_owner_dialog_id[second_dialog_id], FileType::Video, 0, 0);
+    check_file_type_stat(split_stats.stat_by_owner_dialog_id[second_dialog_id], FileType::Document, 10, 1);
+    check_file_type_stat(split_stats.stat_by_owner_dialog_id[second_dialog_id], FileType::Audio, 0, 0);
+
+    auto total_stats = index.get_file_stats(false);
+    ASSERT_TRUE(!total_stats.split_by_owner_dialog_id);
+    check_file_type_stat(total_stats.stat_by_type, FileType::Photo, 350, 3);
+    check_file_type_stat(total_stats.stat_by_type, FileType::Document, 10, 1);
+    check_file_type_stat(total_stats.stat_by_type, FileType::DocumentAsFile, 0, 0);
+  };
+  check_index(index);
+
+  FileStatsIndex parsed_index;
+  unserialize(parsed_index, serialize(index)).ensure();
+  ASSERT_EQ(123u, parsed_index.get_date());
+  check_index(parsed_index);
+
+  // statistics, which aren't split by owner dialog, are kept for the empty dialog
+  FileStats total_stats;
+  total_stats.add(FullFileInfo{FileType::Photo, "a", first_dialog_id, 100, 0, 0});
+  index.reset(total_stats, 124);
+  auto split_stats = index.get_file_stats(true);
+  ASSERT_EQ(1u, split_stats.stat_by_owner_dialog_id.size());
+  check_file_type_stat(split_stats.stat_by_owner_dialog_id[DialogId()], FileType::Photo, 100, 1);
+}
+
+TEST(Files, FileGcQueue) {
+  auto create_file = [](int32 i, int64 size) {
+    return FullFileInfo{FileType::Photo, PSTRING() << "file" << i, DialogId(), size, static_cast<uint64>(i), 0};
+  };
+  vector<FullFileInfo> expired_files{create_file(-1, 1000), create_file(-2, 1000)};
+  vector<FullFileInfo> files;
+  for (int32 i = 0; i < 10; i++) {
+    files.push_back(create_file(i * 7 % 10, 10));
+  }
+
+  // 3 files are over the count limit and 2 more files are over the size limit
+  FileGcQueue queue(std::move(expired_files), std::move(files), 7, 50);
+  vector<std::pair<uint64, FileGcQueue::Reason>> removed_files;
+  FullFileInfo file;
+  FileGcQueue::Reason reason;
+  // files are removed in slices; the queue state is kept between them
+  for (int32 i = 0; i < 3; i++) {
+    ASSERT_TRUE(queue.pop(file, reason));
+    removed_files.emplace_back(file.atime_nsec, reason);
+  }
+  while (queue.pop(file, reason)) {
+    removed_files.emplace_back(file.atime_nsec, reason);
+  }
+  ASSERT_EQ(7u, removed_files.size());
+  ASSERT_TRUE(removed_files[0].second == FileGcQueue::Reason::Expired);
+  ASSERT_TRUE(removed_files[1].second == FileGcQueue::Reason::Expired);
+  for (size_t i = 2; i < removed_files.size(); i++) {
+    ASSERT_EQ(static_cast<uint64>(i - 2), removed_files[i].first);
+    ASSERT_TRUE(removed_files[i].second == (i < 5 ? FileGcQueue::Reason::Count : FileGcQueue::Reason::Size));
+  }
+  ASSERT_TRUE(!queue.pop(file, reason));
+
+  auto kept_files = queue.extract_kept_files();
+  ASSERT_EQ(5u, kept_files.size());
+  std::sort(kept_files.begin(), kept_files.end(),
+            [](const FullFileInfo &lhs, const FullFileInfo &rhs) { return lhs.atime_nsec < rhs.atime_nsec; });
+  for (size_t i = 0; i < kept_files.size(); i++) {
+    ASSERT_EQ(static_cast<uint64>(i + 5), kept_files[i].atime_nsec);
+  }
+
+  // files under the limits aren't removed
+  FileGcQueue small_queue({}, {create_file(1, 10), create_file(2, 10)}, 2, 20);
+  ASSERT_TRUE(!small_queue.pop(file, reason));
+  ASSERT_EQ(2u, small_queue.extract_kept_files().size());
+}
+
+TEST(Files, FileTable) {
+  // slots 0..9, where the zero slot is reserved and slots 3, 5, 8 and 9 were freed
+  vector<int32> table(10, 1);
+  vector<int32> empty_ids{9, 3, 8, 5};
+  auto stats = get_file_table_stats(table, empty_ids);
+  ASSERT_EQ(5, stats.live_slot_count);
+  ASSERT_EQ(4, stats.free_slot_count);
+
+  // only the free slots at the end of the table are removed
+  compact_file_table(table, empty_ids);
+  ASSERT_EQ(8u, table.size());
+  ASSERT_EQ(2u, empty_ids.size());
+  // the least free identifier is reused first
+  ASSERT_EQ(3, empty_ids.back());
+  stats = get_file_table_stats(table, empty_ids);
+  ASSERT_EQ(5, stats.live_slot_count);
+  ASSERT_EQ(2, stats.free_slot_count);
+}
@@ -0,0 +1,86 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/LanguageStrings.h"
+
+#include "td/utils/common.h"
+#include "td/utils/logging.h"
+#include "td/utils/Random.h"
+#include "td/utils/Slice.h"
+#include "td/utils/tests.h"
+
+#include <map>
+#include <memory>
+#include <utility>
+
+REGISTER_TESTS(language_strings);
+
+using namespace td;
+
+static void check_language_strings(const LanguageStrings &strings, const std::map<string, string> &expected) {
+  for (auto &it : expected) {
+    ASSERT_EQ(it.second, strings.get_value(it.first));
+  }
+  ASSERT_TRUE(strings.get_value("unknown_key").empty());
+
+  auto it = expected.begin();
+  strings.for_each([&](Slice key, Slice value) {
+    ASSERT_TRUE(it != expected.end());
+    ASSERT_EQ(it->first, key);
+    ASSERT_EQ(it->second, value);
+    ++it;
+  });
+  ASSERT_TRUE(it == expected.end());
+}
+
+TEST(LanguageStrings, partial_loads) {
+  auto strings = std::make_shared<const LanguageStrings>();
+  std::map<string, string> expected;
+  size_t max_overlay_size = 0;
+  for (int i = 0; i < 3000; i++) {
+    string key = PSTRING() << "key" << Random::fast(0, 999);
+    string value = Random::fast(0, 9) == 0 ? string("3") : PSTRING() << '1' << "value" << i;
+    vector<std::pair<string, string>> changes;
+    changes.emplace_back(key, value);
+    if (i % 100 == 0) {
+      // several changes of the same key in one batch; the last one must win
+      changes.emplace_back(key, "1last");
+      value = "1last";
+    }
+    expected[key] = value;
+
+    strings = LanguageStrings::apply_changes(*strings, std::move(changes), false);
+    ASSERT_TRUE(!strings->is_full());
+    max_overlay_size = max(max_overlay_size, strings->get_overlay_size());
+    if (i % 250 == 0) {
+      check_language_strings(*strings, expected);
+    }
+  }
+  check_language_strings(*strings, expected);
+
+  // the overlay must stay small, otherwise every partial load copies a lot of strings
+  ASSERT_TRUE(max_overlay_size <= 64);
+  ASSERT_TRUE(max_overlay_size > 1);
+
+  // deleted strings are dropped only from a full language
+  vector<std::pair<string, string>> changes;
+  changes.emplace_back("new_key", "1new_value");
+  expected["new_key"] = "1new_value";
+  auto full_strings = LanguageStrings::apply_changes(*strings, std::move(changes), true);
+  ASSERT_TRUE(full_strings->is_full());
+  ASSERT_EQ(0u, full_strings->get_overlay_size());
+  std::map<string, string> expected_full;
+  for (auto &it : expected) {
+    if (!LanguageStrings::is_deleted_value(it.second)) {
+      expected_full.insert(it);
+    }
+  }
+  check_language_strings(*full_strings, expected_full);
+
+  // the old snapshot isn't modified
+  expected.erase("new_key");
+  check_language_strings(*strings, expected);
+}
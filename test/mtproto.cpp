@@ -8,6 +8,8 @@
 #include "td/telegram/net/DcId.h"
 #include "td/telegram/net/PublicRsaKeyShared.h"
 #include "td/telegram/net/Session.h"
+#include "td/telegram/net/SessionBalancer.h"
+#include "td/telegram/net/SessionConnectionChooser.h"
 #include "td/telegram/NotificationManager.h"
 
 #include "td/mtproto/AuthData.h"
@@ -40,6 +42,8 @@
 #include "td/utils/tests.h"
 #include "td/utils/Time.h"
 
+#include <map>
+
 REGISTER_TESTS(mtproto);
 
 using namespace td;
@@ -708,3 +712,97 @@ TEST(Mtproto, TlsTransport) {
   }
   sched.finish();
 }
+
+TEST(Mtproto, SessionConnectionChooser) {
+  const size_t big_size = SessionConnectionChooser::BIG_QUERY_SIZE;
+  auto all_ready = [](int8 connection_id) {
+    return true;
+  };
+
+  // the main connection, the long poll connection and 3 additional connections
+  SessionConnectionChooser chooser(5);
+  ASSERT_EQ(0, chooser.choose(100, false, all_ready));
+  ASSERT_EQ(0, chooser.choose(big_size, true, all_ready));
+  ASSERT_EQ(100 + big_size, chooser.get_in_flight_size(0));
+
+  // big queries are spread evenly and never go to the long poll connection
+  std::map<int8, size_t> sizes;
+  for (int i = 0; i < 40; i++) {
+    sizes[chooser.choose(big_size, false, all_ready)] += big_size;
+  }
+  ASSERT_EQ(0u, sizes.count(1));
+  ASSERT_EQ(4u, sizes.size());
+  for (int8 connection_id : {0, 2, 3, 4}) {
+    ASSERT_TRUE(chooser.get_in_flight_size(connection_id) >= 10 * big_size);
+    ASSERT_TRUE(chooser.get_in_flight_size(connection_id) <= 11 * big_size + 100);
+  }
+
+  // connections, which aren't ready, aren't chosen
+  SessionConnectionChooser other_chooser(5);
+  for (int i = 0; i < 10; i++) {
+    auto connection_id = other_chooser.choose(big_size, false, [](int8 connection_id) { return connection_id == 3; });
+    ASSERT_TRUE(connection_id == 0 || connection_id == 3);
+  }
+  ASSERT_EQ(5 * big_size, other_chooser.get_in_flight_size(3));
+
+  // unacknowledged queries are taken into account
+  SessionConnectionChooser loaded_chooser(4);
+  loaded_chooser.add_in_flight_query(0, 10 * big_size);
+  loaded_chooser.add_in_flight_query(2, 5 * big_size);
+  for (int i = 0; i < 5; i++) {
+    ASSERT_EQ(3, loaded_chooser.choose(big_size, false, all_ready));
+  }
+  ASSERT_EQ(2, loaded_chooser.choose(big_size, false, all_ready));
+  loaded_chooser.add_in_flight_query(7, big_size);
+  ASSERT_EQ(0u, loaded_chooser.get_in_flight_size(7));
+}
+
+TEST(Mtproto, SessionBalancer) {
+  const size_t unit = static_cast<size_t>(SessionBalancer::QUERY_SIZE_UNIT);
+  SessionBalancer balancer(4, 0.0);
+  ASSERT_EQ(4, balancer.get_session_count());
+  ASSERT_EQ(1, balancer.get_active_session_count());
+
+  // the number of active sessions grows with the load
+  for (int i = 0; i < SessionBalancer::GROW_SESSION_LOAD; i++) {
+    ASSERT_EQ(0, balancer.choose_session(100));
+    balancer.on_query_sent(0, 100);
+    ASSERT_EQ(i + 1 == SessionBalancer::GROW_SESSION_LOAD, balancer.update_active_session_count(1.0));
+  }
+  ASSERT_EQ(2, balancer.get_active_session_count());
+  ASSERT_EQ(1, balancer.choose_session(100));
+
+  // big queries count as several queries
+  balancer.on_query_sent(1, 7 * unit);
+  ASSERT_EQ(7, balancer.get_session_load(1).queries_size / SessionBalancer::QUERY_SIZE_UNIT);
+  ASSERT_EQ(1, balancer.choose_session(100));
+  balancer.on_query_sent(1, unit);
+  ASSERT_EQ(0, balancer.choose_session(100));
+
+  // a session with lower RTT gets more queries
+  balancer.on_rtt_updated(1, 0.01);
+  ASSERT_TRUE(balancer.get_session_load(1).rtt == 0.01);
+  ASSERT_EQ(1, balancer.choose_session(100));
+  balancer.on_rtt_updated(1, 0.0);
+  ASSERT_TRUE(balancer.get_session_load(1).rtt == 0.01);
+  balancer.on_rtt_updated(1, 1.01);
+  auto rtt = balancer.get_session_load(1).rtt;
+  ASSERT_TRUE(0.2099 < rtt && rtt < 0.2101);
+  ASSERT_EQ(0, balancer.choose_session(100));
+
+  // the number of active sessions shrinks only after SHRINK_DELAY of low load
+  for (int i = 0; i < SessionBalancer::GROW_SESSION_LOAD; i++) {
+    balancer.on_query_finished(0, 100);
+  }
+  balancer.on_query_finished(1, 7 * unit);
+  balancer.on_query_finished(1, unit);
+  ASSERT_EQ(0, balancer.get_session_load(1).queries_count);
+  ASSERT_EQ(0, balancer.get_session_load(1).queries_size);
+  ASSERT_TRUE(!balancer.can_close_inactive_sessions(1.0 + SessionBalancer::SHRINK_DELAY / 2));
+  ASSERT_TRUE(!balancer.update_active_session_count(1.0 + SessionBalancer::SHRINK_DELAY / 2));
+  ASSERT_EQ(2, balancer.get_active_session_count());
+  ASSERT_TRUE(balancer.update_active_session_count(2.0 + SessionBalancer::SHRINK_DELAY));
+  ASSERT_EQ(1, balancer.get_active_session_count());
+  ASSERT_TRUE(!balancer.can_close_inactive_sessions(3.0 + SessionBalancer::SHRINK_DELAY));
+  ASSERT_TRUE(balancer.can_close_inactive_sessions(3.0 + 2 * SessionBalancer::SHRINK_DELAY));
+}
@@ -8,7 +8,10 @@
 
 #include "td/telegram/Client.h"
 #include "td/telegram/ClientActor.h"
+#include "td/telegram/files/FileBitmask.h"
+#include "td/telegram/files/FileExtentMap.h"
 #include "td/telegram/files/PartsManager.h"
+#include "td/telegram/files/TransferEstimator.h"
 #include "td/telegram/td_api.h"
 
 #include "td/actor/actor.h"
@@ -36,6 +39,7 @@
 #include <map>
 #include <memory>
 #include <mutex>
+#include <queue>
 #include <set>
 #include <utility>
 
@@ -1184,3 +1188,105 @@ TEST(PartsManager, hands) {
     pm.init(1, 100000, true, 10, {0, 1, 2}, false, true).ensure_error();
   }
 }
+
+TEST(FileExtentMap, random) {
+  for (int t = 0; t < 100; t++) {
+    td::int64 part_size = td::Random::fast(1, 5);
+    td::int64 part_count = td::Random::fast(0, 100);
+    td::int64 file_size = td::Random::fast(0, 1) == 0 ? 0 : td::Random::fast(1, 600);
+    td::Bitmask bitmask;
+    for (td::int64 i = 0; i < part_count; i++) {
+      if (td::Random::fast(0, 2) != 0) {
+        bitmask.set(i);
+      }
+    }
+    auto check = [&](const td::FileExtentMap &extent_map) {
+      ASSERT_EQ(bitmask.get_total_size(part_size, file_size), extent_map.get_total_size(file_size));
+      for (td::int64 offset = -1; offset <= part_count * part_size + 1; offset++) {
+        ASSERT_EQ(bitmask.get_ready_prefix_size(offset, part_size, file_size),
+                  extent_map.get_ready_prefix_size(offset, file_size));
+      }
+    };
+    check(td::FileExtentMap(td::Bitmask(td::Bitmask::Decode{}, bitmask.encode()), part_size));
+
+    td::FileExtentMap extent_map;
+    for (auto part_i : bitmask.as_vector()) {
+      extent_map.add(part_i * part_size, (part_i + 1) * part_size);
+    }
+    check(extent_map);
+
+    for (int i = 0; i < 10; i++) {
+      auto begin = td::Random::fast(0, static_cast<int>(part_count));
+      auto end = td::Random::fast(begin, static_cast<int>(part_count));
+      for (auto part_i = begin; part_i < end; part_i++) {
+        bitmask.set(part_i);
+      }
+      extent_map.add(begin * part_size, end * part_size);
+      check(extent_map);
+      ASSERT_TRUE(extent_map.is_ready(begin * part_size, end * part_size, file_size));
+    }
+  }
+}
+
+// downloads parts of the given size through a link with the given bandwidth and round-trip time, keeping in flight
+// as many bytes as allowed by the TransferEstimator, and returns the throughput during the last half of the time
+static double simulate_link(td::TransferEstimator &estimator, double bandwidth, double rtt, size_t part_size,
+                            double duration) {
+  struct Arrival {
+    double time;
+    double sent_at;
+    bool operator<(const Arrival &other) const {
+      return time > other.time;
+    }
+  };
+  std::priority_queue<Arrival> in_flight;
+  double now = 1000;
+  double begin_time = now;
+  double link_free_at = now;
+  td::int64 in_flight_size = 0;
+  td::int64 delivered = 0;
+  while (now < begin_time + duration) {
+    while (in_flight_size + static_cast<td::int64>(part_size) <= estimator.get_in_flight_limit(now)) {
+      // the request reaches the server in half of the RTT, then the answer waits in the queue of the bottleneck
+      auto start = td::max(now + rtt / 2, link_free_at);
+      link_free_at = start + static_cast<double>(part_size) / bandwidth;
+      in_flight.push(Arrival{link_free_at + rtt / 2, now});
+      in_flight_size += static_cast<td::int64>(part_size);
+    }
+    auto arrival = in_flight.top();
+    in_flight.pop();
+    now = arrival.time;
+    estimator.on_part_transferred(static_cast<td::int64>(part_size), arrival.sent_at, now);
+    in_flight_size -= static_cast<td::int64>(part_size);
+    if (now >= begin_time + duration / 2) {
+      delivered += static_cast<td::int64>(part_size);
+    }
+  }
+  return static_cast<double>(delivered) / (duration / 2);
+}
+
+TEST(TransferEstimator, simulated_link) {
+  struct Link {
+    double bandwidth;
+    double rtt;
+  };
+  for (auto link : {Link{1 << 20, 0.05}, Link{10 << 20, 0.2}, Link{50 << 20, 0.3}, Link{100 << 20, 0.6}}) {
+    td::TransferEstimator estimator;
+    size_t part_size = 64 << 10;
+    auto throughput = simulate_link(estimator, link.bandwidth, link.rtt, part_size, 60);
+    auto expected_throughput =
+        td::min(link.bandwidth, static_cast<double>(td::TransferEstimator::MAX_IN_FLIGHT_LIMIT) / link.rtt);
+    LOG(INFO) << "Throughput " << throughput / (1 << 20) << " MB/s of " << expected_throughput / (1 << 20)
+              << " MB/s with RTT " << link.rtt << ", in-flight limit "
+              << estimator.get_in_flight_limit(1000 + 60) << ", part size " << estimator.get_part_size(1000 + 60);
+    ASSERT_TRUE(throughput >= 0.9 * expected_throughput);
+
+    // the window must not grow much above the bandwidth-delay product, because of the queue it creates itself
+    auto bdp = static_cast<td::int64>(link.bandwidth * link.rtt);
+    ASSERT_TRUE(estimator.get_in_flight_limit(1000 + 60) <=
+                td::max(td::TransferEstimator::MIN_IN_FLIGHT_LIMIT, 4 * bdp + 4 * static_cast<td::int64>(part_size)));
+    if (bdp > td::TransferEstimator::MIN_IN_FLIGHT_LIMIT) {
+      ASSERT_TRUE(estimator.get_part_size(1000 + 60) > part_size);
+    }
+  }
+}